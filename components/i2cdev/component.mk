@@ -1,6 +1,6 @@
 COMPONENT_ADD_INCLUDEDIRS = .
 ifdef CONFIG_IDF_TARGET_ESP8266
-COMPONENT_DEPENDS = esp8266 freertos
+COMPONENT_DEPENDS = esp8266 freertos nvs_flash
 else
-COMPONENT_DEPENDS = driver freertos
+COMPONENT_DEPENDS = driver freertos nvs_flash
 endif
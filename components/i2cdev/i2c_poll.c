@@ -0,0 +1,266 @@
+/**
+ * @file i2c_poll.c
+ *
+ * Periodic polling scheduler
+ *
+ * MIT Licensed as described in the file LICENSE
+ */
+#include <string.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/semphr.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+#include "i2c_poll.h"
+
+static const char *TAG = "i2c_poll";
+
+// Longest timeline searched for a free offset, ticks
+#define FRAME_MAX 10000
+
+#define TICK_US (1000000 / configTICK_RATE_HZ)
+
+#define CHECK_ARG(VAL) do { if (!(VAL)) return ESP_ERR_INVALID_ARG; } while (0)
+
+typedef struct {
+    SemaphoreHandle_t lock; // Guards jobs, held while jobs of a tick run
+    StaticSemaphore_t lock_buf;
+    TaskHandle_t task;
+    SemaphoreHandle_t stopped; // Given by the scheduler task on exit
+    StaticSemaphore_t stopped_buf;
+    volatile bool stopping;
+    i2c_poll_job_t *jobs;   // Shortest period first
+    TickType_t base;        // Tick offsets are relative to
+    int64_t base_us;        // Time of the base tick
+} poll_port_t;
+
+static poll_port_t ports[I2C_NUM_MAX];
+
+static void run_job(poll_port_t *p, i2c_poll_job_t *job)
+{
+    int64_t release_us = p->base_us + (int64_t)(TickType_t)(job->release - p->base) * TICK_US;
+    int64_t start = esp_timer_get_time();
+    job->result = i2c_dev_batch(job->segs, job->count);
+    int64_t end = esp_timer_get_time();
+
+    i2c_poll_stats_t *stats = &job->stats;
+    uint32_t jitter = start > release_us ? start - release_us : 0;
+    stats->runs++;
+    if (job->result != ESP_OK)
+        stats->errors++;
+    stats->jitter_sum_us += jitter;
+    if (jitter > stats->jitter_max_us)
+        stats->jitter_max_us = jitter;
+    if (end - start > stats->duration_max_us)
+        stats->duration_max_us = end - start;
+    if (end > release_us + (int64_t)job->period * TICK_US)
+        stats->misses++;
+
+    // Releases a full period late are skipped, not run back to back
+    job->release += job->period;
+    while ((int32_t)(xTaskGetTickCount() - job->release) >= (int32_t)job->period)
+    {
+        job->release += job->period;
+        stats->misses++;
+    }
+
+    if (job->callback)
+        job->callback(job);
+}
+
+static void poll_task(void *arg)
+{
+    poll_port_t *p = arg;
+    TickType_t wake = p->base - 1;
+
+    vTaskDelayUntil(&wake, 1);
+    p->base_us = esp_timer_get_time();
+    while (!p->stopping)
+    {
+        xSemaphoreTake(p->lock, portMAX_DELAY);
+        for (i2c_poll_job_t *job = p->jobs; job; job = job->next)
+            if ((int32_t)(wake - job->release) >= 0)
+                run_job(p, job);
+        xSemaphoreGive(p->lock);
+
+        // Late ticks are caught up at once
+        vTaskDelayUntil(&wake, 1);
+    }
+
+    xSemaphoreGive(p->stopped);
+    vTaskDelete(NULL);
+}
+
+static TickType_t lcm(TickType_t a, TickType_t b)
+{
+    TickType_t x = a, y = b;
+    while (y)
+    {
+        TickType_t t = x % y;
+        x = y;
+        y = t;
+    }
+    uint64_t r = (uint64_t)a / x * b;
+    return r > FRAME_MAX ? FRAME_MAX : r;
+}
+
+/**
+ * Offset within the period that shares the fewest ticks with other jobs
+ */
+static TickType_t place(const poll_port_t *p, TickType_t period)
+{
+    TickType_t frame = period;
+    for (const i2c_poll_job_t *j = p->jobs; j; j = j->next)
+        frame = lcm(frame, j->period);
+    if (frame < period)
+        frame = period;
+
+    TickType_t best = 0;
+    uint32_t best_cost = UINT32_MAX;
+    for (TickType_t offset = 0; offset < period && best_cost; offset++)
+    {
+        uint32_t cost = 0;
+        for (TickType_t t = offset; t < frame && cost < best_cost; t += period)
+            for (const i2c_poll_job_t *j = p->jobs; j; j = j->next)
+                if (t % j->period == j->offset)
+                    cost++;
+        if (cost < best_cost)
+        {
+            best = offset;
+            best_cost = cost;
+        }
+    }
+
+    return best;
+}
+
+static poll_port_t *get_port(i2c_port_t port)
+{
+    poll_port_t *p = &ports[port];
+
+    vTaskSuspendAll();
+    if (!p->lock)
+    {
+        p->lock = xSemaphoreCreateMutexStatic(&p->lock_buf);
+        p->stopped = xSemaphoreCreateBinaryStatic(&p->stopped_buf);
+    }
+    xTaskResumeAll();
+
+    return p;
+}
+
+esp_err_t i2c_poll_add(i2c_poll_job_t *job)
+{
+    CHECK_ARG(job && job->segs && job->count && job->period_ms);
+    for (size_t i = 0; i < job->count; i++)
+        CHECK_ARG(job->segs[i].dev && job->segs[i].dev->port == job->segs[0].dev->port);
+    CHECK_ARG(job->segs[0].dev->port < I2C_NUM_MAX);
+
+    poll_port_t *p = get_port(job->segs[0].dev->port);
+    esp_err_t res = ESP_OK;
+
+    xSemaphoreTake(p->lock, portMAX_DELAY);
+    for (i2c_poll_job_t *j = p->jobs; j; j = j->next)
+        if (j == job)
+        {
+            res = ESP_ERR_INVALID_STATE;
+            goto out;
+        }
+
+    if (!p->task)
+    {
+        char name[] = "i2c_poll_0";
+        name[sizeof(name) - 2] += job->segs[0].dev->port;
+        p->base = xTaskGetTickCount() + 1;
+        p->stopping = false;
+        if (xTaskCreate(poll_task, name, CONFIG_I2CDEV_POLL_TASK_STACK, p,
+                CONFIG_I2CDEV_POLL_TASK_PRIORITY, &p->task) != pdPASS)
+        {
+            ESP_LOGE(TAG, "Could not create scheduler of port %d", job->segs[0].dev->port);
+            p->task = NULL;
+            res = ESP_ERR_NO_MEM;
+            goto out;
+        }
+    }
+
+    job->period = pdMS_TO_TICKS(job->period_ms);
+    if (!job->period)
+        job->period = 1;
+    job->offset = place(p, job->period);
+    job->result = ESP_OK;
+    memset(&job->stats, 0, sizeof(i2c_poll_stats_t));
+
+    // First release at the offset, after the current tick
+    TickType_t elapsed = xTaskGetTickCount() + 1 - p->base;
+    TickType_t cycles = (int32_t)elapsed > (int32_t)job->offset
+        ? (elapsed - job->offset + job->period - 1) / job->period : 0;
+    job->release = p->base + job->offset + cycles * job->period;
+
+    i2c_poll_job_t **link = &p->jobs;
+    while (*link && (*link)->period <= job->period)
+        link = &(*link)->next;
+    job->next = *link;
+    *link = job;
+
+    ESP_LOGD(TAG, "[port %d] Job of %u ticks at offset %u", job->segs[0].dev->port,
+            (unsigned)job->period, (unsigned)job->offset);
+out:
+    xSemaphoreGive(p->lock);
+    return res;
+}
+
+esp_err_t i2c_poll_remove(i2c_poll_job_t *job)
+{
+    CHECK_ARG(job && job->segs && job->count && job->segs[0].dev && job->segs[0].dev->port < I2C_NUM_MAX);
+
+    poll_port_t *p = get_port(job->segs[0].dev->port);
+    esp_err_t res = ESP_ERR_NOT_FOUND;
+
+    xSemaphoreTake(p->lock, portMAX_DELAY);
+    for (i2c_poll_job_t **link = &p->jobs; *link; link = &(*link)->next)
+        if (*link == job)
+        {
+            *link = job->next;
+            job->next = NULL;
+            res = ESP_OK;
+            break;
+        }
+    xSemaphoreGive(p->lock);
+
+    return res;
+}
+
+esp_err_t i2c_poll_get_stats(i2c_poll_job_t *job, i2c_poll_stats_t *stats, bool reset)
+{
+    CHECK_ARG(job && job->segs && job->count && job->segs[0].dev && job->segs[0].dev->port < I2C_NUM_MAX);
+
+    poll_port_t *p = get_port(job->segs[0].dev->port);
+
+    xSemaphoreTake(p->lock, portMAX_DELAY);
+    if (stats)
+        *stats = job->stats;
+    if (reset)
+        memset(&job->stats, 0, sizeof(i2c_poll_stats_t));
+    xSemaphoreGive(p->lock);
+
+    return ESP_OK;
+}
+
+esp_err_t i2c_poll_stop(i2c_port_t port)
+{
+    CHECK_ARG(port < I2C_NUM_MAX);
+
+    poll_port_t *p = get_port(port);
+    if (!p->task)
+        return ESP_OK;
+
+    p->stopping = true;
+    xSemaphoreTake(p->stopped, portMAX_DELAY);
+
+    xSemaphoreTake(p->lock, portMAX_DELAY);
+    p->task = NULL;
+    p->jobs = NULL;
+    xSemaphoreGive(p->lock);
+
+    return ESP_OK;
+}
@@ -0,0 +1,122 @@
+/**
+ * @file i2c_poll.h
+ * @defgroup i2c_poll i2c_poll
+ * @{
+ *
+ * Periodic polling scheduler
+ *
+ * Jobs are batches of segments run at a fixed period by one scheduler
+ * task per port, instead of one polling task per device. Every job gets
+ * an offset in RTOS ticks within its period, chosen at registration so
+ * that it shares as few ticks as possible with the jobs already on the
+ * port; jobs due in the same tick run shortest period first. Periods are
+ * whole ticks: a 1 kHz rate group needs `CONFIG_FREERTOS_HZ` = 1000.
+ *
+ * Results are passed to the job callback, called from the scheduler task.
+ * Per-job counters keep release jitter, run time and deadline misses.
+ *
+ * MIT Licensed as described in the file LICENSE
+ */
+#ifndef __I2C_POLL_H__
+#define __I2C_POLL_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <esp_err.h>
+#include "i2cdev.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Counters of a job, see ::i2c_poll_get_stats()
+ */
+typedef struct
+{
+    uint32_t runs;            //!< Completed runs
+    uint32_t errors;          //!< Runs that failed
+    uint32_t misses;          /*!< Deadline misses: runs that did not finish within their
+                                   period, and releases skipped because the scheduler
+                                   was a full period late */
+    uint32_t jitter_max_us;   //!< Largest delay of a run start after its release
+    uint64_t jitter_sum_us;   //!< Sum of start delays, for the mean
+    uint32_t duration_max_us; //!< Longest run
+} i2c_poll_stats_t;
+
+typedef struct i2c_poll_job_s i2c_poll_job_t;
+
+/**
+ * Job completion callback, called from the scheduler task after every run
+ *
+ * Runs with the scheduler lock held: it must not block for long nor add,
+ * remove or query jobs of the same port.
+ */
+typedef void (*i2c_poll_cb_t)(i2c_poll_job_t *job);
+
+/**
+ * Periodic job, see ::i2c_poll_add()
+ *
+ * Job and its segments are owned by the scheduler until removed.
+ */
+struct i2c_poll_job_s
+{
+    i2c_dev_seg_t *segs;       //!< Segments to run, as for ::i2c_dev_batch()
+    size_t count;              //!< Number of segments
+    uint32_t period_ms;        //!< Period, rounded to whole RTOS ticks, at least one
+    i2c_poll_cb_t callback;    //!< Completion callback if non-null
+    void *arg;                 //!< User argument for completion callback
+    esp_err_t result;          //!< Result of the last run
+    i2c_poll_stats_t stats;    //!< Counters
+    TickType_t period;         //!< Period in ticks, set by ::i2c_poll_add()
+    TickType_t offset;         //!< Offset in ticks within the period, set by ::i2c_poll_add()
+    TickType_t release;        //!< Internal
+    i2c_poll_job_t *next;      //!< Internal
+};
+
+/**
+ * @brief Add periodic job
+ *
+ * Starts the scheduler task of the port on first use. The job is laid
+ * out on the port timeline and first runs at its offset.
+ *
+ * @param job Job, all segments on one port
+ * @return `ESP_OK` on success
+ */
+esp_err_t i2c_poll_add(i2c_poll_job_t *job);
+
+/**
+ * @brief Remove job
+ *
+ * When the function returns the job is not running and will not run again.
+ *
+ * @param job Job
+ * @return `ESP_OK` on success, `ESP_ERR_NOT_FOUND` if the job is not scheduled
+ */
+esp_err_t i2c_poll_remove(i2c_poll_job_t *job);
+
+/**
+ * @brief Get counters of a job
+ *
+ * @param job Job
+ * @param[out] stats Snapshot of counters if non-null
+ * @param reset Reset counters after the snapshot if true
+ * @return `ESP_OK` on success
+ */
+esp_err_t i2c_poll_get_stats(i2c_poll_job_t *job, i2c_poll_stats_t *stats, bool reset);
+
+/**
+ * @brief Stop the scheduler of a port, removing all its jobs
+ *
+ * @param port I2C port number
+ * @return `ESP_OK` on success
+ */
+esp_err_t i2c_poll_stop(i2c_port_t port);
+
+#ifdef __cplusplus
+}
+#endif
+
+/**@}*/
+
+#endif /* __I2C_POLL_H__ */
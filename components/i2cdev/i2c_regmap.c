@@ -0,0 +1,235 @@
+/**
+ * @file i2c_regmap.c
+ *
+ * Cached register map of an I2C device with 8-bit registers
+ *
+ * MIT Licensed as described in the file LICENSE
+ */
+#include <string.h>
+#include <esp_log.h>
+#include "i2c_regmap.h"
+
+static const char *TAG = "i2c_regmap";
+
+// Segments per batch of a sync, bounds stack use
+#define SYNC_SEGS 8
+
+#define CHECK(x) do { esp_err_t __; if ((__ = x) != ESP_OK) return __; } while (0)
+#define CHECK_ARG(VAL) do { if (!(VAL)) return ESP_ERR_INVALID_ARG; } while (0)
+
+static inline bool in_map(const i2c_regmap_t *map, uint8_t reg)
+{
+    return reg >= map->cfg.base && reg - map->cfg.base < map->cfg.count;
+}
+
+static inline bool is_volatile(const i2c_regmap_t *map, uint32_t bit)
+{
+    return map->cfg.volatile_mask & bit;
+}
+
+static esp_err_t read_locked(i2c_regmap_t *map, uint8_t reg, uint8_t *val)
+{
+    size_t i = reg - map->cfg.base;
+    uint32_t bit = 1UL << i;
+
+    if (!is_volatile(map, bit) && (map->valid & bit))
+    {
+        map->stats.hits++;
+        *val = map->cache[i];
+        return ESP_OK;
+    }
+
+    CHECK(i2c_dev_read_reg(map->dev, reg, val, 1));
+    map->stats.bus_reads++;
+    if (!is_volatile(map, bit))
+    {
+        map->stats.misses++;
+        map->cache[i] = *val;
+        map->valid |= bit;
+    }
+
+    return ESP_OK;
+}
+
+static esp_err_t write_locked(i2c_regmap_t *map, uint8_t reg, uint8_t val)
+{
+    size_t i = reg - map->cfg.base;
+    uint32_t bit = 1UL << i;
+
+    if (map->cfg.readonly_mask & bit)
+        return ESP_ERR_NOT_SUPPORTED;
+
+    if (is_volatile(map, bit))
+    {
+        CHECK(i2c_dev_write_reg(map->dev, reg, &val, 1));
+        map->stats.bus_writes++;
+        return ESP_OK;
+    }
+
+    if ((map->valid & bit) && map->cache[i] == val)
+    {
+        map->stats.dropped++;
+        return ESP_OK;
+    }
+    map->cache[i] = val;
+    map->valid |= bit;
+    map->dirty |= bit;
+
+    return ESP_OK;
+}
+
+static esp_err_t sync_locked(i2c_regmap_t *map)
+{
+    i2c_dev_seg_t segs[SYNC_SEGS];
+    uint8_t regs[SYNC_SEGS];
+    esp_err_t res = ESP_OK;
+
+    size_t i = 0;
+    while (i < map->cfg.count)
+    {
+        size_t n = 0;
+        for (; i < map->cfg.count && n < SYNC_SEGS; i++)
+        {
+            if (!(map->dirty & (1UL << i)))
+                continue;
+            // Consecutive dirty registers in one write
+            size_t run = 1;
+            while (map->cfg.auto_increment && i + run < map->cfg.count && (map->dirty & (1UL << (i + run))))
+                run++;
+            regs[n] = map->cfg.base + i;
+            segs[n] = (i2c_dev_seg_t) {
+                .dev = map->dev,
+                .read = false,
+                .out = &regs[n],
+                .out_size = 1,
+                .data = &map->cache[i],
+                .size = run,
+                // Batches failing before the first segment leave results untouched
+                .result = ESP_FAIL,
+            };
+            n++;
+            i += run - 1;
+        }
+        if (!n)
+            break;
+
+        esp_err_t r = i2c_dev_batch(segs, n);
+        for (size_t j = 0; j < n; j++)
+        {
+            if (segs[j].result != ESP_OK)
+                continue;
+            for (size_t k = regs[j] - map->cfg.base; k < regs[j] - map->cfg.base + segs[j].size; k++)
+                map->dirty &= ~(1UL << k);
+            map->stats.bus_writes += segs[j].size;
+        }
+        if (r != ESP_OK)
+        {
+            ESP_LOGE(TAG, "[0x%02x at %d] Write-back failed: %d", map->dev->addr, map->dev->port, r);
+            if (res == ESP_OK)
+                res = r;
+        }
+    }
+
+    return res;
+}
+
+esp_err_t i2c_regmap_init(i2c_regmap_t *map, i2c_dev_t *dev, const i2c_regmap_config_t *cfg)
+{
+    CHECK_ARG(map && dev && cfg && cfg->count && cfg->count <= I2C_REGMAP_MAX_REGS);
+    CHECK_ARG(cfg->base + cfg->count <= 0x100);
+
+    memset(map, 0, sizeof(i2c_regmap_t));
+    map->dev = dev;
+    map->cfg = *cfg;
+    dev->regmap = map;
+
+    return ESP_OK;
+}
+
+esp_err_t i2c_regmap_read(i2c_regmap_t *map, uint8_t reg, uint8_t *val)
+{
+    CHECK_ARG(map && val && in_map(map, reg));
+
+    I2C_DEV_TAKE_MUTEX(map->dev);
+    I2C_DEV_CHECK(map->dev, read_locked(map, reg, val));
+    I2C_DEV_GIVE_MUTEX(map->dev);
+
+    return ESP_OK;
+}
+
+esp_err_t i2c_regmap_write(i2c_regmap_t *map, uint8_t reg, uint8_t val)
+{
+    CHECK_ARG(map && in_map(map, reg));
+
+    I2C_DEV_TAKE_MUTEX(map->dev);
+    I2C_DEV_CHECK(map->dev, write_locked(map, reg, val));
+    I2C_DEV_GIVE_MUTEX(map->dev);
+
+    return ESP_OK;
+}
+
+esp_err_t i2c_regmap_update_bits(i2c_regmap_t *map, uint8_t reg, uint8_t mask, uint8_t val)
+{
+    CHECK_ARG(map && in_map(map, reg));
+
+    uint8_t v;
+    I2C_DEV_TAKE_MUTEX(map->dev);
+    I2C_DEV_CHECK(map->dev, read_locked(map, reg, &v));
+    I2C_DEV_CHECK(map->dev, write_locked(map, reg, (v & ~mask) | (val & mask)));
+    I2C_DEV_GIVE_MUTEX(map->dev);
+
+    return ESP_OK;
+}
+
+esp_err_t i2c_regmap_update_sync(i2c_regmap_t *map, uint8_t reg, uint8_t mask, uint8_t val)
+{
+    CHECK_ARG(map && in_map(map, reg));
+
+    uint8_t v = 0;
+    I2C_DEV_TAKE_MUTEX(map->dev);
+    // Whole register writes need no read
+    if (mask != 0xff)
+        I2C_DEV_CHECK(map->dev, read_locked(map, reg, &v));
+    I2C_DEV_CHECK(map->dev, write_locked(map, reg, (v & ~mask) | (val & mask)));
+    I2C_DEV_CHECK(map->dev, sync_locked(map));
+    I2C_DEV_GIVE_MUTEX(map->dev);
+
+    return ESP_OK;
+}
+
+esp_err_t i2c_regmap_sync(i2c_regmap_t *map)
+{
+    CHECK_ARG(map);
+
+    I2C_DEV_TAKE_MUTEX(map->dev);
+    I2C_DEV_CHECK(map->dev, sync_locked(map));
+    I2C_DEV_GIVE_MUTEX(map->dev);
+
+    return ESP_OK;
+}
+
+esp_err_t i2c_regmap_invalidate(i2c_regmap_t *map)
+{
+    CHECK_ARG(map);
+
+    I2C_DEV_TAKE_MUTEX(map->dev);
+    map->valid = 0;
+    map->dirty = 0;
+    I2C_DEV_GIVE_MUTEX(map->dev);
+
+    return ESP_OK;
+}
+
+esp_err_t i2c_regmap_get_stats(i2c_regmap_t *map, i2c_regmap_stats_t *stats, bool reset)
+{
+    CHECK_ARG(map);
+
+    I2C_DEV_TAKE_MUTEX(map->dev);
+    if (stats)
+        *stats = map->stats;
+    if (reset)
+        memset(&map->stats, 0, sizeof(i2c_regmap_stats_t));
+    I2C_DEV_GIVE_MUTEX(map->dev);
+
+    return ESP_OK;
+}
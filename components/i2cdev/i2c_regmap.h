@@ -0,0 +1,172 @@
+/**
+ * @file i2c_regmap.h
+ * @defgroup i2c_regmap i2c_regmap
+ * @{
+ *
+ * Cached register map of an I2C device with 8-bit registers
+ *
+ * Registers of a map are cached or volatile. Reads of cached registers are
+ * served from RAM once the register has been read or written; writes to
+ * cached registers only mark them dirty and are flushed by
+ * ::i2c_regmap_sync() in one batch, consecutive registers in one
+ * auto-increment write if the device supports it. Writes of an unchanged
+ * value are dropped. Volatile registers (status, input ports) are always
+ * read from and written to the device.
+ *
+ * Functions take the device mutex, the caller must not hold it.
+ *
+ * MIT Licensed as described in the file LICENSE
+ */
+#ifndef __I2C_REGMAP_H__
+#define __I2C_REGMAP_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <esp_err.h>
+#include "i2cdev.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define I2C_REGMAP_MAX_REGS 32 //!< Maximum number of registers in a map
+
+/**
+ * Register map layout
+ */
+typedef struct
+{
+    uint8_t base;            //!< Address of the first register
+    uint8_t count;           //!< Number of registers, up to ::I2C_REGMAP_MAX_REGS
+    uint32_t volatile_mask;  //!< Bit N set if register `base + N` is volatile
+    uint32_t readonly_mask;  //!< Bit N set if register `base + N` cannot be written
+    bool auto_increment;     //!< Device increments the register address on multibyte writes
+} i2c_regmap_config_t;
+
+/**
+ * Cache counters, see ::i2c_regmap_get_stats()
+ */
+typedef struct
+{
+    uint32_t hits;         //!< Reads served from cache
+    uint32_t misses;       //!< Reads of cached registers that went to the bus
+    uint32_t bus_reads;    //!< Registers read from the bus, volatile ones included
+    uint32_t bus_writes;   //!< Registers written to the bus
+    uint32_t dropped;      //!< Writes of an unchanged value
+} i2c_regmap_stats_t;
+
+/**
+ * Register map, see ::i2c_regmap_init()
+ */
+typedef struct i2c_regmap_s
+{
+    i2c_dev_t *dev;                     //!< Device descriptor
+    i2c_regmap_config_t cfg;            //!< Layout
+    uint32_t valid;                     //!< Bit N set if cache of register `base + N` is valid
+    uint32_t dirty;                     //!< Bit N set if register `base + N` awaits write-back
+    uint8_t cache[I2C_REGMAP_MAX_REGS]; //!< Cached values
+    i2c_regmap_stats_t stats;           //!< Counters
+} i2c_regmap_t;
+
+/**
+ * @brief Initialize register map of a device
+ *
+ * Cache starts empty. The device descriptor must have its mutex created.
+ *
+ * @param map Register map
+ * @param dev Device descriptor
+ * @param cfg Layout
+ * @return `ESP_OK` on success
+ */
+esp_err_t i2c_regmap_init(i2c_regmap_t *map, i2c_dev_t *dev, const i2c_regmap_config_t *cfg);
+
+/**
+ * @brief Read register
+ *
+ * @param map Register map
+ * @param reg Register address
+ * @param[out] val Register value
+ * @return `ESP_OK` on success, `ESP_ERR_INVALID_ARG` if \p reg is not in the map
+ */
+esp_err_t i2c_regmap_read(i2c_regmap_t *map, uint8_t reg, uint8_t *val);
+
+/**
+ * @brief Write register
+ *
+ * Volatile registers are written at once, cached ones at the next
+ * ::i2c_regmap_sync().
+ *
+ * @param map Register map
+ * @param reg Register address
+ * @param val Register value
+ * @return `ESP_OK` on success, `ESP_ERR_NOT_SUPPORTED` for read only registers
+ */
+esp_err_t i2c_regmap_write(i2c_regmap_t *map, uint8_t reg, uint8_t val);
+
+/**
+ * @brief Read-modify-write register
+ *
+ * Bits of \p mask are set from \p val. For cached registers with a valid
+ * cache the read is free.
+ *
+ * @param map Register map
+ * @param reg Register address
+ * @param mask Bits to change
+ * @param val New value of the bits
+ * @return `ESP_OK` on success
+ */
+esp_err_t i2c_regmap_update_bits(i2c_regmap_t *map, uint8_t reg, uint8_t mask, uint8_t val);
+
+/**
+ * @brief Read-modify-write register and write dirty registers back
+ *
+ * ::i2c_regmap_update_bits() and ::i2c_regmap_sync() under one lock of
+ * the device, as one atomic operation.
+ *
+ * @param map Register map
+ * @param reg Register address
+ * @param mask Bits to change, 0xff to write the whole register
+ * @param val New value of the bits
+ * @return `ESP_OK` on success
+ */
+esp_err_t i2c_regmap_update_sync(i2c_regmap_t *map, uint8_t reg, uint8_t mask, uint8_t val);
+
+/**
+ * @brief Write dirty registers back to the device
+ *
+ * All dirty registers are written in one batch. Registers whose write
+ * failed stay dirty.
+ *
+ * @param map Register map
+ * @return `ESP_OK` on success, first error otherwise
+ */
+esp_err_t i2c_regmap_sync(i2c_regmap_t *map);
+
+/**
+ * @brief Drop the cache
+ *
+ * For when the device may have lost its state, e.g. after a reset.
+ * Pending writes are dropped as well.
+ *
+ * @param map Register map
+ * @return `ESP_OK` on success
+ */
+esp_err_t i2c_regmap_invalidate(i2c_regmap_t *map);
+
+/**
+ * @brief Get cache counters
+ *
+ * @param map Register map
+ * @param[out] stats Snapshot of counters if non-null
+ * @param reset Reset counters after the snapshot if true
+ * @return `ESP_OK` on success
+ */
+esp_err_t i2c_regmap_get_stats(i2c_regmap_t *map, i2c_regmap_stats_t *stats, bool reset);
+
+#ifdef __cplusplus
+}
+#endif
+
+/**@}*/
+
+#endif /* __I2C_REGMAP_H__ */
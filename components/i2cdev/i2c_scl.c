@@ -0,0 +1,164 @@
+/**
+ * @file i2c_scl.c
+ *
+ * Per-device SCL frequency calibration, persisted to NVS
+ *
+ * MIT Licensed as described in the file LICENSE
+ */
+#include <stdio.h>
+#include <esp_log.h>
+#include <esp_idf_lib_helpers.h>
+#include "i2c_scl.h"
+
+#if CONFIG_I2CDEV_SCL_CALIBRATION
+
+#include <nvs.h>
+
+static const char *TAG = "i2c_scl";
+
+#define NVS_NAMESPACE "i2cdev"
+
+#define CHECK(x) do { esp_err_t __; if ((__ = x) != ESP_OK) return __; } while (0)
+#define CHECK_ARG(VAL) do { if (!(VAL)) return ESP_ERR_INVALID_ARG; } while (0)
+
+static void nvs_key(const i2c_dev_t *dev, char *key, size_t size)
+{
+    snprintf(key, size, "scl_%u_%02x", (unsigned)dev->port, dev->addr);
+}
+
+static esp_err_t nvs_store(const i2c_dev_t *dev, uint32_t hz)
+{
+    char key[16];
+    nvs_handle_t nvs;
+
+    nvs_key(dev, key, sizeof(key));
+    CHECK(nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs));
+    esp_err_t res = hz ? nvs_set_u32(nvs, key, hz) : nvs_erase_key(nvs, key);
+    if (res == ESP_ERR_NVS_NOT_FOUND)
+        res = ESP_OK;
+    if (res == ESP_OK)
+        res = nvs_commit(nvs);
+    nvs_close(nvs);
+
+    return res;
+}
+
+static uint32_t current_hz(const i2c_dev_t *dev)
+{
+#if HELPER_TARGET_IS_ESP32
+    return dev->bus->cfg.master.clk_speed;
+#else
+    return 0;
+#endif
+}
+
+static esp_err_t check_step(i2c_dev_t *dev, const i2c_scl_config_t *cfg, uint32_t hz)
+{
+    CHECK(i2c_scl_set(dev, hz));
+    for (uint16_t i = 0; i < cfg->passes; i++)
+    {
+        esp_err_t res = cfg->check(dev, cfg->arg);
+        if (res != ESP_OK)
+        {
+#if CONFIG_I2CDEV_BREAKER
+            // Failures on purpose must not keep the device fenced off
+            i2c_dev_reset_breaker(dev);
+#endif
+            ESP_LOGD(TAG, "[0x%02x at %d] %u Hz failed pass %u: %d", dev->addr, dev->port,
+                    (unsigned)hz, (unsigned)i, res);
+            return ESP_ERR_INVALID_RESPONSE;
+        }
+    }
+
+    return ESP_OK;
+}
+
+esp_err_t i2c_scl_set(i2c_dev_t *dev, uint32_t hz)
+{
+    CHECK_ARG(dev && dev->bus && hz);
+
+#if HELPER_TARGET_IS_ESP32
+    i2c_config_t cfg = dev->bus->cfg;
+    if (cfg.master.clk_speed == hz)
+        return ESP_OK;
+    cfg.master.clk_speed = hz;
+
+    I2C_DEV_TAKE_MUTEX(dev);
+    // Attach to the new bus first, the copy drops the old one
+    i2c_dev_t old = *dev;
+    I2C_DEV_CHECK(dev, i2c_dev_attach(dev, dev->port, &cfg, dev->bus->timeout_ticks));
+    i2c_dev_detach(&old);
+    I2C_DEV_GIVE_MUTEX(dev);
+
+    return ESP_OK;
+#else
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+esp_err_t i2c_scl_calibrate(i2c_dev_t *dev, const i2c_scl_config_t *cfg, uint32_t *hz)
+{
+    CHECK_ARG(dev && dev->bus && cfg && cfg->check && cfg->min_hz && cfg->step_hz && cfg->passes);
+    CHECK_ARG(cfg->max_hz >= cfg->min_hz && cfg->margin_pct < 100);
+
+    uint32_t prev = current_hz(dev);
+    uint32_t best = 0;
+    for (uint32_t f = cfg->min_hz; f <= cfg->max_hz; f += cfg->step_hz)
+    {
+        esp_err_t res = check_step(dev, cfg, f);
+        if (res == ESP_ERR_INVALID_RESPONSE)
+            break;
+        if (res != ESP_OK)
+        {
+            i2c_scl_set(dev, prev);
+            return res;
+        }
+        best = f;
+    }
+    if (!best)
+    {
+        ESP_LOGE(TAG, "[0x%02x at %d] Fails at %u Hz already", dev->addr, dev->port, (unsigned)cfg->min_hz);
+        i2c_scl_set(dev, prev);
+        return ESP_ERR_INVALID_RESPONSE;
+    }
+
+    uint32_t res_hz = (uint64_t)best * (100 - cfg->margin_pct) / 100;
+    if (res_hz < cfg->min_hz)
+        res_hz = cfg->min_hz;
+    ESP_LOGI(TAG, "[0x%02x at %d] Passes up to %u Hz, using %u Hz", dev->addr, dev->port,
+            (unsigned)best, (unsigned)res_hz);
+
+    CHECK(i2c_scl_set(dev, res_hz));
+    if (hz)
+        *hz = res_hz;
+
+    return nvs_store(dev, res_hz);
+}
+
+esp_err_t i2c_scl_load(i2c_dev_t *dev)
+{
+    CHECK_ARG(dev && dev->bus);
+
+    char key[16];
+    nvs_handle_t nvs;
+    uint32_t hz = 0;
+
+    nvs_key(dev, key, sizeof(key));
+    CHECK(nvs_open(NVS_NAMESPACE, NVS_READONLY, &nvs));
+    esp_err_t res = nvs_get_u32(nvs, key, &hz);
+    nvs_close(nvs);
+    CHECK(res);
+
+    ESP_LOGD(TAG, "[0x%02x at %d] Stored SCL %u Hz", dev->addr, dev->port, (unsigned)hz);
+
+    return i2c_scl_set(dev, hz);
+}
+
+esp_err_t i2c_scl_erase(i2c_dev_t *dev)
+{
+    CHECK_ARG(dev);
+
+    return nvs_store(dev, 0);
+}
+
+#endif /* CONFIG_I2CDEV_SCL_CALIBRATION */
@@ -0,0 +1,121 @@
+/**
+ * @file i2c_scl.h
+ * @defgroup i2c_scl i2c_scl
+ * @{
+ *
+ * Per-device SCL frequency calibration, persisted to NVS
+ *
+ * ::i2c_scl_calibrate() steps the SCL frequency of a device up from
+ * `min_hz` and runs a driver check at every step, typically a readback of
+ * registers with known contents. The highest frequency where every check
+ * passed, less a safety margin, is applied and stored in NVS under the
+ * port and address of the device. ::i2c_scl_load(), called by the drivers
+ * when they create a descriptor, applies the stored frequency on the next
+ * boot.
+ *
+ * Stepping stops at the first failing step: slow edges only get worse
+ * with frequency. Wiring that is marginal at some frequency may pass a
+ * few checks there, hence several passes per step and the margin.
+ *
+ * NVS must be initialized with nvs_flash_init() before use.
+ *
+ * MIT Licensed as described in the file LICENSE
+ */
+#ifndef __I2C_SCL_H__
+#define __I2C_SCL_H__
+
+#include <stdint.h>
+#include <esp_err.h>
+#include "i2cdev.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Device check, run at every step. Must not hold the device mutex on
+ * return.
+ *
+ * @return `ESP_OK` if the device answered with the expected values
+ */
+typedef esp_err_t (*i2c_scl_check_cb_t)(i2c_dev_t *dev, void *arg);
+
+/**
+ * Calibration parameters
+ */
+typedef struct
+{
+    uint32_t min_hz;        //!< First frequency tried, calibration fails if it does not pass
+    uint32_t max_hz;        //!< Highest frequency tried
+    uint32_t step_hz;       //!< Frequency step
+    uint16_t passes;        //!< Checks per step, all must pass
+    uint8_t margin_pct;     //!< Stored frequency is the highest passing one less this, percent
+    i2c_scl_check_cb_t check; //!< Device check
+    void *arg;              //!< Argument of the check
+} i2c_scl_config_t;
+
+/**
+ * Defaults: 100 kHz to 1 MHz in 50 kHz steps, 16 passes, 20% margin
+ */
+#define I2C_SCL_CONFIG_DEFAULT(CHECK_CB) { \
+        .min_hz = 100000, \
+        .max_hz = 1000000, \
+        .step_hz = 50000, \
+        .passes = 16, \
+        .margin_pct = 20, \
+        .check = (CHECK_CB), \
+        .arg = NULL, \
+    }
+
+/**
+ * @brief Set SCL frequency of a device
+ *
+ * Reattaches the device with the frequency changed, other settings kept.
+ *
+ * @param dev Device descriptor
+ * @param hz SCL frequency
+ * @return `ESP_OK` on success, `ESP_ERR_NOT_SUPPORTED` on targets without
+ *         per-config SCL frequency (ESP8266)
+ */
+esp_err_t i2c_scl_set(i2c_dev_t *dev, uint32_t hz);
+
+/**
+ * @brief Calibrate SCL frequency of a device and store it in NVS
+ *
+ * The device is left at the calibrated frequency. If `min_hz` already
+ * fails, the previous frequency is restored and nothing is stored.
+ *
+ * @param dev Device descriptor
+ * @param cfg Calibration parameters
+ * @param[out] hz Calibrated frequency if non-null
+ * @return `ESP_OK` on success, `ESP_ERR_INVALID_RESPONSE` if `min_hz`
+ *         failed, NVS errors
+ */
+esp_err_t i2c_scl_calibrate(i2c_dev_t *dev, const i2c_scl_config_t *cfg, uint32_t *hz);
+
+/**
+ * @brief Apply frequency stored in NVS
+ *
+ * @param dev Device descriptor
+ * @return `ESP_OK` on success, `ESP_ERR_NVS_NOT_FOUND` if the device was
+ *         never calibrated
+ */
+esp_err_t i2c_scl_load(i2c_dev_t *dev);
+
+/**
+ * @brief Erase frequency stored in NVS
+ *
+ * The device keeps its current frequency.
+ *
+ * @param dev Device descriptor
+ * @return `ESP_OK` on success
+ */
+esp_err_t i2c_scl_erase(i2c_dev_t *dev);
+
+#ifdef __cplusplus
+}
+#endif
+
+/**@}*/
+
+#endif /* __I2C_SCL_H__ */
@@ -8,23 +8,182 @@
  * MIT Licensed as described in the file LICENSE
  */
 #include <string.h>
+#include <stdint.h>
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
+#include <freertos/queue.h>
 #include <esp_log.h>
+#if CONFIG_I2CDEV_STATS || CONFIG_I2CDEV_TRACE
+#include <esp_timer.h>
+#endif
+#if CONFIG_I2CDEV_TRACE
+#include <stdio.h>
+#include <stdlib.h>
+#endif
 #include "i2cdev.h"
+#include "i2cdev_backend.h"
 
 static const char *TAG = "i2cdev";
 
+#if CONFIG_I2CDEV_SINGLE_LOCK && CONFIG_I2CDEV_ASYNC
+#error "CONFIG_I2CDEV_SINGLE_LOCK needs the transfers to run in the calling task, not with CONFIG_I2CDEV_ASYNC"
+#endif
+
+#if CONFIG_I2CDEV_PRIORITY
+/**
+ * Task waiting for the port, linked into the list of its class
+ */
+typedef struct port_waiter_s {
+    SemaphoreHandle_t sem;       // Given when the port is handed over
+    struct port_waiter_s *next;
+    bool granted;
+} port_waiter_t;
+#endif
+
 typedef struct {
-    SemaphoreHandle_t lock;
+    SemaphoreHandle_t lock; // Port mutex, or guard of the port lock with CONFIG_I2CDEV_PRIORITY
+#if CONFIG_I2CDEV_PRIORITY
+    bool owned;
+    port_waiter_t *waiters[I2C_DEV_PRIO_CLASSES]; // FIFO per class
+#endif
+#if CONFIG_I2CDEV_SINGLE_LOCK
+    TaskHandle_t holder; // Task holding the port through a device mutex
+    uint16_t depth;      // Device mutexes taken by the holder
+#endif
     i2c_config_t config;
     bool installed;
+    const i2c_bus_t *bus; // Bus whose config and timeout are applied
+    uint32_t timeout;     // Applied HW timeout, 0 if unknown
+    i2cdev_cfg_stats_t cfg_stats;
+#if CONFIG_I2CDEV_STATS
+    i2cdev_stats_t stats;
+    i2cdev_prio_stats_t prio_stats[I2C_DEV_PRIO_CLASSES];
+#endif
+#if CONFIG_I2CDEV_ASYNC
+    QueueHandle_t queue;
+    TaskHandle_t worker;
+    TaskHandle_t stopper;
+#endif
+#if CONFIG_I2CDEV_TRACE
+    i2cdev_trace_rec_t *trace;
+    uint32_t trace_size;
+    uint32_t trace_written; // Records written since start, ring index is modulo size
+    bool tracing;
+#endif
 } i2c_port_state_t;
 
 static i2c_port_state_t states[I2C_NUM_MAX];
+static i2c_bus_t buses[CONFIG_I2CDEV_MAX_BUSES];
+
+static inline i2c_dev_prio_t dev_prio(const i2c_dev_t *dev, i2c_dev_prio_t prio)
+{
+    if (prio)
+        return prio;
+    return dev->prio ? dev->prio : I2C_DEV_PRIO_NORMAL;
+}
+
+#if CONFIG_I2CDEV_PRIORITY
+
+/*
+ * Port lock handed over by class: on release the port goes straight to the
+ * oldest waiter of the highest class, so a later realtime transfer overtakes
+ * bulk transfers that are already waiting. Unlike a mutex it does not
+ * inherit task priorities.
+ */
+static bool port_take(i2c_port_t port, i2c_dev_prio_t prio, TickType_t ticks)
+{
+    i2c_port_state_t *state = &states[port];
+
+    xSemaphoreTake(state->lock, portMAX_DELAY);
+    if (!state->owned)
+    {
+        state->owned = true;
+        xSemaphoreGive(state->lock);
+        return true;
+    }
+    if (!ticks)
+    {
+        xSemaphoreGive(state->lock);
+        return false;
+    }
+
+    StaticSemaphore_t sem_buf;
+    port_waiter_t waiter = { .sem = xSemaphoreCreateBinaryStatic(&sem_buf) };
+    port_waiter_t **link = &state->waiters[prio - 1];
+    while (*link)
+        link = &(*link)->next;
+    *link = &waiter;
+    xSemaphoreGive(state->lock);
+
+    bool granted = xSemaphoreTake(waiter.sem, ticks) == pdTRUE;
+    if (!granted)
+    {
+        // Port may have been handed over after the wait timed out
+        xSemaphoreTake(state->lock, portMAX_DELAY);
+        granted = waiter.granted;
+        if (!granted)
+        {
+            for (link = &state->waiters[prio - 1]; *link != &waiter; link = &(*link)->next) {}
+            *link = waiter.next;
+        }
+        xSemaphoreGive(state->lock);
+    }
+    vSemaphoreDelete(waiter.sem);
+
+    return granted;
+}
+
+static bool port_give(i2c_port_t port)
+{
+    i2c_port_state_t *state = &states[port];
+
+    xSemaphoreTake(state->lock, portMAX_DELAY);
+    for (int i = I2C_DEV_PRIO_CLASSES - 1; i >= 0; i--)
+    {
+        port_waiter_t *next = state->waiters[i];
+        if (!next)
+            continue;
+        // Port stays owned, ownership passes to the waiter
+        state->waiters[i] = next->next;
+        next->granted = true;
+        xSemaphoreGive(next->sem);
+        xSemaphoreGive(state->lock);
+        return true;
+    }
+    state->owned = false;
+    xSemaphoreGive(state->lock);
+
+    return true;
+}
+
+#else
+
+static inline bool port_take(i2c_port_t port, i2c_dev_prio_t prio, TickType_t ticks)
+{
+    return xSemaphoreTake(states[port].lock, ticks) == pdTRUE;
+}
+
+static inline bool port_give(i2c_port_t port)
+{
+    return xSemaphoreGive(states[port].lock) == pdTRUE;
+}
+
+#endif /* CONFIG_I2CDEV_PRIORITY */
+
+/**
+ * true if the calling task holds the port through a device mutex
+ */
+static inline bool port_held(i2c_port_t port)
+{
+#if CONFIG_I2CDEV_SINGLE_LOCK
+    return states[port].holder && states[port].holder == xTaskGetCurrentTaskHandle();
+#else
+    return false;
+#endif
+}
 
 #define SEMAPHORE_TAKE(port) do { \
-        if (!xSemaphoreTake(states[port].lock, pdMS_TO_TICKS(CONFIG_I2CDEV_TIMEOUT))) \
+        if (!port_held(port) && !port_take(port, I2C_DEV_PRIO_NORMAL, pdMS_TO_TICKS(CONFIG_I2CDEV_TIMEOUT))) \
         { \
             ESP_LOGE(TAG, "Could not take port mutex %d", port); \
             return ESP_ERR_TIMEOUT; \
@@ -32,13 +191,316 @@ static i2c_port_state_t states[I2C_NUM_MAX];
         } while (0)
 
 #define SEMAPHORE_GIVE(port) do { \
-        if (!xSemaphoreGive(states[port].lock)) \
+        if (!port_held(port) && !port_give(port)) \
         { \
             ESP_LOGE(TAG, "Could not give port mutex %d", port); \
             return ESP_FAIL; \
         } \
         } while (0)
 
+static inline int64_t stats_now()
+{
+#if CONFIG_I2CDEV_STATS || CONFIG_I2CDEV_TRACE
+    return esp_timer_get_time();
+#else
+    return 0;
+#endif
+}
+
+#if CONFIG_I2CDEV_STATS
+
+// Statistics are updated with port mutex taken
+#define DEV_STATS(dev) (&((i2c_dev_t *)(dev))->stats)
+
+static void hist_add(i2cdev_hist_t *hist, int64_t us)
+{
+    uint32_t v = us > 0 ? (uint32_t)us : 0;
+    size_t bucket = 0;
+    if (v >= I2CDEV_HIST_MIN_US)
+    {
+        bucket = 31 - __builtin_clz(v / I2CDEV_HIST_MIN_US) + 1;
+        if (bucket >= I2CDEV_HIST_BUCKETS)
+            bucket = I2CDEV_HIST_BUCKETS - 1;
+    }
+    hist->count[bucket]++;
+    if (v > hist->max_us)
+        hist->max_us = v;
+}
+
+static void stats_lock_wait(const i2c_dev_t *dev, int64_t since, bool locked)
+{
+    int64_t us = esp_timer_get_time() - since;
+    i2cdev_stats_t *stats[] = { &states[dev->port].stats, DEV_STATS(dev) };
+
+    // Port mutex is not taken on failure, counters may race with the owner
+    for (size_t i = 0; i < 2; i++)
+    {
+        if (locked)
+            hist_add(&stats[i]->lock_wait, us);
+        else
+            stats[i]->timeouts++;
+    }
+}
+
+static void stats_update(i2cdev_stats_t *stats, const i2c_dev_seg_t *seg, esp_err_t res, int64_t us)
+{
+    size_t out = (seg->out ? seg->out_size : 0) + (seg->read ? 0 : seg->size);
+
+    stats->bytes_out += out;
+    if (seg->read)
+        stats->bytes_in += seg->size;
+    if (!us)
+        return;
+    // Once per transaction
+    stats->transactions++;
+    hist_add(&stats->bus_time, us);
+    if (res == ESP_FAIL)
+        stats->nacks++;
+    else if (res == ESP_ERR_TIMEOUT)
+        stats->timeouts++;
+}
+
+static void stats_chunk(const i2c_dev_seg_t *segs, size_t count, esp_err_t res, int64_t since)
+{
+    int64_t us = esp_timer_get_time() - since;
+    if (!us)
+        us = 1;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        stats_update(&states[segs[0].dev->port].stats, &segs[i], res, i ? 0 : us);
+        // Every device in the transaction gets its time once
+        bool seen = false;
+        for (size_t j = 0; j < i && !seen; j++)
+            seen = segs[j].dev == segs[i].dev;
+        stats_update(DEV_STATS(segs[i].dev), &segs[i], res, seen ? 0 : us);
+    }
+}
+
+static inline void stats_reconfig(const i2c_dev_t *dev)
+{
+    states[dev->port].stats.reconfigs++;
+    DEV_STATS(dev)->reconfigs++;
+}
+
+static void stats_prio_wait(i2c_port_t port, i2c_dev_prio_t prio, int64_t since, bool granted)
+{
+    i2cdev_prio_stats_t *stats = &states[port].prio_stats[prio - 1];
+
+    // Port mutex is not taken on timeout, counters may race with the owner
+    if (!granted)
+    {
+        stats->timeouts++;
+        return;
+    }
+    stats->grants++;
+    hist_add(&stats->wait, esp_timer_get_time() - since);
+}
+
+#else
+
+static inline void stats_lock_wait(const i2c_dev_t *dev, int64_t since, bool locked) {}
+static inline void stats_chunk(const i2c_dev_seg_t *segs, size_t count, esp_err_t res, int64_t since) {}
+static inline void stats_reconfig(const i2c_dev_t *dev) {}
+static inline void stats_prio_wait(i2c_port_t port, i2c_dev_prio_t prio, int64_t since, bool granted) {}
+
+#endif /* CONFIG_I2CDEV_STATS */
+
+#if CONFIG_I2CDEV_TRACE
+
+// Ring is written with port mutex taken
+static void trace_chunk(const i2c_dev_seg_t *segs, size_t count, esp_err_t res, int64_t since)
+{
+    i2c_port_state_t *state = &states[segs[0].dev->port];
+    if (!state->tracing)
+        return;
+
+    uint32_t duration = esp_timer_get_time() - since;
+    const i2c_bus_t *bus = segs[0].dev->bus;
+    uint16_t scl_khz = 0;
+#if HELPER_TARGET_IS_ESP32
+    if (bus)
+        scl_khz = bus->cfg.master.clk_speed / 1000;
+#endif
+
+    for (size_t i = 0; i < count; i++)
+    {
+        const i2c_dev_seg_t *seg = &segs[i];
+        i2cdev_trace_rec_t *rec = &state->trace[state->trace_written++ % state->trace_size];
+
+        rec->ts_us = (uint32_t)since;
+        rec->duration_us = duration;
+        rec->result = res;
+        rec->size = seg->size > UINT16_MAX ? UINT16_MAX : seg->size;
+        rec->scl_khz = scl_khz;
+        rec->port = seg->dev->port;
+        rec->addr = seg->dev->addr;
+        rec->flags = (seg->read ? I2CDEV_TRACE_READ : 0) | (i ? I2CDEV_TRACE_JOINED : 0);
+        rec->out_size = seg->out ? seg->out_size : 0;
+        memcpy(rec->out, seg->out, rec->out_size < I2CDEV_XFER_OUT_MAX ? rec->out_size : I2CDEV_XFER_OUT_MAX);
+        // Payload of failed reads is undefined
+        size_t n = seg->read && res != ESP_OK ? 0 : seg->size < I2CDEV_TRACE_PAYLOAD ? seg->size : I2CDEV_TRACE_PAYLOAD;
+        memcpy(rec->data, seg->data, n);
+        memset(rec->data + n, 0, I2CDEV_TRACE_PAYLOAD - n);
+    }
+}
+
+static esp_err_t trace_csv(const i2cdev_trace_rec_t *rec, i2cdev_trace_write_cb_t write, void *ctx)
+{
+    char line[64 + 2 * (I2CDEV_XFER_OUT_MAX + I2CDEV_TRACE_PAYLOAD)];
+    int len = snprintf(line, sizeof(line), "%u,%u,0x%02x,%c,%u,",
+            (unsigned)rec->ts_us, rec->port, rec->addr, rec->flags & I2CDEV_TRACE_READ ? 'r' : 'w',
+            rec->flags & I2CDEV_TRACE_JOINED ? 1 : 0);
+    for (size_t i = 0; i < rec->out_size && i < I2CDEV_XFER_OUT_MAX; i++)
+        len += snprintf(line + len, sizeof(line) - len, "%02x", rec->out[i]);
+    len += snprintf(line + len, sizeof(line) - len, ",%u,", rec->size);
+    for (size_t i = 0; i < rec->size && i < I2CDEV_TRACE_PAYLOAD; i++)
+        len += snprintf(line + len, sizeof(line) - len, "%02x", rec->data[i]);
+    len += snprintf(line + len, sizeof(line) - len, ",%d,%u,%u\n",
+            (int)rec->result, (unsigned)rec->duration_us, rec->scl_khz);
+
+    return write(line, len, ctx);
+}
+
+#else
+
+static inline void trace_chunk(const i2c_dev_seg_t *segs, size_t count, esp_err_t res, int64_t since) {}
+
+#endif /* CONFIG_I2CDEV_TRACE */
+
+#if CONFIG_I2CDEV_BREAKER
+
+// Breaker state is updated with port mutex taken
+#define DEV_BREAKER(dev) (&((i2c_dev_t *)(dev))->breaker)
+
+static i2c_dev_breaker_cb_t breaker_cb;
+
+static void breaker_set(const i2c_dev_t *dev, i2c_dev_breaker_state_t state)
+{
+    DEV_BREAKER(dev)->state = state;
+    if (breaker_cb)
+        breaker_cb(dev, state);
+}
+
+static inline bool breaker_open(const i2c_dev_t *dev)
+{
+    return dev->breaker.state == I2C_DEV_BREAKER_OPEN
+        && xTaskGetTickCount() - dev->breaker.opened < dev->breaker.backoff;
+}
+
+/**
+ * true if a device of the segments fails fast. Also checked before the
+ * port mutex is taken, counters may race with the owner then.
+ */
+static bool breaker_reject(const i2c_dev_seg_t *segs, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+        if (breaker_open(segs[i].dev))
+        {
+            DEV_BREAKER(segs[i].dev)->rejected++;
+            return true;
+        }
+    return false;
+}
+
+/**
+ * Admit a transaction, devices whose backoff has ended are probed by it
+ */
+static bool breaker_admit(const i2c_dev_seg_t *segs, size_t count)
+{
+    if (breaker_reject(segs, count))
+        return false;
+    for (size_t i = 0; i < count; i++)
+        if (segs[i].dev->breaker.state == I2C_DEV_BREAKER_OPEN)
+            breaker_set(segs[i].dev, I2C_DEV_BREAKER_HALF_OPEN);
+    return true;
+}
+
+static void breaker_update(const i2c_dev_seg_t *segs, size_t count, esp_err_t res)
+{
+    bool failed = res == ESP_FAIL || res == ESP_ERR_TIMEOUT;
+    // Other errors say nothing about the device
+    if (res != ESP_OK && !failed)
+        return;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        const i2c_dev_t *dev = segs[i].dev;
+        i2c_dev_breaker_t *b = DEV_BREAKER(dev);
+        bool seen = false;
+        for (size_t j = 0; j < i && !seen; j++)
+            seen = segs[j].dev == dev;
+        if (seen)
+            continue;
+
+        if (!failed)
+        {
+            b->failures = 0;
+            if (b->state != I2C_DEV_BREAKER_CLOSED)
+            {
+                b->recoveries++;
+                b->backoff = 0;
+                breaker_set(dev, I2C_DEV_BREAKER_CLOSED);
+                ESP_LOGI(TAG, "[0x%02x at %d] Device is back", dev->addr, dev->port);
+            }
+            continue;
+        }
+
+        if (b->failures < UINT8_MAX)
+            b->failures++;
+        if (b->state == I2C_DEV_BREAKER_HALF_OPEN
+                || (b->state == I2C_DEV_BREAKER_CLOSED && b->failures >= CONFIG_I2CDEV_BREAKER_THRESHOLD))
+        {
+            TickType_t max = pdMS_TO_TICKS(CONFIG_I2CDEV_BREAKER_BACKOFF_MAX_MS);
+            b->backoff = b->backoff ? b->backoff * 2 : pdMS_TO_TICKS(CONFIG_I2CDEV_BREAKER_BACKOFF_MS);
+            if (b->backoff > max)
+                b->backoff = max;
+            if (!b->backoff)
+                b->backoff = 1;
+            b->opened = xTaskGetTickCount();
+            b->trips++;
+            breaker_set(dev, I2C_DEV_BREAKER_OPEN);
+            ESP_LOGW(TAG, "[0x%02x at %d] %u failures, failing fast for %u ms", dev->addr, dev->port,
+                    b->failures, (unsigned)pdTICKS_TO_MS(b->backoff));
+        }
+    }
+}
+
+#else
+
+static inline bool breaker_reject(const i2c_dev_seg_t *segs, size_t count) { return false; }
+static inline bool breaker_admit(const i2c_dev_seg_t *segs, size_t count) { return true; }
+static inline void breaker_update(const i2c_dev_seg_t *segs, size_t count, esp_err_t res) {}
+
+#endif /* CONFIG_I2CDEV_BREAKER */
+
+/**
+ * Time budget of a call, from the call or request submission
+ */
+typedef struct {
+    TickType_t start;
+    TickType_t ticks;  // portMAX_DELAY: wait for the port forever
+} budget_t;
+
+static inline TickType_t dev_timeout(const i2c_dev_t *dev, TickType_t ticks)
+{
+    if (ticks)
+        return ticks;
+    return dev->timeout ? dev->timeout : pdMS_TO_TICKS(CONFIG_I2CDEV_TIMEOUT);
+}
+
+static TickType_t budget_left(const budget_t *budget)
+{
+    if (budget->ticks == portMAX_DELAY)
+        return portMAX_DELAY;
+    TickType_t elapsed = xTaskGetTickCount() - budget->start;
+    return elapsed < budget->ticks ? budget->ticks - elapsed : 0;
+}
+
+#if CONFIG_I2CDEV_ASYNC
+static void port_worker(void *arg);
+#endif
+
 esp_err_t i2cdev_init()
 {
     memset(states, 0, sizeof(states));
@@ -51,6 +513,18 @@ esp_err_t i2cdev_init()
             ESP_LOGE(TAG, "Could not create port mutex %d", i);
             return ESP_FAIL;
         }
+#if CONFIG_I2CDEV_ASYNC
+        char name[] = "i2cdev_0";
+        name[sizeof(name) - 2] += i;
+        states[i].queue = xQueueCreate(CONFIG_I2CDEV_ASYNC_QUEUE_LEN, sizeof(i2c_dev_req_t *));
+        if (!states[i].queue
+                || xTaskCreate(port_worker, name, CONFIG_I2CDEV_ASYNC_TASK_STACK, &states[i],
+                        CONFIG_I2CDEV_ASYNC_TASK_PRIORITY, &states[i].worker) != pdPASS)
+        {
+            ESP_LOGE(TAG, "Could not create worker for port %d", i);
+            return ESP_FAIL;
+        }
+#endif
     }
 
     return ESP_OK;
@@ -62,19 +536,108 @@ esp_err_t i2cdev_done()
     {
         if (!states[i].lock) continue;
 
+#if CONFIG_I2CDEV_ASYNC
+        if (states[i].worker)
+        {
+            // Worker stops after the requests already queued
+            const i2c_dev_req_t *stop = NULL;
+            states[i].stopper = xTaskGetCurrentTaskHandle();
+            xQueueSend(states[i].queue, &stop, portMAX_DELAY);
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            states[i].worker = NULL;
+        }
+        if (states[i].queue)
+        {
+            vQueueDelete(states[i].queue);
+            states[i].queue = NULL;
+        }
+#endif
+
         if (states[i].installed)
         {
             SEMAPHORE_TAKE(i);
-            i2c_driver_delete(i);
+            i2cdev_backend_uninstall(i);
             states[i].installed = false;
+            states[i].bus = NULL;
             SEMAPHORE_GIVE(i);
         }
         vSemaphoreDelete(states[i].lock);
         states[i].lock = NULL;
+#if CONFIG_I2CDEV_TRACE
+        free(states[i].trace);
+        states[i].trace = NULL;
+        states[i].tracing = false;
+#endif
+    }
+    return ESP_OK;
+}
+
+#if CONFIG_I2CDEV_SINGLE_LOCK
+
+/*
+ * Device mutexes are the port lock: the driver operation holds the port
+ * and the transfers it makes skip taking it.
+ */
+
+esp_err_t i2c_dev_create_mutex(i2c_dev_t *dev)
+{
+    if (!dev) return ESP_ERR_INVALID_ARG;
+
+    dev->mutex = NULL;
+    return ESP_OK;
+}
+
+esp_err_t i2c_dev_delete_mutex(i2c_dev_t *dev)
+{
+    return dev ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t i2c_dev_take_mutex(i2c_dev_t *dev)
+{
+    if (!dev || dev->port >= I2C_NUM_MAX) return ESP_ERR_INVALID_ARG;
+
+    i2c_port_state_t *state = &states[dev->port];
+    if (port_held(dev->port))
+    {
+        state->depth++;
+        return ESP_OK;
     }
+
+    i2c_dev_prio_t prio = dev_prio(dev, 0);
+    int64_t t = stats_now();
+    bool locked = port_take(dev->port, prio, pdMS_TO_TICKS(CONFIG_I2CDEV_TIMEOUT));
+    stats_lock_wait(dev, t, locked);
+    stats_prio_wait(dev->port, prio, t, locked);
+    if (!locked)
+    {
+        ESP_LOGE(TAG, "[0x%02x at %d] Could not take port mutex", dev->addr, dev->port);
+        return ESP_ERR_TIMEOUT;
+    }
+    state->holder = xTaskGetCurrentTaskHandle();
+    state->depth = 1;
+
     return ESP_OK;
 }
 
+esp_err_t i2c_dev_give_mutex(i2c_dev_t *dev)
+{
+    if (!dev || dev->port >= I2C_NUM_MAX) return ESP_ERR_INVALID_ARG;
+
+    i2c_port_state_t *state = &states[dev->port];
+    if (!port_held(dev->port))
+    {
+        ESP_LOGE(TAG, "[0x%02x at %d] Could not give device mutex", dev->addr, dev->port);
+        return ESP_FAIL;
+    }
+    if (--state->depth)
+        return ESP_OK;
+    state->holder = NULL;
+
+    return port_give(dev->port) ? ESP_OK : ESP_FAIL;
+}
+
+#else
+
 esp_err_t i2c_dev_create_mutex(i2c_dev_t *dev)
 {
     if (!dev) return ESP_ERR_INVALID_ARG;
@@ -129,6 +692,8 @@ esp_err_t i2c_dev_give_mutex(i2c_dev_t *dev)
     return ESP_OK;
 }
 
+#endif /* CONFIG_I2CDEV_SINGLE_LOCK */
+
 inline static bool cfg_equal(const i2c_config_t *a, const i2c_config_t *b)
 {
     return a->scl_io_num == b->scl_io_num
@@ -142,112 +707,461 @@ inline static bool cfg_equal(const i2c_config_t *a, const i2c_config_t *b)
         && a->sda_pullup_en == b->sda_pullup_en;
 }
 
+static inline uint32_t bus_timeout(const i2c_bus_t *bus)
+{
+    // Timeout cannot be 0
+    return bus->timeout_ticks ? bus->timeout_ticks : I2CDEV_MAX_STRETCH_TIME;
+}
+
+esp_err_t i2c_dev_attach(i2c_dev_t *dev, i2c_port_t port, const i2c_config_t *cfg, uint32_t timeout_ticks)
+{
+    if (!dev || !cfg || port >= I2C_NUM_MAX) return ESP_ERR_INVALID_ARG;
+
+    i2c_config_t temp;
+    memcpy(&temp, cfg, sizeof(i2c_config_t));
+    temp.mode = I2C_MODE_MASTER;
+#if HELPER_TARGET_IS_ESP8266 && HELPER_TARGET_VERSION > HELPER_TARGET_VERSION_ESP8266_V3_2
+    // Clock Stretch time, depending on CPU frequency
+    temp.clk_stretch_tick = timeout_ticks ? timeout_ticks : I2CDEV_MAX_STRETCH_TIME;
+#endif
+
+    i2c_bus_t *bus = NULL;
+    vTaskSuspendAll();
+    for (int i = 0; i < CONFIG_I2CDEV_MAX_BUSES; i++)
+    {
+        if (buses[i].refs && buses[i].port == port && buses[i].timeout_ticks == timeout_ticks
+                && cfg_equal(&buses[i].cfg, &temp))
+        {
+            bus = &buses[i];
+            break;
+        }
+        if (!buses[i].refs && !bus)
+            bus = &buses[i];
+    }
+    if (bus && !bus->refs)
+    {
+        bus->port = port;
+        bus->timeout_ticks = timeout_ticks;
+        memcpy(&bus->cfg, &temp, sizeof(i2c_config_t));
+    }
+    if (bus)
+        bus->refs++;
+    xTaskResumeAll();
+
+    if (!bus)
+    {
+        ESP_LOGE(TAG, "[0x%02x at %d] No free bus configuration slots", dev->addr, port);
+        return ESP_ERR_NO_MEM;
+    }
+
+    // Descriptor may be uninitialized, its previous bus is left alone
+    dev->port = port;
+    dev->bus = bus;
+
+    return ESP_OK;
+}
+
+esp_err_t i2c_dev_detach(i2c_dev_t *dev)
+{
+    if (!dev || !dev->bus) return ESP_ERR_INVALID_ARG;
+
+    i2c_bus_t *bus = (i2c_bus_t *)dev->bus;
+    vTaskSuspendAll();
+    // A free slot may be reused for another config, port must not keep it as applied
+    if (!--bus->refs && states[bus->port].bus == bus)
+        states[bus->port].bus = NULL;
+    xTaskResumeAll();
+    dev->bus = NULL;
+
+    return ESP_OK;
+}
+
 static esp_err_t i2c_setup_port(const i2c_dev_t *dev)
 {
-    if (dev->port >= I2C_NUM_MAX) return ESP_ERR_INVALID_ARG;
+    i2c_port_state_t *state = &states[dev->port];
+
+    // Buses are interned: same bus, same config and timeout
+    if (state->bus == dev->bus)
+        return dev->bus ? ESP_OK : ESP_ERR_INVALID_STATE;
+
+    const i2c_bus_t *bus = dev->bus;
+    if (!bus) return ESP_ERR_INVALID_STATE;
 
     esp_err_t res;
-    if (!cfg_equal(&dev->cfg, &states[dev->port].config))
+    if (state->installed && !cfg_equal(&bus->cfg, &state->config))
     {
-        ESP_LOGD(TAG, "Reconfiguring I2C driver on port %d", dev->port);
-        i2c_config_t temp;
-        memcpy(&temp, &dev->cfg, sizeof(i2c_config_t));
-        temp.mode = I2C_MODE_MASTER;
-
-        // Driver reinstallation
-        if (states[dev->port].installed)
-            i2c_driver_delete(dev->port);
-#if HELPER_TARGET_IS_ESP32
-        if ((res = i2c_param_config(dev->port, &temp)) != ESP_OK)
+        ESP_LOGD(TAG, "Switching I2C config on port %d", dev->port);
+        if ((res = i2cdev_backend_switch(dev->port, &bus->cfg)) == ESP_OK)
+        {
+            state->cfg_stats.switches++;
+            stats_reconfig(dev);
+            memcpy(&state->config, &bus->cfg, sizeof(i2c_config_t));
+            // i2c_param_config() rewrites the timeout register with the bus timing
+            state->timeout = 0;
+        }
+        else
+        {
+            ESP_LOGW(TAG, "Could not switch I2C config on port %d: %d, reinstalling", dev->port, res);
+            i2cdev_backend_uninstall(dev->port);
+            state->installed = false;
+        }
+    }
+    if (!state->installed)
+    {
+        ESP_LOGD(TAG, "Installing I2C driver on port %d", dev->port);
+        state->timeout = 0;
+        if ((res = i2cdev_backend_install(dev->port, &bus->cfg)) != ESP_OK)
             return res;
-        if ((res = i2c_driver_install(dev->port, temp.mode, 0, 0, 0)) != ESP_OK)
+        state->installed = true;
+        state->cfg_stats.installs++;
+        stats_reconfig(dev);
+
+        memcpy(&state->config, &bus->cfg, sizeof(i2c_config_t));
+        ESP_LOGD(TAG, "I2C driver successfully installed on port %d", dev->port);
+    }
+    // Applied timeout is cached, no need to read it back from hardware
+    uint32_t ticks = bus_timeout(bus);
+    if (ticks != state->timeout)
+    {
+        if ((res = i2cdev_backend_set_timeout(dev->port, ticks)) != ESP_OK)
             return res;
+        state->timeout = ticks;
+        state->cfg_stats.timeouts++;
+        stats_reconfig(dev);
+        ESP_LOGD(TAG, "Timeout: ticks = %u (%u usec) on port %d", ticks, ticks / 80, dev->port);
+    }
+    state->bus = bus;
+
+    return ESP_OK;
+}
+
+static inline bool seg_chainable(const i2c_dev_seg_t *a, const i2c_dev_seg_t *b)
+{
+    return a->dev->bus == b->dev->bus;
+}
+
+/**
+ * Run segments as one bus transaction
+ */
+static esp_err_t chunk_begin(i2c_dev_seg_t *segs, size_t count, const budget_t *budget)
+{
+    const i2c_dev_t *dev = segs[0].dev;
+
+    if (!breaker_admit(segs, count))
+        return ESP_ERR_INVALID_STATE;
+
+    esp_err_t res = i2c_setup_port(dev);
+    if (res != ESP_OK)
+        return res;
+
+    TickType_t left = budget_left(budget);
+    if (!left)
+        return ESP_ERR_TIMEOUT;
+
+    int64_t t = stats_now();
+    res = i2cdev_backend_xfer(dev->port, segs, count,
+            left == portMAX_DELAY ? pdMS_TO_TICKS(CONFIG_I2CDEV_TIMEOUT) : left);
+    stats_chunk(segs, count, res, t);
+    trace_chunk(segs, count, res, t);
+    breaker_update(segs, count, res);
+
+    return res;
+}
+
+/**
+ * Run segments in as few bus transactions as possible. Port mutex must be taken.
+ */
+static esp_err_t segs_begin(i2c_dev_seg_t *segs, size_t count, const budget_t *budget)
+{
+    esp_err_t res = ESP_OK;
+    size_t i = 0;
+
+    while (i < count)
+    {
+        // Extend chunk until a completion callback, a config change or a full transaction
+        size_t n = 1;
+        while (i + n < count && !segs[i + n - 1].done && seg_chainable(&segs[i], &segs[i + n])
+                && i2cdev_backend_fits(&segs[i], n + 1))
+            n++;
+
+        res = chunk_begin(&segs[i], n, budget);
+        if (res != ESP_OK)
+            ESP_LOGE(TAG, "Could not %s device [0x%02x at %d]: %d", segs[i].read ? "read from" : "write to",
+                    segs[i].dev->addr, segs[i].dev->port, res);
+        for (size_t j = 0; j < n; j++)
+            segs[i + j].result = res;
+        i += n;
+
+        if (res == ESP_OK && segs[i - 1].done)
+            res = segs[i - 1].done(&segs[i - 1]);
+        if (res != ESP_OK)
+            break;
+    }
+    for (; i < count; i++)
+        segs[i].result = ESP_ERR_INVALID_STATE;
+
+    return res;
+}
+
+static esp_err_t segs_check(const i2c_dev_seg_t *segs, size_t count)
+{
+    if (!segs || !count) return ESP_ERR_INVALID_ARG;
+
+    for (size_t i = 0; i < count; i++)
+        if (!segs[i].dev || !segs[i].data || !segs[i].size || segs[i].dev->port != segs[0].dev->port)
+            return ESP_ERR_INVALID_ARG;
+
+    return segs[0].dev->port < I2C_NUM_MAX ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+/**
+ * Take the port and run segments, \p since is the time of the call or
+ * request submission for per-class wait statistics
+ */
+static esp_err_t segs_run_locked(i2c_dev_seg_t *segs, size_t count, const budget_t *budget,
+        i2c_dev_prio_t prio, int64_t since)
+{
+    i2c_port_t port = segs[0].dev->port;
+
+    // Inside a driver operation the port is taken already
+    if (port_held(port))
+        return segs_begin(segs, count, budget);
+
+    int64_t t = stats_now();
+    bool locked = port_take(port, prio, budget_left(budget));
+    stats_lock_wait(segs[0].dev, t, locked);
+    stats_prio_wait(port, prio, since, locked);
+    if (!locked)
+    {
+        ESP_LOGE(TAG, "Could not take port mutex %d", port);
+        return ESP_ERR_TIMEOUT;
+    }
+    esp_err_t res = segs_begin(segs, count, budget);
+    SEMAPHORE_GIVE(port);
+
+    return res;
+}
+
+static esp_err_t req_run(i2c_dev_req_t *req)
+{
+    budget_t budget = { req->submitted, dev_timeout(req->segs[0].dev, req->timeout) };
+#if CONFIG_I2CDEV_STATS
+    int64_t since = req->submitted_us;
+#else
+    int64_t since = 0;
 #endif
-#if HELPER_TARGET_IS_ESP8266
-#if HELPER_TARGET_VERSION > HELPER_TARGET_VERSION_ESP8266_V3_2
-        // Clock Stretch time, depending on CPU frequency
-        temp.clk_stretch_tick = dev->timeout_ticks ? dev->timeout_ticks : I2CDEV_MAX_STRETCH_TIME;
+    return segs_run_locked(req->segs, req->count, &budget, dev_prio(req->segs[0].dev, req->prio), since);
+}
+
+static void req_complete(i2c_dev_req_t *req, esp_err_t res)
+{
+    i2c_dev_req_cb_t callback = req->callback;
+    TaskHandle_t notify = req->notify;
+
+    // Request belongs to the caller again once it is not busy
+    req->result = res;
+    req->busy = false;
+
+    if (callback)
+        callback(req);
+    if (notify)
+        xTaskNotifyGive(notify);
+}
+
+#if CONFIG_I2CDEV_ASYNC
+
+/**
+ * Request taken from the queue, with the round of queue draining it came in
+ */
+typedef struct {
+    i2c_dev_req_t *req;
+    uint32_t round;
+} pending_t;
+
+/**
+ * true if pending request \p a is to be served before \p b
+ */
+static bool pending_before(const i2c_port_state_t *state, const pending_t *a, const pending_t *b)
+{
+#if CONFIG_I2CDEV_PRIORITY
+    i2c_dev_prio_t pa = dev_prio(a->req->segs[0].dev, a->req->prio);
+    i2c_dev_prio_t pb = dev_prio(b->req->segs[0].dev, b->req->prio);
+    if (pa != pb)
+        return pa > pb;
 #endif
-        if ((res = i2c_driver_install(dev->port, temp.mode)) != ESP_OK)
-            return res;
-        if ((res = i2c_param_config(dev->port, &temp)) != ESP_OK)
-            return res;
+    if (a->round != b->round)
+        return (int32_t)(a->round - b->round) < 0;
+#if CONFIG_I2CDEV_ASYNC_GROUP_BY_BUS
+    bool ab = a->req->segs[0].dev->bus == state->bus;
+    bool bb = b->req->segs[0].dev->bus == state->bus;
+    if (ab != bb)
+        return ab;
 #endif
-        states[dev->port].installed = true;
+    // Same class, round and bus: order of arrival
+    return false;
+}
+
+static i2c_dev_req_t *pending_take(i2c_port_state_t *state, pending_t *pending, size_t *count)
+{
+    size_t next = 0;
+    for (size_t i = 1; i < *count; i++)
+        if (pending_before(state, &pending[i], &pending[next]))
+            next = i;
+
+    i2c_dev_req_t *req = pending[next].req;
+    (*count)--;
+    memmove(&pending[next], &pending[next + 1], (*count - next) * sizeof(pending_t));
+
+    return req;
+}
 
-        memcpy(&states[dev->port].config, &temp, sizeof(i2c_config_t));
-        ESP_LOGD(TAG, "I2C driver successfully reconfigured on port %d", dev->port);
+static void port_worker(void *arg)
+{
+    i2c_port_state_t *state = arg;
+    pending_t pending[CONFIG_I2CDEV_ASYNC_QUEUE_LEN];
+    size_t count = 0;
+    uint32_t round = 0;
+    bool running = true;
+    i2c_dev_req_t *req;
+
+    while (running || count)
+    {
+        /*
+         * Queue is drained before every request, so that a higher class is
+         * served next. Within a class older rounds go first: grouping by
+         * bus makes no bus wait longer than one round.
+         */
+        bool received = false;
+        while (running && count < CONFIG_I2CDEV_ASYNC_QUEUE_LEN
+                && xQueueReceive(state->queue, &req, count ? 0 : portMAX_DELAY) == pdTRUE)
+        {
+            if (req)
+                pending[count++] = (pending_t) { req, round };
+            else
+                running = false;
+            received = true;
+        }
+        if (received)
+            round++;
+        if (count)
+        {
+            req = pending_take(state, pending, &count);
+            req_complete(req, req_run(req));
+        }
+    }
+
+    xTaskNotifyGive(state->stopper);
+    vTaskDelete(NULL);
+}
+
+static esp_err_t req_submit(i2c_dev_req_t *req, TickType_t ticks)
+{
+    i2c_port_t port = req->segs[0].dev->port;
+
+    if (!states[port].queue) return ESP_ERR_INVALID_STATE;
+
+    req->busy = true;
+    if (xQueueSend(states[port].queue, &req, ticks) != pdTRUE)
+    {
+        req->busy = false;
+        ESP_LOGE(TAG, "Request queue of port %d is full", port);
+        return ESP_ERR_NO_MEM;
     }
-#if HELPER_TARGET_IS_ESP32
-    int t;
-    if ((res = i2c_get_timeout(dev->port, &t)) != ESP_OK)
-        return res;
-    // Timeout cannot be 0
-    uint32_t ticks = dev->timeout_ticks ? dev->timeout_ticks : I2CDEV_MAX_STRETCH_TIME;
-    if ((ticks != t) && (res = i2c_set_timeout(dev->port, ticks)) != ESP_OK)
-        return res;
-    ESP_LOGD(TAG, "Timeout: ticks = %d (%d usec) on port %d", dev->timeout_ticks, dev->timeout_ticks / 80, dev->port);
-#endif
 
     return ESP_OK;
 }
 
-esp_err_t i2c_dev_read(const i2c_dev_t *dev, const void *out_data, size_t out_size, void *in_data, size_t in_size)
+static void req_signal(i2c_dev_req_t *req)
 {
-    if (!dev || !in_data || !in_size) return ESP_ERR_INVALID_ARG;
+    xSemaphoreGive((SemaphoreHandle_t)req->arg);
+}
 
-    SEMAPHORE_TAKE(dev->port);
+#endif /* CONFIG_I2CDEV_ASYNC */
 
-    esp_err_t res = i2c_setup_port(dev);
-    if (res == ESP_OK)
+/**
+ * Run segments on behalf of a blocking call
+ */
+static esp_err_t segs_run(i2c_dev_seg_t *segs, size_t count, TickType_t ticks)
+{
+    // Dead devices fail fast, without waiting for the port
+    if (breaker_reject(segs, count))
+        return ESP_ERR_INVALID_STATE;
+
+    budget_t budget = { xTaskGetTickCount(), dev_timeout(segs[0].dev, ticks) };
+    int64_t since = stats_now();
+#if CONFIG_I2CDEV_ASYNC
+    // Calls made from completion callbacks already run in the worker
+    if (xTaskGetCurrentTaskHandle() != states[segs[0].dev->port].worker)
     {
-        i2c_cmd_handle_t cmd = i2c_cmd_link_create();
-        if (out_data && out_size)
+        StaticSemaphore_t sem_buf;
+        i2c_dev_req_t req = {
+            .segs = segs,
+            .count = count,
+            .callback = req_signal,
+            .arg = xSemaphoreCreateBinaryStatic(&sem_buf),
+            .timeout = budget.ticks,
+            .submitted = budget.start,
+#if CONFIG_I2CDEV_STATS
+            .submitted_us = since,
+#endif
+        };
+
+        esp_err_t res = req_submit(&req, budget_left(&budget));
+        if (res == ESP_OK)
         {
-            i2c_master_start(cmd);
-            i2c_master_write_byte(cmd, dev->addr << 1, true);
-            i2c_master_write(cmd, (void *)out_data, out_size, true);
+            // Worker completes every request within its time budget
+            xSemaphoreTake((SemaphoreHandle_t)req.arg, portMAX_DELAY);
+            res = req.result;
         }
-        i2c_master_start(cmd);
-        i2c_master_write_byte(cmd, (dev->addr << 1) | 1, true);
-        i2c_master_read(cmd, in_data, in_size, I2C_MASTER_LAST_NACK);
-        i2c_master_stop(cmd);
-
-        res = i2c_master_cmd_begin(dev->port, cmd, pdMS_TO_TICKS(CONFIG_I2CDEV_TIMEOUT));
-        if (res != ESP_OK)
-            ESP_LOGE(TAG, "Could not read from device [0x%02x at %d]: %d", dev->addr, dev->port, res);
+        vSemaphoreDelete((SemaphoreHandle_t)req.arg);
 
-        i2c_cmd_link_delete(cmd);
+        return res;
     }
+#endif
+    return segs_run_locked(segs, count, &budget, dev_prio(segs[0].dev, 0), since);
+}
 
-    SEMAPHORE_GIVE(dev->port);
-    return res;
+static esp_err_t seg_run(const i2c_dev_t *dev, bool read, const void *out, size_t out_size,
+        void *data, size_t size, TickType_t ticks)
+{
+    i2c_dev_seg_t seg = {
+        .dev = dev,
+        .read = read,
+        .out = out,
+        .out_size = out_size,
+        .data = data,
+        .size = size,
+    };
+
+    if (dev->port >= I2C_NUM_MAX) return ESP_ERR_INVALID_ARG;
+
+    return segs_run(&seg, 1, ticks);
 }
 
-esp_err_t i2c_dev_write(const i2c_dev_t *dev, const void *out_reg, size_t out_reg_size, const void *out_data, size_t out_size)
+esp_err_t i2c_dev_read_timeout(const i2c_dev_t *dev, const void *out_data, size_t out_size,
+        void *in_data, size_t in_size, TickType_t ticks)
+{
+    if (!dev || !in_data || !in_size) return ESP_ERR_INVALID_ARG;
+
+    return seg_run(dev, true, out_data, out_size, in_data, in_size, ticks);
+}
+
+esp_err_t i2c_dev_write_timeout(const i2c_dev_t *dev, const void *out_reg, size_t out_reg_size,
+        const void *out_data, size_t out_size, TickType_t ticks)
 {
     if (!dev || !out_data || !out_size) return ESP_ERR_INVALID_ARG;
 
-    SEMAPHORE_TAKE(dev->port);
+    return seg_run(dev, false, out_reg, out_reg_size, (void *)out_data, out_size, ticks);
+}
 
-    esp_err_t res = i2c_setup_port(dev);
-    if (res == ESP_OK)
-    {
-        i2c_cmd_handle_t cmd = i2c_cmd_link_create();
-        i2c_master_start(cmd);
-        i2c_master_write_byte(cmd, dev->addr << 1, true);
-        if (out_reg && out_reg_size)
-            i2c_master_write(cmd, (void *)out_reg, out_reg_size, true);
-        i2c_master_write(cmd, (void *)out_data, out_size, true);
-        i2c_master_stop(cmd);
-        res = i2c_master_cmd_begin(dev->port, cmd, pdMS_TO_TICKS(CONFIG_I2CDEV_TIMEOUT));
-        if (res != ESP_OK)
-            ESP_LOGE(TAG, "Could not write to device [0x%02x at %d]: %d", dev->addr, dev->port, res);
-        i2c_cmd_link_delete(cmd);
-    }
+esp_err_t i2c_dev_read(const i2c_dev_t *dev, const void *out_data, size_t out_size, void *in_data, size_t in_size)
+{
+    return i2c_dev_read_timeout(dev, out_data, out_size, in_data, in_size, 0);
+}
 
-    SEMAPHORE_GIVE(dev->port);
-    return res;
+esp_err_t i2c_dev_write(const i2c_dev_t *dev, const void *out_reg, size_t out_reg_size, const void *out_data, size_t out_size)
+{
+    return i2c_dev_write_timeout(dev, out_reg, out_reg_size, out_data, out_size, 0);
 }
 
 esp_err_t i2c_dev_read_reg(const i2c_dev_t *dev, uint8_t reg,
@@ -261,3 +1175,283 @@ esp_err_t i2c_dev_write_reg(const i2c_dev_t *dev, uint8_t reg,
 {
     return i2c_dev_write(dev, &reg, 1, out_data, out_size);
 }
+
+static esp_err_t xfer_prepare(i2c_dev_xfer_t *xfer, const i2c_dev_t *dev, bool read,
+        const void *out_data, size_t out_size, size_t size)
+{
+    if (!xfer || !dev || !size || (out_size && !out_data)) return ESP_ERR_INVALID_ARG;
+    if (dev->port >= I2C_NUM_MAX || out_size > I2CDEV_XFER_OUT_MAX) return ESP_ERR_INVALID_SIZE;
+
+    xfer->dev = dev;
+    xfer->read = read;
+    xfer->out_size = out_size;
+    xfer->size = size;
+    if (out_size)
+        memcpy(xfer->out, out_data, out_size);
+
+    return ESP_OK;
+}
+
+esp_err_t i2c_dev_prepare_read(i2c_dev_xfer_t *xfer, const i2c_dev_t *dev,
+        const void *out_data, size_t out_size, size_t in_size)
+{
+    return xfer_prepare(xfer, dev, true, out_data, out_size, in_size);
+}
+
+esp_err_t i2c_dev_prepare_write(i2c_dev_xfer_t *xfer, const i2c_dev_t *dev,
+        const void *out_reg, size_t out_reg_size, size_t out_size)
+{
+    return xfer_prepare(xfer, dev, false, out_reg, out_reg_size, out_size);
+}
+
+esp_err_t i2c_dev_xfer_run(const i2c_dev_xfer_t *xfer, void *data)
+{
+    if (!xfer || !xfer->dev || !data) return ESP_ERR_INVALID_ARG;
+
+    return seg_run(xfer->dev, xfer->read, xfer->out, xfer->out_size, data, xfer->size, 0);
+}
+
+esp_err_t i2c_dev_batch_timeout(i2c_dev_seg_t *segs, size_t count, TickType_t ticks)
+{
+    esp_err_t res = segs_check(segs, count);
+    if (res != ESP_OK) return res;
+
+    return segs_run(segs, count, ticks);
+}
+
+esp_err_t i2c_dev_batch(i2c_dev_seg_t *segs, size_t count)
+{
+    return i2c_dev_batch_timeout(segs, count, 0);
+}
+
+esp_err_t i2c_dev_submit(i2c_dev_req_t *req)
+{
+    if (!req) return ESP_ERR_INVALID_ARG;
+
+    esp_err_t res = segs_check(req->segs, req->count);
+    if (res != ESP_OK) return res;
+
+    req->submitted = xTaskGetTickCount();
+#if CONFIG_I2CDEV_STATS
+    req->submitted_us = stats_now();
+#endif
+    if (breaker_reject(req->segs, req->count))
+    {
+        req->busy = true;
+        req_complete(req, ESP_ERR_INVALID_STATE);
+        return ESP_OK;
+    }
+
+#if CONFIG_I2CDEV_ASYNC
+    return req_submit(req, 0);
+#else
+    // No worker, complete the request in place
+    req->busy = true;
+    req_complete(req, req_run(req));
+    return ESP_OK;
+#endif
+}
+
+esp_err_t i2cdev_get_cfg_stats(i2c_port_t port, i2cdev_cfg_stats_t *stats)
+{
+    if (port >= I2C_NUM_MAX || !stats) return ESP_ERR_INVALID_ARG;
+
+    SEMAPHORE_TAKE(port);
+    *stats = states[port].cfg_stats;
+    SEMAPHORE_GIVE(port);
+
+    return ESP_OK;
+}
+
+esp_err_t i2c_dev_get_stats(i2c_dev_t *dev, i2cdev_stats_t *stats, bool reset)
+{
+    if (!dev || dev->port >= I2C_NUM_MAX) return ESP_ERR_INVALID_ARG;
+
+#if CONFIG_I2CDEV_STATS
+    SEMAPHORE_TAKE(dev->port);
+    if (stats)
+        *stats = dev->stats;
+    if (reset)
+        memset(&dev->stats, 0, sizeof(i2cdev_stats_t));
+    SEMAPHORE_GIVE(dev->port);
+
+    return ESP_OK;
+#else
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+esp_err_t i2cdev_get_port_stats(i2c_port_t port, i2cdev_stats_t *stats, bool reset)
+{
+    if (port >= I2C_NUM_MAX) return ESP_ERR_INVALID_ARG;
+
+#if CONFIG_I2CDEV_STATS
+    SEMAPHORE_TAKE(port);
+    if (stats)
+        *stats = states[port].stats;
+    if (reset)
+        memset(&states[port].stats, 0, sizeof(i2cdev_stats_t));
+    SEMAPHORE_GIVE(port);
+
+    return ESP_OK;
+#else
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+esp_err_t i2cdev_get_prio_stats(i2c_port_t port, i2c_dev_prio_t prio, i2cdev_prio_stats_t *stats, bool reset)
+{
+    if (port >= I2C_NUM_MAX || prio < I2C_DEV_PRIO_BULK || prio > I2C_DEV_PRIO_REALTIME)
+        return ESP_ERR_INVALID_ARG;
+
+#if CONFIG_I2CDEV_STATS
+    SEMAPHORE_TAKE(port);
+    if (stats)
+        *stats = states[port].prio_stats[prio - 1];
+    if (reset)
+        memset(&states[port].prio_stats[prio - 1], 0, sizeof(i2cdev_prio_stats_t));
+    SEMAPHORE_GIVE(port);
+
+    return ESP_OK;
+#else
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+esp_err_t i2cdev_trace_start(i2c_port_t port, size_t records)
+{
+    if (port >= I2C_NUM_MAX || !records || records > UINT32_MAX / sizeof(i2cdev_trace_rec_t))
+        return ESP_ERR_INVALID_ARG;
+
+#if CONFIG_I2CDEV_TRACE
+    i2c_port_state_t *state = &states[port];
+
+    SEMAPHORE_TAKE(port);
+    if (state->trace_size != records)
+    {
+        free(state->trace);
+        state->trace = malloc(records * sizeof(i2cdev_trace_rec_t));
+        state->trace_size = state->trace ? records : 0;
+    }
+    state->trace_written = 0;
+    state->tracing = state->trace != NULL;
+    SEMAPHORE_GIVE(port);
+
+    if (!state->tracing)
+    {
+        ESP_LOGE(TAG, "Could not allocate trace of %u records for port %d", (unsigned)records, port);
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+#else
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+esp_err_t i2cdev_trace_stop(i2c_port_t port)
+{
+    if (port >= I2C_NUM_MAX) return ESP_ERR_INVALID_ARG;
+
+#if CONFIG_I2CDEV_TRACE
+    SEMAPHORE_TAKE(port);
+    states[port].tracing = false;
+    SEMAPHORE_GIVE(port);
+
+    return ESP_OK;
+#else
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+esp_err_t i2cdev_trace_dump(i2c_port_t port, i2cdev_trace_format_t format, i2cdev_trace_write_cb_t write, void *ctx)
+{
+    if (port >= I2C_NUM_MAX || !write) return ESP_ERR_INVALID_ARG;
+
+#if CONFIG_I2CDEV_TRACE
+    i2c_port_state_t *state = &states[port];
+    esp_err_t res = ESP_OK;
+
+    SEMAPHORE_TAKE(port);
+    if (!state->trace)
+    {
+        SEMAPHORE_GIVE(port);
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    uint32_t count = state->trace_written < state->trace_size ? state->trace_written : state->trace_size;
+    uint32_t first = state->trace_written - count;
+    if (format == I2CDEV_TRACE_BINARY)
+    {
+        i2cdev_trace_hdr_t hdr = {
+            .magic = I2CDEV_TRACE_MAGIC,
+            .version = I2CDEV_TRACE_VERSION,
+            .rec_size = sizeof(i2cdev_trace_rec_t),
+            .payload = I2CDEV_TRACE_PAYLOAD,
+            .port = port,
+            .count = count,
+            .dropped = first,
+        };
+        res = write(&hdr, sizeof(hdr), ctx);
+    }
+    else
+    {
+        static const char header[] = "ts_us,port,addr,dir,joined,out,size,data,result,duration_us,scl_khz\n";
+        res = write(header, sizeof(header) - 1, ctx);
+    }
+
+    for (uint32_t i = first; i < state->trace_written && res == ESP_OK; i++)
+    {
+        const i2cdev_trace_rec_t *rec = &state->trace[i % state->trace_size];
+        res = format == I2CDEV_TRACE_BINARY ? write(rec, sizeof(i2cdev_trace_rec_t), ctx) : trace_csv(rec, write, ctx);
+    }
+    SEMAPHORE_GIVE(port);
+
+    return res;
+#else
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+esp_err_t i2c_dev_get_breaker(i2c_dev_t *dev, i2c_dev_breaker_t *breaker)
+{
+    if (!dev || !breaker || dev->port >= I2C_NUM_MAX) return ESP_ERR_INVALID_ARG;
+
+#if CONFIG_I2CDEV_BREAKER
+    SEMAPHORE_TAKE(dev->port);
+    *breaker = dev->breaker;
+    SEMAPHORE_GIVE(dev->port);
+
+    return ESP_OK;
+#else
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+esp_err_t i2c_dev_reset_breaker(i2c_dev_t *dev)
+{
+    if (!dev || dev->port >= I2C_NUM_MAX) return ESP_ERR_INVALID_ARG;
+
+#if CONFIG_I2CDEV_BREAKER
+    SEMAPHORE_TAKE(dev->port);
+    bool closed = dev->breaker.state == I2C_DEV_BREAKER_CLOSED;
+    memset(&dev->breaker, 0, sizeof(i2c_dev_breaker_t));
+    if (!closed)
+        breaker_set(dev, I2C_DEV_BREAKER_CLOSED);
+    SEMAPHORE_GIVE(dev->port);
+
+    return ESP_OK;
+#else
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+esp_err_t i2cdev_set_breaker_callback(i2c_dev_breaker_cb_t cb)
+{
+#if CONFIG_I2CDEV_BREAKER
+    breaker_cb = cb;
+
+    return ESP_OK;
+#else
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
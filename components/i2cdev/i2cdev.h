@@ -12,8 +12,18 @@
 #ifndef __I2CDEV_H__
 #define __I2CDEV_H__
 
+#include <sdkconfig.h>
+#if CONFIG_I2CDEV_BACKEND_MASTER
+/* Types only: the command link driver header warns on ESP-IDF 5.2+ and its
+ * driver refuses to run next to the master driver */
+#include <hal/i2c_types.h>
+#include <driver/i2c_types.h>
+#include <driver/i2c_types_legacy.h>
+#else
 #include <driver/i2c.h>
+#endif
 #include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
 #include <freertos/semphr.h>
 #include <esp_err.h>
 #include <esp_idf_lib_helpers.h>
@@ -33,20 +43,312 @@ extern "C" {
 #endif
 #endif
 
+#if HELPER_TARGET_IS_ESP32 && HELPER_TARGET_VERSION >= HELPER_TARGET_VERSION_ESP32_V4 && !CONFIG_I2CDEV_BACKEND_MASTER
+#include <esp_idf_version.h>
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(4, 4, 0)
+/* Command links are built in per-port static memory, no heap allocation per transfer */
+#define I2CDEV_STATIC_CMD_LINK 1
+#define I2CDEV_CMD_LINK_BUF_SIZE I2C_LINK_RECOMMENDED_SIZE(CONFIG_I2CDEV_CMD_LINK_TRANSACTIONS)
+#endif
+#endif
+
 /**
- * I2C device descriptor
+ * Number of histogram buckets
+ *
+ * Bucket 0 counts values below ::I2CDEV_HIST_MIN_US, bucket N counts values
+ * from `I2CDEV_HIST_MIN_US << (N - 1)` to `I2CDEV_HIST_MIN_US << N` microseconds,
+ * the last bucket counts everything above.
+ */
+#define I2CDEV_HIST_BUCKETS 16
+#define I2CDEV_HIST_MIN_US 8 //!< Upper bound of histogram bucket 0, microseconds
+
+/**
+ * Fixed-bucket latency histogram
+ */
+typedef struct
+{
+    uint32_t count[I2CDEV_HIST_BUCKETS]; //!< Values per bucket
+    uint32_t max_us;                     //!< Largest value, microseconds
+} i2cdev_hist_t;
+
+/**
+ * Performance counters of a device or a port, see ::i2c_dev_get_stats()
+ */
+typedef struct
+{
+    uint32_t transactions; //!< Bus transactions
+    uint32_t bytes_in;     //!< Bytes read
+    uint32_t bytes_out;    //!< Bytes written, register addresses included
+    uint32_t nacks;        //!< Transactions failed with NACK
+    uint32_t timeouts;     //!< Transactions and port lock waits timed out
+    uint32_t reconfigs;    //!< Driver installations, config switches and timeout updates
+    i2cdev_hist_t lock_wait; //!< Port lock wait time
+    i2cdev_hist_t bus_time;  //!< Transaction time on the bus
+} i2cdev_stats_t;
+
+/**
+ * Priority class of a call or request
+ *
+ * With `CONFIG_I2CDEV_PRIORITY` a port that becomes free is granted to the
+ * waiting transfer of the highest class, in order of arrival within a class.
+ */
+typedef enum
+{
+    I2C_DEV_PRIO_DEFAULT = 0, //!< Class of the device, ::I2C_DEV_PRIO_NORMAL for devices
+    I2C_DEV_PRIO_BULK,        //!< Background transfers, served last
+    I2C_DEV_PRIO_NORMAL,      //!< Regular transfers
+    I2C_DEV_PRIO_REALTIME,    //!< Latency critical transfers, served first
+} i2c_dev_prio_t;
+
+#define I2C_DEV_PRIO_CLASSES 3 //!< Number of priority classes
+
+/**
+ * Port wait counters of a priority class, see ::i2cdev_get_prio_stats()
+ */
+typedef struct
+{
+    uint32_t grants;    //!< Transfers granted the port
+    uint32_t timeouts;  //!< Transfers whose time budget ran out waiting for the port
+    i2cdev_hist_t wait; /*!< Time from call or request submission until the port is
+                             granted, request queueing included */
+} i2cdev_prio_stats_t;
+
+/**
+ * I2C bus configuration
+ *
+ * Configurations are interned: devices attached with ::i2c_dev_attach() to
+ * the same port with equal config and timeout share one bus object, so a
+ * port switches driver settings only when traffic moves to another bus.
+ * Switching is done without driver reinstallation.
  */
 typedef struct
 {
     i2c_port_t port;         //!< I2C port number
     i2c_config_t cfg;        //!< I2C driver configuration
-    uint8_t addr;            //!< Unshifted address
-    SemaphoreHandle_t mutex; //!< Device mutex
     uint32_t timeout_ticks;  /*!< HW I2C bus timeout (stretch time), in ticks. 80MHz APB clock
                                   ticks for ESP-IDF, CPU ticks for ESP8266.
                                   When this value is 0, I2CDEV_MAX_STRETCH_TIME will be used */
+    uint16_t refs;           //!< Number of attached devices
+} i2c_bus_t;
+
+/**
+ * Circuit breaker state of a device
+ */
+typedef enum
+{
+    I2C_DEV_BREAKER_CLOSED = 0, //!< Calls go to the bus
+    I2C_DEV_BREAKER_OPEN,       //!< Calls fail fast until the backoff ends
+    I2C_DEV_BREAKER_HALF_OPEN,  //!< Backoff ended, next call probes the device
+} i2c_dev_breaker_state_t;
+
+/**
+ * Circuit breaker of a device, see ::i2c_dev_get_breaker()
+ *
+ * After `CONFIG_I2CDEV_BREAKER_THRESHOLD` consecutive failed transactions
+ * (NACK or bus timeout) the breaker opens and calls fail with
+ * `ESP_ERR_INVALID_STATE` without waiting for the port. When the backoff
+ * ends, the next call is run as a probe: success closes the breaker,
+ * failure opens it again with the backoff doubled, up to
+ * `CONFIG_I2CDEV_BREAKER_BACKOFF_MAX_MS`.
+ */
+typedef struct
+{
+    i2c_dev_breaker_state_t state; //!< Current state
+    uint8_t failures;              //!< Consecutive failed transactions
+    TickType_t opened;             //!< Tick count when the breaker opened last
+    TickType_t backoff;            //!< Current backoff, ticks
+    uint32_t trips;                //!< Transitions to open, probes included
+    uint32_t rejected;             //!< Calls failed fast
+    uint32_t recoveries;           //!< Successful probes
+} i2c_dev_breaker_t;
+
+struct i2c_regmap_s;
+
+/**
+ * I2C device descriptor
+ */
+typedef struct
+{
+    i2c_port_t port;         //!< I2C port number
+    uint8_t addr;            //!< Unshifted address
+    SemaphoreHandle_t mutex; //!< Device mutex
+    const i2c_bus_t *bus;    //!< Bus configuration, see ::i2c_dev_attach()
+    TickType_t timeout;      /*!< Default time budget of calls, port lock wait and bus
+                                  transactions included, in RTOS ticks. 0 for
+                                  `CONFIG_I2CDEV_TIMEOUT`, `portMAX_DELAY` to wait for
+                                  the port forever */
+    i2c_dev_prio_t prio;     //!< Priority class of calls, 0 for ::I2C_DEV_PRIO_NORMAL
+    struct i2c_regmap_s *regmap; //!< Register cache if non-null, see ::i2c_regmap_init()
+#if CONFIG_I2CDEV_STATS
+    i2cdev_stats_t stats;    //!< Performance counters, see ::i2c_dev_get_stats()
+#endif
+#if CONFIG_I2CDEV_BREAKER
+    i2c_dev_breaker_t breaker; //!< Circuit breaker, see ::i2c_dev_get_breaker()
+#endif
 } i2c_dev_t;
 
+/**
+ * Maximum size of register address / command prefix of a prepared transfer
+ */
+#define I2CDEV_XFER_OUT_MAX 4
+
+/**
+ * Prepared transfer
+ *
+ * Built once for a device with ::i2c_dev_prepare_read() or ::i2c_dev_prepare_write()
+ * and then re-run with ::i2c_dev_xfer_run() on a new data buffer.
+ */
+typedef struct
+{
+    const i2c_dev_t *dev;              //!< Device descriptor
+    bool read;                         //!< true for read transfer, false for write
+    uint8_t out[I2CDEV_XFER_OUT_MAX];  //!< Register address to send before data
+    size_t out_size;                   //!< Size of register address, 0 for none
+    size_t size;                       //!< Size of data buffer
+} i2c_dev_xfer_t;
+
+#if CONFIG_I2CDEV_TRACE
+#define I2CDEV_TRACE_PAYLOAD CONFIG_I2CDEV_TRACE_PAYLOAD
+#else
+#define I2CDEV_TRACE_PAYLOAD 8
+#endif
+
+#define I2CDEV_TRACE_READ   0x01 //!< Trace record flag: read segment
+#define I2CDEV_TRACE_JOINED 0x02 //!< Trace record flag: same bus transaction as the previous record
+
+/**
+ * Trace record of a segment, see ::i2cdev_trace_start()
+ *
+ * Segments joined into one bus transaction get one record each, all but
+ * the first flagged with ::I2CDEV_TRACE_JOINED. Fields up to `data` have
+ * fixed size and order, binary dumps are little endian.
+ */
+typedef struct
+{
+    uint32_t ts_us;       //!< Transaction start, low 32 bits of esp_timer_get_time()
+    uint32_t duration_us; //!< Transaction duration
+    int32_t result;       //!< Transaction result
+    uint16_t size;        //!< Payload size, may exceed the bytes captured in `data`
+    uint16_t scl_khz;     //!< SCL frequency of the bus, 0 if unknown
+    uint8_t port;         //!< I2C port number
+    uint8_t addr;         //!< Device address
+    uint8_t flags;        //!< ::I2CDEV_TRACE_READ, ::I2CDEV_TRACE_JOINED
+    uint8_t out_size;     //!< Size of register address / command prefix
+    uint8_t out[I2CDEV_XFER_OUT_MAX]; //!< Register address / command prefix, truncated
+    uint8_t data[I2CDEV_TRACE_PAYLOAD]; //!< First payload bytes
+} i2cdev_trace_rec_t;
+
+#define I2CDEV_TRACE_MAGIC "I2CT" //!< Magic of binary trace dumps
+#define I2CDEV_TRACE_VERSION 1     //!< Version of binary trace dumps
+
+/**
+ * Header of a binary trace dump, followed by `count` records of `rec_size` bytes
+ */
+typedef struct
+{
+    char magic[4];     //!< ::I2CDEV_TRACE_MAGIC
+    uint16_t version;  //!< ::I2CDEV_TRACE_VERSION
+    uint16_t rec_size; //!< Size of a record
+    uint16_t payload;  //!< Payload bytes captured per record
+    uint16_t port;     //!< I2C port number
+    uint32_t count;    //!< Records following, oldest first
+    uint32_t dropped;  //!< Records overwritten before the dump
+} i2cdev_trace_hdr_t;
+
+/**
+ * Trace dump format
+ */
+typedef enum
+{
+    I2CDEV_TRACE_BINARY = 0, //!< ::i2cdev_trace_hdr_t and raw records
+    I2CDEV_TRACE_CSV,        //!< One line per record, with a header line
+} i2cdev_trace_format_t;
+
+/**
+ * Trace dump output, returns ESP_OK if all \p size bytes were written
+ */
+typedef esp_err_t (*i2cdev_trace_write_cb_t)(const void *data, size_t size, void *ctx);
+
+/**
+ * Driver configuration counters of a port
+ */
+typedef struct
+{
+    uint32_t installs;  //!< Driver installations, including reinstallations
+    uint32_t switches;  //!< Config switches done without driver reinstallation
+    uint32_t timeouts;  //!< HW timeout updates
+} i2cdev_cfg_stats_t;
+
+typedef struct i2c_dev_seg_s i2c_dev_seg_t;
+
+/**
+ * Batch segment completion callback
+ *
+ * Called with port mutex taken, after the segment is transferred and before
+ * the following segments are built, so it may modify their data buffers
+ * (e.g. for read-modify-write). Returning an error stops the batch.
+ */
+typedef esp_err_t (*i2c_dev_seg_cb_t)(i2c_dev_seg_t *seg);
+
+/**
+ * Batch segment, see ::i2c_dev_batch()
+ */
+struct i2c_dev_seg_s
+{
+    const i2c_dev_t *dev;  //!< Device descriptor
+    bool read;             //!< true for read segment, false for write
+    const void *out;       //!< Register address to send if non-null
+    size_t out_size;       //!< Size of register address
+    void *data;            //!< Data buffer, read into or written from
+    size_t size;           //!< Size of data buffer
+    i2c_dev_seg_cb_t done; //!< Completion callback if non-null
+    void *arg;             //!< User argument for completion callback
+    esp_err_t result;      //!< Result of the segment, set by ::i2c_dev_batch()
+};
+
+typedef struct i2c_dev_req_s i2c_dev_req_t;
+
+/**
+ * Request completion callback
+ *
+ * Called from the port worker task, or from the submitting task without
+ * `CONFIG_I2CDEV_ASYNC`. Blocking i2cdev calls made from it are run in place.
+ */
+typedef void (*i2c_dev_req_cb_t)(i2c_dev_req_t *req);
+
+/**
+ * Asynchronous request, see ::i2c_dev_submit()
+ *
+ * Request and its segments are owned by i2cdev until the request is
+ * complete and must stay valid until then.
+ */
+struct i2c_dev_req_s
+{
+    i2c_dev_seg_t *segs;        //!< Segments to run, as for ::i2c_dev_batch()
+    size_t count;               //!< Number of segments
+    i2c_dev_req_cb_t callback;  //!< Completion callback if non-null
+    void *arg;                  //!< User argument for completion callback
+    TaskHandle_t notify;        //!< Task to notify with xTaskNotifyGive() on completion if non-null
+    TickType_t timeout;         /*!< Time budget from submission, queueing and port lock wait
+                                     included, in RTOS ticks. 0 for the timeout of the first
+                                     device */
+    i2c_dev_prio_t prio;        //!< Priority class, 0 for the class of the first device
+    esp_err_t result;           //!< Result of the request, valid when complete
+    volatile bool busy;         //!< true while the request is queued or running
+    TickType_t submitted;       //!< Tick count of submission, set by ::i2c_dev_submit()
+#if CONFIG_I2CDEV_STATS
+    int64_t submitted_us;       //!< Time of submission, microseconds, set by ::i2c_dev_submit()
+#endif
+};
+
+/**
+ * Breaker state change callback, see ::i2cdev_set_breaker_callback()
+ *
+ * Called with the port mutex taken: it must not block or call i2cdev
+ * functions for the same port.
+ */
+typedef void (*i2c_dev_breaker_cb_t)(const i2c_dev_t *dev, i2c_dev_breaker_state_t state);
+
 /**
  * @brief Init library
  *
@@ -66,6 +368,32 @@ esp_err_t i2cdev_init();
  */
 esp_err_t i2cdev_done();
 
+/**
+ * @brief Attach device to a bus configuration
+ *
+ * Finds the bus with equal \p cfg and \p timeout_ticks on \p port, or
+ * creates one, and references it from the device descriptor. The bus
+ * field of \p dev is overwritten, so the descriptor need not be zeroed,
+ * but the reference of a descriptor attached before is not dropped:
+ * detach it first, see ::i2c_dev_detach().
+ *
+ * @param dev Device descriptor
+ * @param port I2C port number
+ * @param cfg I2C driver configuration, mode is always master
+ * @param timeout_ticks HW I2C bus timeout (stretch time), see ::i2c_bus_t
+ * @return ESP_OK on success, `ESP_ERR_NO_MEM` if all
+ *         `CONFIG_I2CDEV_MAX_BUSES` configurations are in use
+ */
+esp_err_t i2c_dev_attach(i2c_dev_t *dev, i2c_port_t port, const i2c_config_t *cfg, uint32_t timeout_ticks);
+
+/**
+ * @brief Detach device from its bus configuration
+ *
+ * @param dev Device descriptor
+ * @return ESP_OK on success
+ */
+esp_err_t i2c_dev_detach(i2c_dev_t *dev);
+
 /**
  * @brief Create mutex for device descriptor
  *
@@ -85,6 +413,10 @@ esp_err_t i2c_dev_delete_mutex(i2c_dev_t *dev);
 /**
  * @brief Take device mutex
  *
+ * With `CONFIG_I2CDEV_SINGLE_LOCK` the port is taken instead, recursively
+ * for the calling task, and transfers of the task skip the port lock
+ * until the mutex is given back.
+ *
  * @param dev Device descriptor
  * @return ESP_OK on success
  */
@@ -131,6 +463,41 @@ esp_err_t i2c_dev_read(const i2c_dev_t *dev, const void *out_data,
 esp_err_t i2c_dev_write(const i2c_dev_t *dev, const void *out_reg,
         size_t out_reg_size, const void *out_data, size_t out_size);
 
+/**
+ * @brief Read from slave device within a time budget
+ *
+ * Same as ::i2c_dev_read() with an explicit time budget instead of
+ * `dev->timeout`. The budget covers the port lock wait and the bus
+ * transaction; the call fails with `ESP_ERR_TIMEOUT` when it runs out.
+ *
+ * @param dev Device descriptor
+ * @param out_data Pointer to data to send if non-null
+ * @param out_size Size of data to send
+ * @param[out] in_data Pointer to input data buffer
+ * @param in_size Number of byte to read
+ * @param ticks Time budget in RTOS ticks, 0 for `dev->timeout`
+ * @return ESP_OK on success
+ */
+esp_err_t i2c_dev_read_timeout(const i2c_dev_t *dev, const void *out_data,
+        size_t out_size, void *in_data, size_t in_size, TickType_t ticks);
+
+/**
+ * @brief Write to slave device within a time budget
+ *
+ * Same as ::i2c_dev_write() with an explicit time budget, see
+ * ::i2c_dev_read_timeout().
+ *
+ * @param dev Device descriptor
+ * @param out_reg Pointer to register address to send if non-null
+ * @param out_reg_size Size of register address
+ * @param out_data Pointer to data to send
+ * @param out_size Size of data to send
+ * @param ticks Time budget in RTOS ticks, 0 for `dev->timeout`
+ * @return ESP_OK on success
+ */
+esp_err_t i2c_dev_write_timeout(const i2c_dev_t *dev, const void *out_reg,
+        size_t out_reg_size, const void *out_data, size_t out_size, TickType_t ticks);
+
 /**
  * @brief Read from register with an 8-bit address
  *
@@ -159,6 +526,214 @@ esp_err_t i2c_dev_read_reg(const i2c_dev_t *dev, uint8_t reg,
 esp_err_t i2c_dev_write_reg(const i2c_dev_t *dev, uint8_t reg,
         const void *out_data, size_t out_size);
 
+/**
+ * @brief Prepare read transfer
+ *
+ * Register address is copied into the transfer descriptor, so \p out_data
+ * may be freed after this call.
+ *
+ * @param[out] xfer Transfer descriptor
+ * @param dev Device descriptor
+ * @param out_data Pointer to register address to send if non-null
+ * @param out_size Size of register address, up to ::I2CDEV_XFER_OUT_MAX
+ * @param in_size Number of bytes to read on every run
+ * @return ESP_OK on success
+ */
+esp_err_t i2c_dev_prepare_read(i2c_dev_xfer_t *xfer, const i2c_dev_t *dev,
+        const void *out_data, size_t out_size, size_t in_size);
+
+/**
+ * @brief Prepare write transfer
+ *
+ * Register address is copied into the transfer descriptor, so \p out_reg
+ * may be freed after this call.
+ *
+ * @param[out] xfer Transfer descriptor
+ * @param dev Device descriptor
+ * @param out_reg Pointer to register address to send if non-null
+ * @param out_reg_size Size of register address, up to ::I2CDEV_XFER_OUT_MAX
+ * @param out_size Number of bytes to write on every run
+ * @return ESP_OK on success
+ */
+esp_err_t i2c_dev_prepare_write(i2c_dev_xfer_t *xfer, const i2c_dev_t *dev,
+        const void *out_reg, size_t out_reg_size, size_t out_size);
+
+/**
+ * @brief Run prepared transfer
+ *
+ * With ESP-IDF >= 4.4 the command link is built in per-port static memory,
+ * so the transfer does not allocate from heap.
+ * Function is thread-safe.
+ *
+ * @param xfer Prepared transfer
+ * @param data Data buffer, read into or written from, of `xfer->size` bytes
+ * @return ESP_OK on success
+ */
+esp_err_t i2c_dev_xfer_run(const i2c_dev_xfer_t *xfer, void *data);
+
+/**
+ * @brief Run a batch of read and write segments
+ *
+ * Segments are run in order under a single port lock. Consecutive segments
+ * for devices with the same configuration are joined with repeated starts
+ * into one bus transaction, as long as the command link has room and no
+ * completion callback has to run in between. When a transaction fails, all
+ * its segments report the error and following segments are not run and
+ * report `ESP_ERR_INVALID_STATE`.
+ * Function is thread-safe.
+ *
+ * @param segs Segments, all devices must be on the same port
+ * @param count Number of segments
+ * @return ESP_OK if all segments succeeded, first error otherwise
+ */
+esp_err_t i2c_dev_batch(i2c_dev_seg_t *segs, size_t count);
+
+/**
+ * @brief Run a batch within a time budget
+ *
+ * Same as ::i2c_dev_batch() with an explicit time budget for the whole
+ * batch, see ::i2c_dev_read_timeout(). Segments not started when the
+ * budget runs out report `ESP_ERR_TIMEOUT`.
+ *
+ * @param segs Segments, all devices must be on the same port
+ * @param count Number of segments
+ * @param ticks Time budget in RTOS ticks, 0 for the timeout of the first device
+ * @return ESP_OK if all segments succeeded, first error otherwise
+ */
+esp_err_t i2c_dev_batch_timeout(i2c_dev_seg_t *segs, size_t count, TickType_t ticks);
+
+/**
+ * @brief Submit asynchronous request
+ *
+ * With `CONFIG_I2CDEV_ASYNC` every port has a worker task with a bounded
+ * request queue. The request is queued and the function returns at once;
+ * completion is signalled by the request callback, by task notification
+ * and by clearing `req->busy`. Blocking functions of this library are
+ * run through the same queue.
+ *
+ * Without `CONFIG_I2CDEV_ASYNC` the request is run and completed before
+ * the function returns. Requests for a device with an open breaker are
+ * completed at once with `ESP_ERR_INVALID_STATE`.
+ *
+ * @param req Request
+ * @return ESP_OK if the request was queued, `ESP_ERR_NO_MEM` if the
+ *         port queue is full
+ */
+esp_err_t i2c_dev_submit(i2c_dev_req_t *req);
+
+/**
+ * @brief Get driver configuration counters of a port
+ *
+ * Devices with different configs on the same port make the port switch
+ * config when traffic moves between them. Switches are done without driver
+ * reinstallation; `installs` should stay at 1 per port.
+ *
+ * @param port I2C port number
+ * @param[out] stats Counters
+ * @return ESP_OK on success
+ */
+esp_err_t i2cdev_get_cfg_stats(i2c_port_t port, i2cdev_cfg_stats_t *stats);
+
+/**
+ * @brief Get performance counters of a device
+ *
+ * Counters are kept with `CONFIG_I2CDEV_STATS` only. A transaction that
+ * joins several devices counts once for each of them.
+ *
+ * @param dev Device descriptor
+ * @param[out] stats Snapshot of counters if non-null
+ * @param reset Reset counters after the snapshot if true
+ * @return ESP_OK on success, `ESP_ERR_NOT_SUPPORTED` if statistics are disabled
+ */
+esp_err_t i2c_dev_get_stats(i2c_dev_t *dev, i2cdev_stats_t *stats, bool reset);
+
+/**
+ * @brief Get performance counters of a port
+ *
+ * @param port I2C port number
+ * @param[out] stats Snapshot of counters if non-null
+ * @param reset Reset counters after the snapshot if true
+ * @return ESP_OK on success, `ESP_ERR_NOT_SUPPORTED` if statistics are disabled
+ */
+esp_err_t i2cdev_get_port_stats(i2c_port_t port, i2cdev_stats_t *stats, bool reset);
+
+/**
+ * @brief Get port wait counters of a priority class
+ *
+ * Counters are kept with `CONFIG_I2CDEV_STATS` for every class, also
+ * without `CONFIG_I2CDEV_PRIORITY`, so that worst case waits with and
+ * without priority arbitration can be compared.
+ *
+ * @param port I2C port number
+ * @param prio Priority class
+ * @param[out] stats Snapshot of counters if non-null
+ * @param reset Reset counters after the snapshot if true
+ * @return ESP_OK on success, `ESP_ERR_NOT_SUPPORTED` if statistics are disabled
+ */
+esp_err_t i2cdev_get_prio_stats(i2c_port_t port, i2c_dev_prio_t prio, i2cdev_prio_stats_t *stats, bool reset);
+
+/**
+ * @brief Start tracing transactions of a port
+ *
+ * Every bus transaction is recorded into a ring of \p records entries,
+ * the oldest records are overwritten when it is full. The ring is
+ * allocated on the first start and when its size changes; starting again
+ * clears it. Available with `CONFIG_I2CDEV_TRACE`.
+ *
+ * @param port I2C port number
+ * @param records Ring size, records
+ * @return ESP_OK on success, `ESP_ERR_NO_MEM` if the ring cannot be allocated
+ */
+esp_err_t i2cdev_trace_start(i2c_port_t port, size_t records);
+
+/**
+ * @brief Stop tracing, records are kept for dumping
+ *
+ * @param port I2C port number
+ * @return ESP_OK on success
+ */
+esp_err_t i2cdev_trace_stop(i2c_port_t port);
+
+/**
+ * @brief Dump trace of a port, oldest record first
+ *
+ * The port is locked while dumping, stop tracing first to dump to a slow
+ * output without blocking transfers for long.
+ *
+ * @param port I2C port number
+ * @param format Binary or CSV
+ * @param write Output callback
+ * @param ctx User argument for \p write
+ * @return ESP_OK on success, `ESP_ERR_INVALID_STATE` if the port was never traced,
+ *         first error of \p write otherwise
+ */
+esp_err_t i2cdev_trace_dump(i2c_port_t port, i2cdev_trace_format_t format, i2cdev_trace_write_cb_t write, void *ctx);
+
+/**
+ * @brief Get circuit breaker of a device
+ *
+ * @param dev Device descriptor
+ * @param[out] breaker Snapshot of the breaker
+ * @return ESP_OK on success, `ESP_ERR_NOT_SUPPORTED` without `CONFIG_I2CDEV_BREAKER`
+ */
+esp_err_t i2c_dev_get_breaker(i2c_dev_t *dev, i2c_dev_breaker_t *breaker);
+
+/**
+ * @brief Close circuit breaker of a device and clear its counters
+ *
+ * @param dev Device descriptor
+ * @return ESP_OK on success, `ESP_ERR_NOT_SUPPORTED` without `CONFIG_I2CDEV_BREAKER`
+ */
+esp_err_t i2c_dev_reset_breaker(i2c_dev_t *dev);
+
+/**
+ * @brief Set callback for breaker state changes of all devices
+ *
+ * @param cb Callback, NULL to disable
+ * @return ESP_OK on success, `ESP_ERR_NOT_SUPPORTED` without `CONFIG_I2CDEV_BREAKER`
+ */
+esp_err_t i2cdev_set_breaker_callback(i2c_dev_breaker_cb_t cb);
+
 #define I2C_DEV_TAKE_MUTEX(dev) do { \
         esp_err_t __ = i2c_dev_take_mutex(dev); \
         if (__ != ESP_OK) return __;\
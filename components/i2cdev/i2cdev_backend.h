@@ -0,0 +1,57 @@
+/**
+ * @file i2cdev_backend.h
+ *
+ * Bus backend interface of i2cdev, private to the library
+ *
+ * i2cdev core keeps port locks, bus configurations and request queues and
+ * calls exactly one backend, selected at build time, to drive the bus.
+ * All functions are called with the port mutex taken.
+ *
+ * MIT Licensed as described in the file LICENSE
+ */
+#ifndef __I2CDEV_BACKEND_H__
+#define __I2CDEV_BACKEND_H__
+
+#include "i2cdev.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Install driver on the port with config
+ */
+esp_err_t i2cdev_backend_install(i2c_port_t port, const i2c_config_t *cfg);
+
+/**
+ * Apply another config to the installed driver without reinstallation
+ */
+esp_err_t i2cdev_backend_switch(i2c_port_t port, const i2c_config_t *cfg);
+
+/**
+ * Set HW bus timeout (stretch time), never 0
+ */
+esp_err_t i2cdev_backend_set_timeout(i2c_port_t port, uint32_t ticks);
+
+/**
+ * Uninstall driver from the port
+ */
+esp_err_t i2cdev_backend_uninstall(i2c_port_t port);
+
+/**
+ * true if segments fit into one bus transaction
+ */
+bool i2cdev_backend_fits(const i2c_dev_seg_t *segs, size_t count);
+
+/**
+ * Run segments as one bus transaction, joined with repeated starts
+ *
+ * Segments are checked and share the config applied to the port.
+ */
+esp_err_t i2cdev_backend_xfer(i2c_port_t port, const i2c_dev_seg_t *segs, size_t count, TickType_t ticks);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __I2CDEV_BACKEND_H__ */
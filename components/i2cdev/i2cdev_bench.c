@@ -0,0 +1,186 @@
+/**
+ * @file i2cdev_bench.c
+ *
+ * Per-call cost benchmark for i2cdev transfers
+ *
+ * MIT Licensed as described in the file LICENSE
+ */
+#include <esp_log.h>
+#include "i2cdev_bench.h"
+
+#if CONFIG_I2CDEV_BENCHMARK
+
+#include <stdio.h>
+#include <esp_timer.h>
+#if CONFIG_HEAP_TRACING_STANDALONE
+#include <esp_heap_trace.h>
+#endif
+
+#define BENCH_MAX_SIZE 32
+#define BENCH_TRACE_RECORDS 16
+#define BENCH_SPIN_CAL_MS 100
+
+#if CONFIG_I2CDEV_BACKEND_MASTER && CONFIG_I2CDEV_MASTER_ASYNC
+#define BENCH_BACKEND "i2c_master, async"
+#elif CONFIG_I2CDEV_BACKEND_MASTER
+#define BENCH_BACKEND "i2c_master"
+#else
+#define BENCH_BACKEND "command link"
+#endif
+
+static const char *TAG = "i2cdev_bench";
+
+#if I2CDEV_STATIC_CMD_LINK
+static uint8_t cmd_buf[I2CDEV_CMD_LINK_BUF_SIZE] __attribute__((aligned(4)));
+#endif
+
+// CPU time is what a lowest priority task does not get to spin for
+static volatile uint32_t spins;
+static uint32_t spins_start;
+static double spins_per_us;
+
+static void spin_task(void *arg)
+{
+    for (;;)
+        spins++;
+}
+
+static esp_err_t spin_begin(TaskHandle_t *task)
+{
+#if HELPER_TARGET_IS_ESP32
+    BaseType_t res = xTaskCreatePinnedToCore(spin_task, "i2cdev_spin", 1024, NULL, tskIDLE_PRIORITY, task, xPortGetCoreID());
+#else
+    BaseType_t res = xTaskCreate(spin_task, "i2cdev_spin", 1024, NULL, tskIDLE_PRIORITY, task);
+#endif
+    if (res != pdPASS)
+        return ESP_ERR_NO_MEM;
+
+    uint32_t s = spins;
+    int64_t t = esp_timer_get_time();
+    vTaskDelay(pdMS_TO_TICKS(BENCH_SPIN_CAL_MS));
+    spins_per_us = (double)(spins - s) / (esp_timer_get_time() - t);
+
+    return spins_per_us > 0 ? ESP_OK : ESP_ERR_INVALID_STATE;
+}
+
+static void spin_end(TaskHandle_t task)
+{
+    vTaskDelete(task);
+    spins_per_us = 0;
+}
+
+#if !CONFIG_I2CDEV_BACKEND_MASTER
+static void build_read(i2c_cmd_handle_t cmd, uint8_t addr, uint8_t *reg, uint8_t *data, size_t size)
+{
+    i2c_master_start(cmd);
+    i2c_master_write_byte(cmd, addr << 1, true);
+    i2c_master_write(cmd, reg, 1, true);
+    i2c_master_start(cmd);
+    i2c_master_write_byte(cmd, (addr << 1) | 1, true);
+    i2c_master_read(cmd, data, size, I2C_MASTER_LAST_NACK);
+    i2c_master_stop(cmd);
+}
+#endif
+
+#if CONFIG_HEAP_TRACING_STANDALONE
+static heap_trace_record_t trace_records[BENCH_TRACE_RECORDS];
+#endif
+
+static int64_t measure_start()
+{
+#if CONFIG_HEAP_TRACING_STANDALONE
+    heap_trace_init_standalone(trace_records, BENCH_TRACE_RECORDS);
+    heap_trace_start(HEAP_TRACE_ALL);
+#endif
+    spins_start = spins;
+    return esp_timer_get_time();
+}
+
+static void measure_end(const char *name, int64_t start, uint32_t iterations)
+{
+    int64_t us = esp_timer_get_time() - start;
+    char cpu[32] = "";
+    if (spins_per_us > 0)
+    {
+        double idle = (spins - spins_start) / spins_per_us;
+        snprintf(cpu, sizeof(cpu), ", %.2f us CPU", (us > idle ? us - idle : 0) / iterations);
+    }
+#if CONFIG_HEAP_TRACING_STANDALONE
+    heap_trace_stop();
+    size_t allocs = heap_trace_get_count();
+    ESP_LOGI(TAG, "%-24s %8.2f us/call%s, %u%s heap allocations", name, (double)us / iterations, cpu,
+            (unsigned)allocs, allocs >= BENCH_TRACE_RECORDS ? "+" : "");
+#else
+    ESP_LOGI(TAG, "%-24s %8.2f us/call%s", name, (double)us / iterations, cpu);
+#endif
+}
+
+esp_err_t i2cdev_bench_run(const i2c_dev_t *dev, uint8_t reg, size_t size, uint32_t iterations)
+{
+    if (!dev || !size || size > BENCH_MAX_SIZE || !iterations) return ESP_ERR_INVALID_ARG;
+
+    uint8_t data[BENCH_MAX_SIZE];
+    int64_t start;
+    esp_err_t res;
+
+    ESP_LOGI(TAG, "[0x%02x at %d] %u iterations, %u bytes from reg 0x%02x, %s backend",
+            dev->addr, dev->port, (unsigned)iterations, (unsigned)size, reg, BENCH_BACKEND);
+
+#if !CONFIG_I2CDEV_BACKEND_MASTER
+    start = measure_start();
+    for (uint32_t i = 0; i < iterations; i++)
+    {
+        i2c_cmd_handle_t cmd = i2c_cmd_link_create();
+        if (!cmd) return ESP_ERR_NO_MEM;
+        build_read(cmd, dev->addr, &reg, data, size);
+        i2c_cmd_link_delete(cmd);
+    }
+    measure_end("heap cmd link build", start, iterations);
+
+#if I2CDEV_STATIC_CMD_LINK
+    start = measure_start();
+    for (uint32_t i = 0; i < iterations; i++)
+    {
+        i2c_cmd_handle_t cmd = i2c_cmd_link_create_static(cmd_buf, sizeof(cmd_buf));
+        if (!cmd) return ESP_ERR_NO_MEM;
+        build_read(cmd, dev->addr, &reg, data, size);
+        i2c_cmd_link_delete_static(cmd);
+    }
+    measure_end("static cmd link build", start, iterations);
+#else
+    ESP_LOGW(TAG, "Static command links are not supported by this SDK");
+#endif
+#endif /* !CONFIG_I2CDEV_BACKEND_MASTER */
+
+    // Warm-up: first transfer installs the driver
+    if ((res = i2c_dev_read_reg(dev, reg, data, size)) != ESP_OK)
+        return res;
+
+    TaskHandle_t spin;
+    if ((res = spin_begin(&spin)) != ESP_OK)
+        return res;
+
+    start = measure_start();
+    for (uint32_t i = 0; i < iterations && res == ESP_OK; i++)
+        res = i2c_dev_read_reg(dev, reg, data, size);
+    if (res == ESP_OK)
+        measure_end("i2c_dev_read_reg", start, iterations);
+
+    i2c_dev_xfer_t xfer;
+    if (res == ESP_OK)
+        res = i2c_dev_prepare_read(&xfer, dev, &reg, 1, size);
+
+    if (res == ESP_OK)
+    {
+        start = measure_start();
+        for (uint32_t i = 0; i < iterations && res == ESP_OK; i++)
+            res = i2c_dev_xfer_run(&xfer, data);
+        if (res == ESP_OK)
+            measure_end("prepared transfer", start, iterations);
+    }
+
+    spin_end(spin);
+    return res;
+}
+
+#endif /* CONFIG_I2CDEV_BENCHMARK */
@@ -0,0 +1,47 @@
+/**
+ * @file i2cdev_bench.h
+ * @defgroup i2cdev_bench i2cdev_bench
+ * @{
+ *
+ * Per-call cost benchmark for i2cdev transfers
+ *
+ * MIT Licensed as described in the file LICENSE
+ */
+#ifndef __I2CDEV_BENCH_H__
+#define __I2CDEV_BENCH_H__
+
+#include <i2cdev.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Measure per-call cost of i2cdev transfers
+ *
+ * Compares building a register read command link on heap (as i2cdev did
+ * before static command links) with building it in static memory, then
+ * runs \p iterations register reads from \p dev with ::i2c_dev_read_reg()
+ * and with a prepared transfer. Time per call is logged, together with the
+ * number of heap allocations when standalone heap tracing is enabled.
+ * Transfers also log CPU time per call, wall time less what a spinning
+ * task of idle priority on the same core got, so call it from a task of
+ * higher priority. Build with each `CONFIG_I2CDEV_BACKEND` to compare the
+ * backends; command links are only measured with the legacy one.
+ * Available when `CONFIG_I2CDEV_BENCHMARK` is enabled.
+ *
+ * @param dev Device descriptor
+ * @param reg Register address to read
+ * @param size Number of bytes to read, up to 32
+ * @param iterations Number of calls for each measurement
+ * @return ESP_OK on success
+ */
+esp_err_t i2cdev_bench_run(const i2c_dev_t *dev, uint8_t reg, size_t size, uint32_t iterations);
+
+#ifdef __cplusplus
+}
+#endif
+
+/**@}*/
+
+#endif /* __I2CDEV_BENCH_H__ */
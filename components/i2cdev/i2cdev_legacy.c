@@ -0,0 +1,136 @@
+/**
+ * @file i2cdev_legacy.c
+ *
+ * i2cdev backend for the ESP-IDF / ESP8266 RTOS SDK command link I2C driver
+ *
+ * Copyright (C) 2018 Ruslan V. Uss <https://github.com/UncleRus>
+ *
+ * MIT Licensed as described in the file LICENSE
+ */
+#include <stdint.h>
+#include "i2cdev_backend.h"
+
+#if !CONFIG_I2CDEV_BACKEND_MASTER
+
+#if I2CDEV_STATIC_CMD_LINK
+// Command link memory is shared by all devices on the port
+static uint8_t cmd_bufs[I2C_NUM_MAX][I2CDEV_CMD_LINK_BUF_SIZE] __attribute__((aligned(4)));
+// Two internal structs of static memory are reserved for the link descriptor
+#define CMD_LINK_BUDGET (CONFIG_I2CDEV_CMD_LINK_TRANSACTIONS * 5)
+#else
+#define CMD_LINK_BUDGET SIZE_MAX
+#endif
+
+static inline i2c_cmd_handle_t cmd_link_create(i2c_port_t port)
+{
+#if I2CDEV_STATIC_CMD_LINK
+    return i2c_cmd_link_create_static(cmd_bufs[port], sizeof(cmd_bufs[port]));
+#else
+    return i2c_cmd_link_create();
+#endif
+}
+
+static inline void cmd_link_delete(i2c_cmd_handle_t cmd)
+{
+#if I2CDEV_STATIC_CMD_LINK
+    i2c_cmd_link_delete_static(cmd);
+#else
+    i2c_cmd_link_delete(cmd);
+#endif
+}
+
+/**
+ * Upper bound of command link entries for a segment, stop not included
+ */
+static inline size_t seg_cmds(const i2c_dev_seg_t *seg)
+{
+    size_t reg = seg->out && seg->out_size ? 1 : 0;
+    // write: start, address, register, data
+    // read: start, address, register, repeated start, address, ACKed bytes, last NACKed byte
+    return seg->read ? reg * 3 + 4 : reg + 3;
+}
+
+static esp_err_t seg_append(i2c_cmd_handle_t cmd, const i2c_dev_seg_t *seg)
+{
+    uint8_t addr = seg->dev->addr << 1;
+    bool reg = seg->out && seg->out_size;
+
+    if (!seg->read || reg)
+    {
+        i2c_master_start(cmd);
+        i2c_master_write_byte(cmd, addr, true);
+        if (reg)
+            i2c_master_write(cmd, (void *)seg->out, seg->out_size, true);
+        if (!seg->read)
+            return i2c_master_write(cmd, seg->data, seg->size, true);
+    }
+    i2c_master_start(cmd);
+    i2c_master_write_byte(cmd, addr | 1, true);
+    return i2c_master_read(cmd, seg->data, seg->size, I2C_MASTER_LAST_NACK);
+}
+
+esp_err_t i2cdev_backend_install(i2c_port_t port, const i2c_config_t *cfg)
+{
+    esp_err_t res;
+#if HELPER_TARGET_IS_ESP32
+    if ((res = i2c_param_config(port, cfg)) != ESP_OK)
+        return res;
+    return i2c_driver_install(port, cfg->mode, 0, 0, 0);
+#else
+    if ((res = i2c_driver_install(port, cfg->mode)) != ESP_OK)
+        return res;
+    return i2c_param_config(port, cfg);
+#endif
+}
+
+esp_err_t i2cdev_backend_switch(i2c_port_t port, const i2c_config_t *cfg)
+{
+    // Installed driver takes new pins, pull-ups and SCL timing as is
+    return i2c_param_config(port, cfg);
+}
+
+esp_err_t i2cdev_backend_set_timeout(i2c_port_t port, uint32_t ticks)
+{
+#if HELPER_TARGET_IS_ESP32
+    return i2c_set_timeout(port, ticks);
+#else
+    // Clock stretch time is a part of ESP8266 config
+    return ESP_OK;
+#endif
+}
+
+esp_err_t i2cdev_backend_uninstall(i2c_port_t port)
+{
+    return i2c_driver_delete(port);
+}
+
+bool i2cdev_backend_fits(const i2c_dev_seg_t *segs, size_t count)
+{
+    size_t cmds = 1; // stop
+    for (size_t i = 0; i < count; i++)
+        cmds += seg_cmds(&segs[i]);
+
+    return count == 1 || cmds <= CMD_LINK_BUDGET;
+}
+
+esp_err_t i2cdev_backend_xfer(i2c_port_t port, const i2c_dev_seg_t *segs, size_t count, TickType_t ticks)
+{
+    i2c_cmd_handle_t cmd = cmd_link_create(port);
+    if (!cmd)
+        return ESP_ERR_NO_MEM;
+
+    // Command link functions fail only when static memory is exhausted,
+    // the last one appended in a segment is enough to check
+    esp_err_t res = ESP_OK;
+    for (size_t i = 0; i < count && res == ESP_OK; i++)
+        res = seg_append(cmd, &segs[i]);
+    if (res == ESP_OK)
+        res = i2c_master_stop(cmd);
+    if (res == ESP_OK)
+        res = i2c_master_cmd_begin(port, cmd, ticks);
+
+    cmd_link_delete(cmd);
+    return res;
+}
+
+#endif /* !CONFIG_I2CDEV_BACKEND_MASTER */
@@ -0,0 +1,318 @@
+/**
+ * @file i2cdev_master.c
+ *
+ * i2cdev backend for the ESP-IDF bus/device handle master driver
+ *
+ * The port config becomes a master bus, devices of the port share one
+ * device handle per SCL frequency and every transaction, joined segments
+ * included, runs as a list of defined operations with the addresses
+ * written explicitly. With CONFIG_I2CDEV_MASTER_ASYNC the driver queues
+ * the operations and the calling task sleeps until the completion
+ * callback.
+ *
+ * MIT Licensed as described in the file LICENSE
+ */
+#include <string.h>
+#include "i2cdev_backend.h"
+
+#if CONFIG_I2CDEV_BACKEND_MASTER
+
+#include <esp_idf_version.h>
+#if ESP_IDF_VERSION < ESP_IDF_VERSION_VAL(5, 4, 0)
+#error "CONFIG_I2CDEV_BACKEND_MASTER needs ESP-IDF 5.4 or newer"
+#endif
+
+#include <esp_attr.h>
+#include <driver/i2c_master.h>
+
+// write: start, address, register, data
+// read: start, address, register, repeated start, address, ACKed bytes, last NACKed byte
+#define SEG_OPS 7
+#define MAX_SEGS CONFIG_I2CDEV_CMD_LINK_TRANSACTIONS
+#define MAX_OPS (MAX_SEGS * SEG_OPS + 1)
+// Hardware timeout is set in APB cycles
+#define APB_CYCLES_PER_US 80
+
+typedef struct
+{
+    i2c_master_dev_handle_t handle;
+    uint32_t scl_hz;
+} dev_slot_t;
+
+typedef struct
+{
+    i2c_master_bus_handle_t bus;
+    i2c_config_t cfg;
+    uint32_t scl_wait_us;
+    dev_slot_t devs[CONFIG_I2CDEV_MASTER_DEVICES];
+    size_t evict;
+    i2c_operation_job_t ops[MAX_OPS];
+    uint8_t addrs[MAX_SEGS * 2];
+#if CONFIG_I2CDEV_MASTER_ASYNC
+    SemaphoreHandle_t done;
+    StaticSemaphore_t done_buf;
+    volatile i2c_master_event_t event;
+#endif
+} master_port_t;
+
+static master_port_t ports[I2C_NUM_MAX];
+
+#if CONFIG_I2CDEV_MASTER_ASYNC
+static bool IRAM_ATTR on_trans_done(i2c_master_dev_handle_t handle, const i2c_master_event_data_t *evt, void *arg)
+{
+    master_port_t *p = arg;
+    BaseType_t woken = pdFALSE;
+
+    p->event = evt->event;
+    xSemaphoreGiveFromISR(p->done, &woken);
+
+    return woken == pdTRUE;
+}
+#endif
+
+static void devs_remove(master_port_t *p)
+{
+    for (size_t i = 0; i < CONFIG_I2CDEV_MASTER_DEVICES; i++)
+    {
+        if (p->devs[i].handle)
+            i2c_master_bus_rm_device(p->devs[i].handle);
+        p->devs[i].handle = NULL;
+    }
+    p->evict = 0;
+}
+
+/**
+ * Device handle for the SCL frequency of the applied config, added on first use
+ */
+static esp_err_t dev_get(master_port_t *p, i2c_master_dev_handle_t *handle)
+{
+    uint32_t hz = p->cfg.master.clk_speed;
+    dev_slot_t *slot = NULL;
+
+    for (size_t i = 0; i < CONFIG_I2CDEV_MASTER_DEVICES; i++)
+    {
+        if (p->devs[i].handle && p->devs[i].scl_hz == hz)
+        {
+            *handle = p->devs[i].handle;
+            return ESP_OK;
+        }
+        if (!p->devs[i].handle && !slot)
+            slot = &p->devs[i];
+    }
+    if (!slot)
+    {
+        // All slots taken, drop handles round robin
+        slot = &p->devs[p->evict];
+        p->evict = (p->evict + 1) % CONFIG_I2CDEV_MASTER_DEVICES;
+        i2c_master_bus_rm_device(slot->handle);
+        slot->handle = NULL;
+    }
+
+    i2c_device_config_t dev_cfg = {
+        .dev_addr_length = I2C_ADDR_BIT_LEN_7,
+        // Defined operations write the addresses themselves
+        .device_address = I2C_DEVICE_ADDRESS_NOT_USED,
+        .scl_speed_hz = hz,
+        .scl_wait_us = p->scl_wait_us,
+    };
+    esp_err_t res = i2c_master_bus_add_device(p->bus, &dev_cfg, &slot->handle);
+    if (res != ESP_OK)
+        return res;
+#if CONFIG_I2CDEV_MASTER_ASYNC
+    const i2c_master_event_callbacks_t cbs = { .on_trans_done = on_trans_done };
+    if ((res = i2c_master_register_event_callbacks(slot->handle, &cbs, p)) != ESP_OK)
+    {
+        i2c_master_bus_rm_device(slot->handle);
+        slot->handle = NULL;
+        return res;
+    }
+#endif
+    slot->scl_hz = hz;
+    *handle = slot->handle;
+
+    return ESP_OK;
+}
+
+static inline i2c_operation_job_t *op_write(i2c_operation_job_t *op, const void *data, size_t size)
+{
+    op->command = I2C_MASTER_CMD_WRITE;
+    op->write.ack_check = true;
+    op->write.data = (uint8_t *)data;
+    op->write.total_bytes = size;
+    return op + 1;
+}
+
+static inline i2c_operation_job_t *op_read(i2c_operation_job_t *op, void *data, size_t size, i2c_ack_value_t ack)
+{
+    op->command = I2C_MASTER_CMD_READ;
+    op->read.ack_value = ack;
+    op->read.data = data;
+    op->read.total_bytes = size;
+    return op + 1;
+}
+
+static inline i2c_operation_job_t *op_start(i2c_operation_job_t *op)
+{
+    op->command = I2C_MASTER_CMD_START;
+    return op + 1;
+}
+
+static i2c_operation_job_t *seg_append(i2c_operation_job_t *op, uint8_t *addr, const i2c_dev_seg_t *seg)
+{
+    bool reg = seg->out && seg->out_size;
+
+    addr[0] = seg->dev->addr << 1;
+    addr[1] = addr[0] | 1;
+    if (!seg->read || reg)
+    {
+        op = op_write(op_start(op), &addr[0], 1);
+        if (reg)
+            op = op_write(op, seg->out, seg->out_size);
+        if (!seg->read)
+            return op_write(op, seg->data, seg->size);
+    }
+    op = op_write(op_start(op), &addr[1], 1);
+    if (seg->size > 1)
+        op = op_read(op, seg->data, seg->size - 1, I2C_ACK_VAL);
+    return op_read(op, (uint8_t *)seg->data + seg->size - 1, 1, I2C_NACK_VAL);
+}
+
+static esp_err_t bus_create(i2c_port_t port, const i2c_config_t *cfg)
+{
+    master_port_t *p = &ports[port];
+
+    i2c_master_bus_config_t bus_cfg = {
+        .i2c_port = port,
+        .sda_io_num = cfg->sda_io_num,
+        .scl_io_num = cfg->scl_io_num,
+        .clk_source = I2C_CLK_SRC_DEFAULT,
+        .glitch_ignore_cnt = 7,
+#if CONFIG_I2CDEV_MASTER_ASYNC
+        .trans_queue_depth = 1,
+#endif
+        .flags.enable_internal_pullup = cfg->sda_pullup_en || cfg->scl_pullup_en,
+    };
+    esp_err_t res = i2c_new_master_bus(&bus_cfg, &p->bus);
+    if (res != ESP_OK)
+        return res;
+
+    memcpy(&p->cfg, cfg, sizeof(i2c_config_t));
+    return ESP_OK;
+}
+
+esp_err_t i2cdev_backend_install(i2c_port_t port, const i2c_config_t *cfg)
+{
+    master_port_t *p = &ports[port];
+
+#if CONFIG_I2CDEV_MASTER_ASYNC
+    if (!p->done && !(p->done = xSemaphoreCreateBinaryStatic(&p->done_buf)))
+        return ESP_ERR_NO_MEM;
+#endif
+    p->scl_wait_us = 0;
+
+    return bus_create(port, cfg);
+}
+
+esp_err_t i2cdev_backend_switch(i2c_port_t port, const i2c_config_t *cfg)
+{
+    master_port_t *p = &ports[port];
+
+    // SCL frequency is a device handle property, only pins and pull-ups need another bus
+    if (cfg->sda_io_num == p->cfg.sda_io_num && cfg->scl_io_num == p->cfg.scl_io_num
+            && cfg->sda_pullup_en == p->cfg.sda_pullup_en && cfg->scl_pullup_en == p->cfg.scl_pullup_en)
+    {
+        memcpy(&p->cfg, cfg, sizeof(i2c_config_t));
+        return ESP_OK;
+    }
+
+    devs_remove(p);
+    esp_err_t res = i2c_del_master_bus(p->bus);
+    p->bus = NULL;
+    if (res != ESP_OK)
+        return res;
+
+    return bus_create(port, cfg);
+}
+
+esp_err_t i2cdev_backend_set_timeout(i2c_port_t port, uint32_t ticks)
+{
+    master_port_t *p = &ports[port];
+
+    // Clock stretch limit is a device handle property too, handles are added again on use
+    uint32_t us = ticks / APB_CYCLES_PER_US;
+    if (us != p->scl_wait_us)
+    {
+        devs_remove(p);
+        p->scl_wait_us = us;
+    }
+
+    return ESP_OK;
+}
+
+esp_err_t i2cdev_backend_uninstall(i2c_port_t port)
+{
+    master_port_t *p = &ports[port];
+
+    devs_remove(p);
+    esp_err_t res = i2c_del_master_bus(p->bus);
+    p->bus = NULL;
+
+    return res;
+}
+
+bool i2cdev_backend_fits(const i2c_dev_seg_t *segs, size_t count)
+{
+    return count <= MAX_SEGS;
+}
+
+static esp_err_t map_result(esp_err_t res)
+{
+    // NACKs are ESP_FAIL for the core, as with the command link driver
+    return res == ESP_ERR_INVALID_RESPONSE || res == ESP_ERR_INVALID_STATE ? ESP_FAIL : res;
+}
+
+esp_err_t i2cdev_backend_xfer(i2c_port_t port, const i2c_dev_seg_t *segs, size_t count, TickType_t ticks)
+{
+    master_port_t *p = &ports[port];
+    i2c_master_dev_handle_t handle;
+
+    esp_err_t res = dev_get(p, &handle);
+    if (res != ESP_OK)
+        return res;
+
+    i2c_operation_job_t *op = p->ops;
+    for (size_t i = 0; i < count; i++)
+        op = seg_append(op, &p->addrs[i * 2], &segs[i]);
+    op->command = I2C_MASTER_CMD_STOP;
+    op++;
+
+    int timeout_ms = ticks == portMAX_DELAY ? -1 : (int)pdTICKS_TO_MS(ticks);
+    if (!timeout_ms)
+        timeout_ms = 1;
+
+#if CONFIG_I2CDEV_MASTER_ASYNC
+    // Queued by the driver, completion is signalled from its ISR
+    xSemaphoreTake(p->done, 0);
+    res = i2c_master_execute_defined_operations(handle, p->ops, op - p->ops, timeout_ms);
+    if (res != ESP_OK)
+        return map_result(res);
+    if (xSemaphoreTake(p->done, ticks) != pdTRUE)
+    {
+        i2c_master_bus_reset(p->bus);
+        return ESP_ERR_TIMEOUT;
+    }
+    switch (p->event)
+    {
+        case I2C_EVENT_DONE:
+            return ESP_OK;
+        case I2C_EVENT_NACK:
+            return ESP_FAIL;
+        default:
+            return ESP_ERR_TIMEOUT;
+    }
+#else
+    return map_result(i2c_master_execute_defined_operations(handle, p->ops, op - p->ops, timeout_ms));
+#endif
+}
+
+#endif /* CONFIG_I2CDEV_BACKEND_MASTER */
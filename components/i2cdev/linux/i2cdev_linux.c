@@ -0,0 +1,293 @@
+/**
+ * @file i2cdev_linux.c
+ *
+ * i2cdev backend for Linux i2c-dev (/dev/i2c-N)
+ *
+ * MIT Licensed as described in the file LICENSE
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/i2c.h>
+#include <linux/i2c-dev.h>
+#include <esp_log.h>
+#include "i2cdev_backend.h"
+#include "i2cdev_linux.h"
+
+static const char *TAG = "i2cdev_linux";
+
+typedef struct {
+    int adapter;
+    int fd;
+    unsigned long funcs;
+    bool force_smbus;
+    uint16_t slave;    // address selected with I2C_SLAVE, 0 if none
+    uint8_t *buf;      // register and data of a write, joined into one message
+    size_t buf_size;
+} linux_port_t;
+
+static linux_port_t ports[I2C_NUM_MAX] = {
+    [0 ... I2C_NUM_MAX - 1] = { .adapter = -1, .fd = -1 },
+};
+
+static inline bool use_rdwr(const linux_port_t *p)
+{
+    return (p->funcs & I2C_FUNC_I2C) && !p->force_smbus;
+}
+
+static esp_err_t errno_to_esp(int err)
+{
+    switch (err)
+    {
+        case ETIMEDOUT:
+            return ESP_ERR_TIMEOUT;
+        case EINVAL:
+            return ESP_ERR_INVALID_ARG;
+        case ENOMEM:
+            return ESP_ERR_NO_MEM;
+        case EOPNOTSUPP:
+            return ESP_ERR_NOT_SUPPORTED;
+        default:
+            // ENXIO, EREMOTEIO, EIO: NACK or bus error, like the ESP-IDF driver
+            return ESP_FAIL;
+    }
+}
+
+esp_err_t i2cdev_linux_set_adapter(i2c_port_t port, int adapter)
+{
+    if (port >= I2C_NUM_MAX || adapter < 0)
+        return ESP_ERR_INVALID_ARG;
+    if (ports[port].fd >= 0)
+        return ESP_ERR_INVALID_STATE;
+    ports[port].adapter = adapter;
+    return ESP_OK;
+}
+
+esp_err_t i2cdev_linux_force_smbus(i2c_port_t port, bool smbus)
+{
+    if (port >= I2C_NUM_MAX)
+        return ESP_ERR_INVALID_ARG;
+    ports[port].force_smbus = smbus;
+    return ESP_OK;
+}
+
+int i2cdev_linux_fd(i2c_port_t port)
+{
+    return port < I2C_NUM_MAX ? ports[port].fd : -1;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// SMBus
+
+static esp_err_t smbus_access(int fd, char rw, uint8_t cmd, int size, union i2c_smbus_data *data)
+{
+    struct i2c_smbus_ioctl_data args = {
+        .read_write = rw,
+        .command = cmd,
+        .size = size,
+        .data = data,
+    };
+    return ioctl(fd, I2C_SMBUS, &args) < 0 ? errno_to_esp(errno) : ESP_OK;
+}
+
+static esp_err_t smbus_seg(linux_port_t *p, const i2c_dev_seg_t *seg)
+{
+    if (p->slave != seg->dev->addr)
+    {
+        if (ioctl(p->fd, I2C_SLAVE, seg->dev->addr) < 0)
+            return errno_to_esp(errno);
+        p->slave = seg->dev->addr;
+    }
+
+    union i2c_smbus_data data;
+    uint8_t *bytes = seg->data;
+    esp_err_t res;
+
+    // One register byte and up to 32 data bytes: I2C block transfers
+    if (seg->out_size == 1 && seg->size && seg->size <= I2C_SMBUS_BLOCK_MAX)
+    {
+        uint8_t reg = *(const uint8_t *)seg->out;
+        data.block[0] = seg->size;
+        if (seg->read)
+        {
+            if ((res = smbus_access(p->fd, I2C_SMBUS_READ, reg, I2C_SMBUS_I2C_BLOCK_DATA, &data)) != ESP_OK)
+                return res;
+            memcpy(bytes, data.block + 1, seg->size);
+            return ESP_OK;
+        }
+        memcpy(data.block + 1, bytes, seg->size);
+        return smbus_access(p->fd, I2C_SMBUS_WRITE, reg, I2C_SMBUS_I2C_BLOCK_DATA, &data);
+    }
+
+    // No register: a write is a block write with the first byte as command
+    if (!seg->out_size && !seg->read && seg->size && seg->size <= I2C_SMBUS_BLOCK_MAX + 1)
+    {
+        if (seg->size == 1)
+            return smbus_access(p->fd, I2C_SMBUS_WRITE, bytes[0], I2C_SMBUS_BYTE, NULL);
+        data.block[0] = seg->size - 1;
+        memcpy(data.block + 1, bytes + 1, seg->size - 1);
+        return smbus_access(p->fd, I2C_SMBUS_WRITE, bytes[0], I2C_SMBUS_I2C_BLOCK_DATA, &data);
+    }
+    if (!seg->out_size && seg->read && seg->size == 1)
+    {
+        if ((res = smbus_access(p->fd, I2C_SMBUS_READ, 0, I2C_SMBUS_BYTE, &data)) != ESP_OK)
+            return res;
+        bytes[0] = data.byte;
+        return ESP_OK;
+    }
+
+    // Multibyte reads without register, long transfers: no SMBus equivalent
+    ESP_LOGE(TAG, "Transfer of %u bytes to [0x%02x] is not possible with SMBus on i2c-%d",
+            (unsigned)seg->size, seg->dev->addr, p->adapter);
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// I2C_RDWR
+
+/**
+ * Messages of a segment
+ */
+static inline size_t seg_msgs(const i2c_dev_seg_t *seg)
+{
+    return seg->read && seg->out && seg->out_size ? 2 : 1;
+}
+
+static esp_err_t rdwr_xfer(linux_port_t *p, const i2c_dev_seg_t *segs, size_t count)
+{
+    struct i2c_msg msgs[I2C_RDWR_IOCTL_MAX_MSGS];
+    size_t n = 0;
+
+    // Writes with register need both in one message, without repeated start
+    size_t joined = 0;
+    for (size_t i = 0; i < count; i++)
+        if (!segs[i].read && segs[i].out_size)
+            joined += segs[i].out_size + segs[i].size;
+    if (joined > p->buf_size)
+    {
+        uint8_t *buf = realloc(p->buf, joined);
+        if (!buf)
+            return ESP_ERR_NO_MEM;
+        p->buf = buf;
+        p->buf_size = joined;
+    }
+
+    uint8_t *buf = p->buf;
+    for (size_t i = 0; i < count; i++)
+    {
+        const i2c_dev_seg_t *seg = &segs[i];
+        if (seg->size > UINT16_MAX || seg->out_size > UINT16_MAX)
+            return ESP_ERR_INVALID_SIZE;
+        bool reg = seg->out && seg->out_size;
+        if (seg->read)
+        {
+            if (reg)
+                msgs[n++] = (struct i2c_msg) { .addr = seg->dev->addr, .flags = 0,
+                    .len = seg->out_size, .buf = (uint8_t *)seg->out };
+            msgs[n++] = (struct i2c_msg) { .addr = seg->dev->addr, .flags = I2C_M_RD,
+                .len = seg->size, .buf = seg->data };
+        }
+        else if (reg)
+        {
+            memcpy(buf, seg->out, seg->out_size);
+            memcpy(buf + seg->out_size, seg->data, seg->size);
+            msgs[n++] = (struct i2c_msg) { .addr = seg->dev->addr, .flags = 0,
+                .len = seg->out_size + seg->size, .buf = buf };
+            buf += seg->out_size + seg->size;
+        }
+        else
+            msgs[n++] = (struct i2c_msg) { .addr = seg->dev->addr, .flags = 0,
+                .len = seg->size, .buf = seg->data };
+    }
+
+    struct i2c_rdwr_ioctl_data data = { .msgs = msgs, .nmsgs = n };
+    return ioctl(p->fd, I2C_RDWR, &data) < 0 ? errno_to_esp(errno) : ESP_OK;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Backend
+
+esp_err_t i2cdev_backend_install(i2c_port_t port, const i2c_config_t *cfg)
+{
+    linux_port_t *p = &ports[port];
+    if (p->fd >= 0)
+        return ESP_FAIL;
+
+    char path[32];
+    snprintf(path, sizeof(path), "/dev/i2c-%d", p->adapter >= 0 ? p->adapter : port);
+    p->fd = open(path, O_RDWR);
+    if (p->fd < 0)
+    {
+        ESP_LOGE(TAG, "Could not open %s: %s", path, strerror(errno));
+        return errno == ENOENT ? ESP_ERR_NOT_FOUND : ESP_FAIL;
+    }
+    if (ioctl(p->fd, I2C_FUNCS, &p->funcs) < 0)
+        p->funcs = 0;
+    p->slave = 0;
+
+    // Units of 10 ms
+    ioctl(p->fd, I2C_TIMEOUT, (CONFIG_I2CDEV_TIMEOUT + 9) / 10);
+
+    ESP_LOGD(TAG, "%s: %s transfers", path, use_rdwr(p) ? "I2C_RDWR" : "SMBus");
+    return ESP_OK;
+}
+
+esp_err_t i2cdev_backend_switch(i2c_port_t port, const i2c_config_t *cfg)
+{
+    // Adapter timing belongs to the kernel
+    return ports[port].fd >= 0 ? ESP_OK : ESP_FAIL;
+}
+
+esp_err_t i2cdev_backend_set_timeout(i2c_port_t port, uint32_t ticks)
+{
+    // Clock stretching limit is an adapter property
+    return ESP_OK;
+}
+
+esp_err_t i2cdev_backend_uninstall(i2c_port_t port)
+{
+    linux_port_t *p = &ports[port];
+    if (p->fd < 0)
+        return ESP_FAIL;
+    close(p->fd);
+    p->fd = -1;
+    free(p->buf);
+    p->buf = NULL;
+    p->buf_size = 0;
+    return ESP_OK;
+}
+
+bool i2cdev_backend_fits(const i2c_dev_seg_t *segs, size_t count)
+{
+    if (count == 1)
+        return true;
+
+    // Not opened yet or SMBus only: one segment per transaction
+    const linux_port_t *p = &ports[segs[0].dev->port];
+    if (p->fd < 0 || !use_rdwr(p))
+        return false;
+
+    size_t msgs = 0;
+    for (size_t i = 0; i < count; i++)
+        msgs += seg_msgs(&segs[i]);
+    return msgs <= I2C_RDWR_IOCTL_MAX_MSGS;
+}
+
+esp_err_t i2cdev_backend_xfer(i2c_port_t port, const i2c_dev_seg_t *segs, size_t count, TickType_t ticks)
+{
+    linux_port_t *p = &ports[port];
+    if (p->fd < 0)
+        return ESP_ERR_INVALID_STATE;
+
+    if (use_rdwr(p))
+        return rdwr_xfer(p, segs, count);
+
+    esp_err_t res = ESP_OK;
+    for (size_t i = 0; i < count && res == ESP_OK; i++)
+        res = smbus_seg(p, &segs[i]);
+    return res;
+}
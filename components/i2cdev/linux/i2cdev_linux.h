@@ -0,0 +1,65 @@
+/**
+ * @file i2cdev_linux.h
+ * @defgroup i2cdev_linux i2cdev_linux
+ * @{
+ *
+ * i2cdev backend for Linux i2c-dev (/dev/i2c-N)
+ *
+ * Every bus transaction is one I2C_RDWR ioctl with one message per write
+ * and per read, so register reads keep their repeated start. Adapters
+ * without plain I2C support (I2C_FUNC_I2C), like the i2c-stub module, are
+ * driven with SMBus ioctls instead: register reads and writes of up to
+ * 32 bytes map to I2C block transfers, other segments to byte transfers.
+ * There each segment is a separate transaction.
+ *
+ * SCL frequency and pins are fixed by the kernel, bus configs only select
+ * the adapter through the port number.
+ *
+ * MIT Licensed as described in the file LICENSE
+ */
+#ifndef __I2CDEV_LINUX_H__
+#define __I2CDEV_LINUX_H__
+
+#include <stdbool.h>
+#include <driver/i2c.h>
+#include <esp_err.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Map port to adapter /dev/i2c-<adapter>
+ *
+ * Ports map to the adapter with the same number by default. Must be
+ * called before the first transfer on the port.
+ *
+ * @param port I2C port
+ * @param adapter Adapter number
+ * @return `ESP_OK` on success
+ */
+esp_err_t i2cdev_linux_set_adapter(i2c_port_t port, int adapter);
+
+/**
+ * @brief Force SMBus transfers even if the adapter supports I2C_RDWR
+ *
+ * For comparisons on adapters supporting both.
+ *
+ * @param port I2C port
+ * @param smbus true to use SMBus transfers
+ * @return `ESP_OK` on success
+ */
+esp_err_t i2cdev_linux_force_smbus(i2c_port_t port, bool smbus);
+
+/**
+ * @brief File descriptor of the open adapter, -1 if the port is not installed
+ */
+int i2cdev_linux_fd(i2c_port_t port);
+
+#ifdef __cplusplus
+}
+#endif
+
+/**@}*/
+
+#endif /* __I2CDEV_LINUX_H__ */
@@ -0,0 +1,133 @@
+/**
+ * @file i2c_sim.h
+ * @defgroup i2c_sim i2c_sim
+ * @{
+ *
+ * Simulated I2C bus, i2cdev backend for host builds
+ *
+ * Replaces the ESP-IDF driver under i2cdev: transactions are decoded into
+ * bus events (start, address, data bytes, stop) and delivered to device
+ * models attached to the port. Bus time is computed from the SCL frequency
+ * of the applied config and accumulated as virtual time.
+ *
+ * MIT Licensed as described in the file LICENSE
+ */
+#ifndef __I2C_SIM_H__
+#define __I2C_SIM_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <driver/i2c.h>
+#include <esp_err.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define I2C_SIM_GENERAL_CALL 0x00 //!< General call address
+
+typedef struct i2c_sim_model_s i2c_sim_model_t;
+
+/**
+ * Device model
+ *
+ * Callbacks are called with the port locked, in bus order. A model is
+ * addressed by a (repeated) start to its address, or to the general call
+ * address when it listens to it; `stop` is called only for models addressed
+ * since the previous stop.
+ */
+struct i2c_sim_model_s
+{
+    uint8_t addr;         //!< Unshifted 7-bit address
+    bool general_call;    //!< Model listens to general call address
+    uint32_t max_clk_hz;  /*!< Highest SCL frequency the wiring to the model takes, 0 for
+                               any. Above it data bytes in both directions lose ones
+                               that follow a zero, as with too slow rising edges; within
+                               10% above it only every 4th transaction is hit */
+    void *ctx;            //!< Model context
+
+    bool (*start)(i2c_sim_model_t *model, bool read, bool general_call); //!< Addressed, returns ACK
+    bool (*write)(i2c_sim_model_t *model, uint8_t byte);                 //!< Byte from master, returns ACK
+    uint8_t (*read)(i2c_sim_model_t *model);                             //!< Byte to master
+    void (*stop)(i2c_sim_model_t *model);                                //!< Stop condition
+
+    i2c_sim_model_t *next; //!< Internal
+    bool addressed;        //!< Internal
+    bool active;           //!< Internal
+};
+
+/**
+ * Bus timing model
+ */
+typedef struct
+{
+    uint32_t overhead_us; //!< Fixed driver overhead per transaction
+    uint8_t byte_bits;    //!< SCL periods per byte, including ACK
+    uint8_t cond_bits;    //!< SCL periods per start, repeated start or stop
+    bool realtime;        //!< Sleep for bus time instead of only accounting it
+} i2c_sim_timing_t;
+
+/**
+ * Bus counters
+ */
+typedef struct
+{
+    uint32_t transactions; //!< Transactions run
+    uint32_t bytes;        //!< Bytes on the bus, addresses included
+    uint32_t nacks;        //!< Transactions aborted by NACK
+    uint64_t bus_time_us;  //!< Simulated bus time
+} i2c_sim_stats_t;
+
+/**
+ * @brief Attach device model to the simulated bus of port
+ *
+ * @param port I2C port
+ * @param model Model, must stay valid until detached
+ * @return `ESP_OK` on success
+ */
+esp_err_t i2c_sim_attach(i2c_port_t port, i2c_sim_model_t *model);
+
+/**
+ * @brief Detach device model
+ *
+ * @param port I2C port
+ * @param model Model
+ * @return `ESP_OK` on success, `ESP_ERR_NOT_FOUND` if the model is not attached
+ */
+esp_err_t i2c_sim_detach(i2c_port_t port, i2c_sim_model_t *model);
+
+/**
+ * @brief Set timing model, for all ports
+ *
+ * Defaults are 9 SCL periods per byte, 1 per condition and 20 us of driver
+ * overhead per transaction, not realtime.
+ *
+ * @param timing Timing model
+ */
+void i2c_sim_set_timing(const i2c_sim_timing_t *timing);
+
+/**
+ * @brief Simulated clock, microseconds
+ *
+ * Monotonic time plus the bus time of all ports not spent in realtime mode.
+ * Models use it for internal timing like EEPROM write cycles.
+ */
+int64_t i2c_sim_now(void);
+
+/**
+ * @brief Get bus counters of port
+ *
+ * @param port I2C port
+ * @param[out] stats Counters
+ * @param reset Zero counters after reading
+ * @return `ESP_OK` on success
+ */
+esp_err_t i2c_sim_get_stats(i2c_port_t port, i2c_sim_stats_t *stats, bool reset);
+
+#ifdef __cplusplus
+}
+#endif
+
+/**@}*/
+
+#endif /* __I2C_SIM_H__ */
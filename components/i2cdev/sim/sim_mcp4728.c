@@ -0,0 +1,260 @@
+/**
+ * @file sim_mcp4728.c
+ *
+ * MCP4728 model for the simulated I2C bus
+ *
+ * MIT Licensed as described in the file LICENSE
+ */
+#include <string.h>
+#include "sim_mcp4728.h"
+
+#define CMD_NONE       0xff
+
+#define CMD_FAST       0x00 // 00xx xxxx
+#define CMD_MULTI      0x40 // 0100 0xxx
+#define CMD_SEQ        0x50 // 0101 0xxx
+#define CMD_SINGLE     0x58 // 0101 1xxx
+#define CMD_ADDR       0x60 // 011x xxxx
+#define CMD_VREF       0x80 // 100x xxxx
+#define CMD_PD         0xa0 // 101x xxxx
+#define CMD_GAIN       0xc0 // 110x xxxx
+
+#define GC_RESET       0x06
+#define GC_WAKEUP      0x09
+#define GC_UPDATE      0x08
+
+static uint8_t cmd_type(uint8_t byte)
+{
+    if ((byte & 0xc0) == CMD_FAST)
+        return CMD_FAST;
+    if ((byte & 0xf8) == CMD_MULTI || (byte & 0xf8) == CMD_SEQ || (byte & 0xf8) == CMD_SINGLE)
+        return byte & 0xf8;
+    if ((byte & 0xe0) == CMD_ADDR || (byte & 0xe0) == CMD_VREF || (byte & 0xe0) == CMD_PD
+            || (byte & 0xe0) == CMD_GAIN)
+        return byte & 0xe0;
+    return CMD_NONE;
+}
+
+static void latch(sim_mcp4728_t *dac, uint8_t ch, bool udac)
+{
+    if (!udac || !dac->ldac)
+    {
+        dac->output[ch] = dac->input[ch];
+        dac->latched_at[ch] = i2c_sim_now();
+    }
+}
+
+static void latched_all(sim_mcp4728_t *dac)
+{
+    int64_t now = i2c_sim_now();
+    for (int ch = 0; ch < 4; ch++)
+        dac->latched_at[ch] = now;
+}
+
+/* VREF PD1 PD0 Gx D11..D8, D7..D0 */
+static void set_reg(sim_mcp4728_reg_t *reg, uint8_t hi, uint8_t lo)
+{
+    reg->vref = hi & 0x80;
+    reg->pd = (hi >> 5) & 3;
+    reg->gain = hi & 0x10;
+    reg->value = ((hi & 0x0f) << 8) | lo;
+}
+
+static void write_channel(sim_mcp4728_t *dac, uint8_t ch, bool eeprom)
+{
+    if (dac->ignore)
+        return;
+    set_reg(&dac->input[ch], dac->buf[1], dac->buf[2]);
+    latch(dac, ch, dac->udac);
+    if (eeprom)
+    {
+        dac->eeprom[ch] = dac->input[ch];
+        dac->eeprom_pending |= (1 << ch);
+    }
+}
+
+static bool general_call(sim_mcp4728_t *dac, uint8_t byte)
+{
+    switch (byte)
+    {
+        case GC_RESET:
+            memcpy(dac->input, dac->eeprom, sizeof(dac->input));
+            memcpy(dac->output, dac->eeprom, sizeof(dac->output));
+            latched_all(dac);
+            break;
+        case GC_WAKEUP:
+            for (int ch = 0; ch < 4; ch++)
+                dac->input[ch].pd = dac->output[ch].pd = 0;
+            break;
+        case GC_UPDATE:
+            memcpy(dac->output, dac->input, sizeof(dac->output));
+            latched_all(dac);
+            break;
+        default:
+            break;
+    }
+    return true;
+}
+
+static bool dac_start(i2c_sim_model_t *model, bool read, bool general)
+{
+    sim_mcp4728_t *dac = model->ctx;
+
+    dac->general = general;
+    dac->cmd = CMD_NONE;
+    dac->pos = 0;
+    dac->channel = 0;
+    if (read)
+        dac->read_pos = 0;
+    return true;
+}
+
+static bool dac_write(i2c_sim_model_t *model, uint8_t byte)
+{
+    sim_mcp4728_t *dac = model->ctx;
+
+    if (dac->general)
+        return general_call(dac, byte);
+
+    if (dac->pos == 0)
+    {
+        uint8_t type = cmd_type(byte);
+        if (type == CMD_NONE)
+            return false;
+        // Fast write starts with channel A and continues with the next one
+        if (type != CMD_FAST)
+            dac->channel = (byte >> 1) & 3;
+        else if (dac->cmd != CMD_FAST)
+            dac->channel = 0;
+        dac->cmd = type;
+        dac->udac = byte & 1;
+        dac->ignore = false;
+        if (type == CMD_SEQ || type == CMD_SINGLE || type == CMD_ADDR)
+        {
+            dac->ignore = sim_mcp4728_busy(dac);
+            if (dac->ignore)
+                dac->ignored++;
+        }
+    }
+    dac->buf[dac->pos++] = byte;
+
+    switch (dac->cmd)
+    {
+        case CMD_FAST:
+            // 0 0 PD1 PD0 D11..D8, D7..D0
+            if (dac->pos < 2)
+                break;
+            dac->input[dac->channel].pd = (dac->buf[0] >> 4) & 3;
+            dac->input[dac->channel].value = ((dac->buf[0] & 0x0f) << 8) | dac->buf[1];
+            latch(dac, dac->channel, true);
+            dac->channel = (dac->channel + 1) & 3;
+            dac->pos = 0;
+            break;
+        case CMD_MULTI:
+        case CMD_SINGLE:
+            if (dac->pos < 3)
+                break;
+            write_channel(dac, dac->channel, dac->cmd == CMD_SINGLE);
+            dac->pos = 0;
+            break;
+        case CMD_SEQ:
+            // Command byte, then pairs from the start channel up to D
+            if (dac->pos < 3)
+                break;
+            if (dac->channel > 3)
+                return false;
+            write_channel(dac, dac->channel++, true);
+            dac->pos = 1;
+            break;
+        case CMD_ADDR:
+            // Needs LDAC toggling synchronized to the bus, not modelled
+            if (dac->pos == 3)
+                dac->pos = 0;
+            break;
+        case CMD_VREF:
+        case CMD_GAIN:
+            for (int ch = 0; ch < 4; ch++)
+            {
+                bool bit = byte & (1 << (3 - ch));
+                if (dac->cmd == CMD_VREF)
+                    dac->input[ch].vref = dac->output[ch].vref = bit;
+                else
+                    dac->input[ch].gain = dac->output[ch].gain = bit;
+            }
+            dac->pos = 0;
+            break;
+        case CMD_PD:
+            // 1 0 1 x PD1A PD0A PD1B PD0B, PD1C PD0C PD1D PD0D x x x x
+            if (dac->pos < 2)
+                break;
+            {
+                uint8_t bits = (dac->buf[0] << 4) | (dac->buf[1] >> 4);
+                for (int ch = 0; ch < 4; ch++)
+                    dac->input[ch].pd = dac->output[ch].pd = (bits >> (6 - ch * 2)) & 3;
+            }
+            dac->pos = 0;
+            break;
+    }
+    return true;
+}
+
+static uint8_t dac_read(i2c_sim_model_t *model)
+{
+    sim_mcp4728_t *dac = model->ctx;
+
+    // Per channel: info, DAC register hi, lo, info, EEPROM hi, lo
+    size_t pos = dac->read_pos++ % 24;
+    uint8_t ch = pos / 6;
+    const sim_mcp4728_reg_t *reg = pos % 6 < 3 ? &dac->input[ch] : &dac->eeprom[ch];
+
+    switch (pos % 3)
+    {
+        case 0:
+            // RDY/BSY POR DAC1 DAC0 0 A2 A1 A0
+            return (sim_mcp4728_busy(dac) ? 0 : 0x80) | 0x40 | (ch << 4) | (model->addr & 7);
+        case 1:
+            return (reg->vref ? 0x80 : 0) | (reg->pd << 5) | (reg->gain ? 0x10 : 0) | (reg->value >> 8);
+        default:
+            return reg->value & 0xff;
+    }
+}
+
+static void dac_stop(i2c_sim_model_t *model)
+{
+    sim_mcp4728_t *dac = model->ctx;
+
+    if (!dac->eeprom_pending)
+        return;
+    dac->eeprom_pending = 0;
+    dac->eeprom_writes++;
+    dac->busy_until = i2c_sim_now() + dac->eeprom_write_us;
+}
+
+void sim_mcp4728_init(sim_mcp4728_t *dac, uint8_t addr)
+{
+    memset(dac, 0, sizeof(*dac));
+    dac->model.addr = addr;
+    dac->model.general_call = true;
+    dac->model.ctx = dac;
+    dac->model.start = dac_start;
+    dac->model.write = dac_write;
+    dac->model.read = dac_read;
+    dac->model.stop = dac_stop;
+    dac->eeprom_write_us = SIM_MCP4728_EEPROM_WRITE_US;
+    dac->cmd = CMD_NONE;
+}
+
+bool sim_mcp4728_busy(const sim_mcp4728_t *dac)
+{
+    return dac->busy_until && i2c_sim_now() < dac->busy_until;
+}
+
+void sim_mcp4728_set_ldac(sim_mcp4728_t *dac, bool level)
+{
+    if (dac->ldac && !level)
+    {
+        memcpy(dac->output, dac->input, sizeof(dac->output));
+        latched_all(dac);
+    }
+    dac->ldac = level;
+}
@@ -0,0 +1,96 @@
+/**
+ * @file sim_mcp4728.h
+ * @defgroup sim_mcp4728 sim_mcp4728
+ * @{
+ *
+ * MCP4728 model for the simulated I2C bus
+ *
+ * Decodes fast write, multi-write, sequential write, single write, VREF,
+ * gain and power-down commands, the 24 byte readback and the general call
+ * reset, wake-up and software update commands. EEPROM writes start on stop
+ * and keep the device busy (RDY/BSY low) for `eeprom_write_us`, EEPROM
+ * writing commands are ignored meanwhile.
+ *
+ * MIT Licensed as described in the file LICENSE
+ */
+#ifndef __SIM_MCP4728_H__
+#define __SIM_MCP4728_H__
+
+#include "i2c_sim.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SIM_MCP4728_EEPROM_WRITE_US 50000 //!< Typical EEPROM write cycle
+
+/**
+ * Channel register
+ */
+typedef struct
+{
+    uint16_t value; //!< 12-bit code
+    bool vref;      //!< Internal 2.048 V reference if true, VDD otherwise
+    bool gain;      //!< x2 gain, internal reference only
+    uint8_t pd;     //!< Power-down bits, 0 is normal mode
+} sim_mcp4728_reg_t;
+
+/**
+ * Device state
+ */
+typedef struct
+{
+    i2c_sim_model_t model;       //!< Bus model, attach with i2c_sim_attach()
+    sim_mcp4728_reg_t input[4];  //!< DAC input registers
+    sim_mcp4728_reg_t output[4]; //!< Output registers, what the pins show
+    sim_mcp4728_reg_t eeprom[4]; //!< EEPROM
+    bool ldac;                   //!< LDAC pin level, outputs follow input registers while low
+    uint32_t eeprom_write_us;    //!< EEPROM write cycle
+    int64_t busy_until;          //!< End of EEPROM write cycle, i2c_sim_now() time
+    int64_t latched_at[4];       //!< Last load of each output register, i2c_sim_now() time
+
+    uint32_t eeprom_writes;      //!< EEPROM write cycles
+    uint32_t ignored;            //!< Commands ignored while busy
+
+    /* Decoder */
+    bool general;
+    uint8_t cmd;
+    uint8_t buf[3];
+    size_t pos;
+    uint8_t channel;
+    bool udac;
+    bool ignore;
+    uint8_t eeprom_pending;
+    size_t read_pos;
+} sim_mcp4728_t;
+
+/**
+ * @brief Init model with power-on state
+ *
+ * EEPROM is blank (all zero, VDD reference), registers are loaded from it,
+ * LDAC is low.
+ *
+ * @param dac Model
+ * @param addr Unshifted address, 0x60..0x67
+ */
+void sim_mcp4728_init(sim_mcp4728_t *dac, uint8_t addr);
+
+/**
+ * @brief true while an EEPROM write cycle is in progress
+ */
+bool sim_mcp4728_busy(const sim_mcp4728_t *dac);
+
+/**
+ * @brief Set LDAC pin level
+ *
+ * Falling edge latches all input registers to the outputs.
+ */
+void sim_mcp4728_set_ldac(sim_mcp4728_t *dac, bool level);
+
+#ifdef __cplusplus
+}
+#endif
+
+/**@}*/
+
+#endif /* __SIM_MCP4728_H__ */
@@ -0,0 +1,91 @@
+/**
+ * @file sim_tca9534.c
+ *
+ * TCA9534 model for the simulated I2C bus
+ *
+ * MIT Licensed as described in the file LICENSE
+ */
+#include <string.h>
+#include "sim_tca9534.h"
+
+#define REG_INPUT    0
+#define REG_OUTPUT   1
+#define REG_POLARITY 2
+#define REG_CONFIG   3
+
+static bool exp_start(i2c_sim_model_t *model, bool read, bool general)
+{
+    sim_tca9534_t *exp = model->ctx;
+
+    (void)general;
+    // Command byte is the first one written, pointer survives for reads
+    if (!read)
+        exp->have_ptr = false;
+    return true;
+}
+
+static bool exp_write(i2c_sim_model_t *model, uint8_t byte)
+{
+    sim_tca9534_t *exp = model->ctx;
+
+    if (!exp->have_ptr)
+    {
+        if (byte > REG_CONFIG)
+            return false;
+        exp->ptr = byte;
+        exp->have_ptr = true;
+        return true;
+    }
+    switch (exp->ptr)
+    {
+        case REG_OUTPUT:
+            exp->output = byte;
+            break;
+        case REG_POLARITY:
+            exp->polarity = byte;
+            break;
+        case REG_CONFIG:
+            exp->config = byte;
+            break;
+        default:
+            // Input port register is read only
+            break;
+    }
+    return true;
+}
+
+static uint8_t exp_read(i2c_sim_model_t *model)
+{
+    sim_tca9534_t *exp = model->ctx;
+
+    switch (exp->ptr)
+    {
+        case REG_INPUT:
+            return sim_tca9534_input(exp);
+        case REG_OUTPUT:
+            return exp->output;
+        case REG_POLARITY:
+            return exp->polarity;
+        default:
+            return exp->config;
+    }
+}
+
+void sim_tca9534_init(sim_tca9534_t *exp, uint8_t addr)
+{
+    memset(exp, 0, sizeof(*exp));
+    exp->model.addr = addr;
+    exp->model.ctx = exp;
+    exp->model.start = exp_start;
+    exp->model.write = exp_write;
+    exp->model.read = exp_read;
+    exp->output = 0xff;
+    exp->config = 0xff;
+    exp->pins = 0xff;
+}
+
+uint8_t sim_tca9534_input(const sim_tca9534_t *exp)
+{
+    uint8_t levels = (exp->pins & exp->config) | (exp->output & ~exp->config);
+    return levels ^ exp->polarity;
+}
@@ -0,0 +1,61 @@
+/**
+ * @file sim_tca9534.h
+ * @defgroup sim_tca9534 sim_tca9534
+ * @{
+ *
+ * TCA9534 model for the simulated I2C bus
+ *
+ * Input, output, polarity and configuration registers behind a command
+ * byte pointer. Invalid commands are NACKed. Pins configured as inputs
+ * read `pins`, outputs read back the output register.
+ *
+ * MIT Licensed as described in the file LICENSE
+ */
+#ifndef __SIM_TCA9534_H__
+#define __SIM_TCA9534_H__
+
+#include "i2c_sim.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Device state
+ */
+typedef struct
+{
+    i2c_sim_model_t model; //!< Bus model, attach with i2c_sim_attach()
+    uint8_t output;        //!< Output port register
+    uint8_t polarity;      //!< Polarity inversion register
+    uint8_t config;        //!< Configuration register, 1 is input
+    uint8_t pins;          //!< External levels of input pins
+
+    /* Decoder */
+    uint8_t ptr;
+    bool have_ptr;
+} sim_tca9534_t;
+
+/**
+ * @brief Init model with power-on state
+ *
+ * All pins are inputs, output register is 0xff, no inversion, input pins
+ * pulled high.
+ *
+ * @param exp Model
+ * @param addr Unshifted address, 0x20..0x27 (0x38..0x3f for TCA9534A)
+ */
+void sim_tca9534_init(sim_tca9534_t *exp, uint8_t addr);
+
+/**
+ * @brief Input port register value as read by the master
+ */
+uint8_t sim_tca9534_input(const sim_tca9534_t *exp);
+
+#ifdef __cplusplus
+}
+#endif
+
+/**@}*/
+
+#endif /* __SIM_TCA9534_H__ */
@@ -1,2 +1,6 @@
 COMPONENT_ADD_INCLUDEDIRS = .
-COMPONENT_DEPENDS = i2cdev log
+ifdef CONFIG_IDF_TARGET_ESP8266
+COMPONENT_DEPENDS = i2cdev log esp_idf_lib_helpers nvs_flash
+else
+COMPONENT_DEPENDS = i2cdev log esp_idf_lib_helpers esp_timer nvs_flash
+endif
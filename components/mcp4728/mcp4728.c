@@ -12,9 +12,18 @@
  * BSD Licensed as described in the file LICENSE
  */
 
+#include <stdio.h>
+#include <string.h>
 #include <esp_log.h>
+#include <esp_timer.h>
 #include <esp_idf_lib_helpers.h>
 #include "mcp4728.h"
+#if CONFIG_I2CDEV_SCL_CALIBRATION
+#include <i2c_scl.h>
+#endif
+#if CONFIG_MCP4728_CALIBRATION
+#include <nvs.h>
+#endif
 
 static const char *TAG = "mcp4728";
 
@@ -31,18 +40,44 @@ static const char *TAG = "mcp4728";
 #define MCP4728_CMD_GAINWRITE		0xC0
 #define MCP4728_CMD_PWRDWNWRITE		0xA0
 
-#define MCP4728_UDAC_UPLOAD			0x1
-#define MCP4728_UDAC_NOLOAD			0x0
+// UDAC bit: outputs load the input registers at once, or hold until LDAC or a general call update
+#define MCP4728_UDAC_UPLOAD			0x0
+#define MCP4728_UDAC_NOLOAD			0x1
+#define MCP4728_GC_ADDR				0x00
 
 
 #define BIT_READY  0x80
 
+#define FAST_WRITE_SIZE (MCP4728_NUM_CH * 2)
+#define MULTI_WRITE_SIZE (MCP4728_NUM_CH * 3)
+
+#define READBACK_SIZE 24
+#define PD_WRITE_SIZE 2
+#define SEQ_WRITE_SIZE (1 + MCP4728_NUM_CH * 2)
+
+#define EEPROM_POLL_US (CONFIG_MCP4728_EEPROM_POLL_MS * 1000)
+#define EEPROM_TIMEOUT_US 200000 // Write cycle is 50 ms max
+
+#define NVS_NAMESPACE "mcp4728"
+
+#define Q16_HALF 0x8000
+// Saturates any calibration and keeps Q16 products within 32 bits
+#define MV_MAX (CONFIG_MCP4728_VDD * 2)
+#define CAL_GAIN_MIN (MCP4728_CAL_ONE / 2)
+#define CAL_GAIN_MAX (MCP4728_CAL_ONE * 2)
+#define CAL_OFFSET_MAX_UV 100000
+
 #define CHECK(x) do { esp_err_t __; if ((__ = x) != ESP_OK) return __; } while (0)
 #define CHECK_ARG(VAL) do { if (!(VAL)) return ESP_ERR_INVALID_ARG; } while (0)
 
 
+/* Shadow of a device, shared by its descriptors. Fields mirror the DAC input
+ * registers and the EEPROM as of the last readback and the writes since. */
 typedef struct {
 	uint8_t id;
+	i2c_port_t port;
+	uint8_t refs;
+	bool valid;
 	uint16_t vdd;
 	uint16_t valueraw[MCP4728_NUM_CH];
 	uint8_t gain[MCP4728_NUM_CH];
@@ -54,6 +89,175 @@ typedef struct {
 	uint8_t epowerdown[MCP4728_NUM_CH];
 } mcp4728_array_t;
 
+/* Background tracking of the EEPROM write cycle of a device, same index as its shadow */
+typedef struct {
+	esp_timer_handle_t timer;
+	SemaphoreHandle_t idle;      // Given while no write cycle is tracked
+	StaticSemaphore_t idle_buf;
+	i2c_dev_seg_t seg;           // Status byte read
+	i2c_dev_req_t req;
+	uint8_t status;
+	int64_t start;
+	i2c_dev_t *dev;
+	mcp4728_eeprom_cb_t cb;
+	void *arg;
+	esp_err_t result;            // Of the last tracked write cycle
+} mcp4728_eeprom_job_t;
+
+/* Millivolt conversion of a channel: calibration and the Q16 factors derived from it */
+typedef struct {
+	mcp4728_cal_t cal;
+	int32_t mul;    // Codes per mV
+	int32_t add;    // Codes at 0 mV
+	int32_t rmul;   // mV per code
+	int32_t radd;   // mV at code 0
+} mcp4728_scale_t;
+
+static mcp4728_array_t shadows[NUM_MCP4728];
+static mcp4728_eeprom_job_t eeprom_jobs[NUM_MCP4728];
+static mcp4728_scale_t scales[NUM_MCP4728][MCP4728_NUM_CH];
+static portMUX_TYPE shadow_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// Call with shadow_lock held
+static mcp4728_array_t *shadow_find(const i2c_dev_t *dev)
+{
+    for (size_t i = 0; i < NUM_MCP4728; i++)
+        if (shadows[i].refs && shadows[i].id == dev->addr && shadows[i].port == dev->port)
+            return &shadows[i];
+    return NULL;
+}
+
+/* Shadow of the device, a new one for its first descriptor */
+static mcp4728_array_t *shadow_acquire(const i2c_dev_t *dev, bool *first)
+{
+    portENTER_CRITICAL(&shadow_lock);
+    mcp4728_array_t *s = shadow_find(dev);
+    for (size_t i = 0; !s && i < NUM_MCP4728; i++)
+        if (!shadows[i].refs)
+        {
+            s = &shadows[i];
+            memset(s, 0, sizeof(mcp4728_array_t));
+            s->id = dev->addr;
+            s->port = dev->port;
+            s->vdd = CONFIG_MCP4728_VDD;
+        }
+    if (s)
+        *first = !s->refs++;
+    portEXIT_CRITICAL(&shadow_lock);
+
+    return s;
+}
+
+/* true if it was the last descriptor of the device */
+static bool shadow_release(const i2c_dev_t *dev)
+{
+    portENTER_CRITICAL(&shadow_lock);
+    mcp4728_array_t *s = shadow_find(dev);
+    bool last = s && !--s->refs;
+    portEXIT_CRITICAL(&shadow_lock);
+
+    return last;
+}
+
+/* VREF PD1 PD0 Gx D11..D8, D7..D0 */
+static void shadow_set_input(mcp4728_array_t *s, uint8_t ch, uint8_t hi, uint8_t lo)
+{
+    s->vref[ch] = hi >> 7;
+    s->powerdown[ch] = (hi >> 5) & 3;
+    s->gain[ch] = (hi >> 4) & 1;
+    s->valueraw[ch] = ((uint16_t)(hi & 0x0f) << 8) | lo;
+}
+
+static void shadow_set_eeprom(mcp4728_array_t *s, uint8_t ch, uint8_t hi, uint8_t lo)
+{
+    s->evref[ch] = hi >> 7;
+    s->epowerdown[ch] = (hi >> 5) & 3;
+    s->egain[ch] = (hi >> 4) & 1;
+    s->evalueraw[ch] = ((uint16_t)(hi & 0x0f) << 8) | lo;
+}
+
+/* Apply written commands, as the device decodes them */
+static void shadow_apply(mcp4728_array_t *s, const uint8_t *data, size_t size)
+{
+    uint8_t ch = 0;
+    size_t i = 0;
+
+    while (i < size)
+    {
+        uint8_t cmd = data[i];
+        if ((cmd & 0xc0) == MCP4728_CMD_FASTWRITE)
+        {
+            // 0 0 PD1 PD0 D11..D8, D7..D0 per channel from A, reference and gain kept
+            if (i + 2 > size)
+                break;
+            s->powerdown[ch] = (cmd >> 4) & 3;
+            s->valueraw[ch] = ((uint16_t)(cmd & 0x0f) << 8) | data[i + 1];
+            ch = (ch + 1) % MCP4728_NUM_CH;
+            i += 2;
+        }
+        else if ((cmd & 0xf8) == MCP4728_CMD_DACWRITE_MULTI || (cmd & 0xf8) == MCP4728_CMD_DACWRITE_SINGLE)
+        {
+            if (i + 3 > size)
+                break;
+            shadow_set_input(s, (cmd >> 1) & 3, data[i + 1], data[i + 2]);
+            if ((cmd & 0xf8) == MCP4728_CMD_DACWRITE_SINGLE)
+                shadow_set_eeprom(s, (cmd >> 1) & 3, data[i + 1], data[i + 2]);
+            i += 3;
+        }
+        else if ((cmd & 0xf8) == MCP4728_CMD_DACWRITE_SEQ)
+        {
+            // Pairs from the start channel up to D, to registers and EEPROM
+            for (ch = (cmd >> 1) & 3, i++; ch < MCP4728_NUM_CH && i + 2 <= size; ch++, i += 2)
+            {
+                shadow_set_input(s, ch, data[i], data[i + 1]);
+                shadow_set_eeprom(s, ch, data[i], data[i + 1]);
+            }
+            break;
+        }
+        else if ((cmd & 0xe0) == MCP4728_CMD_VREFWRITE || (cmd & 0xe0) == MCP4728_CMD_GAINWRITE)
+        {
+            // One bit per channel, A is bit 3
+            for (uint8_t c = 0; c < MCP4728_NUM_CH; c++)
+            {
+                uint8_t bit = (cmd >> (3 - c)) & 1;
+                if ((cmd & 0xe0) == MCP4728_CMD_VREFWRITE)
+                    s->vref[c] = bit;
+                else
+                    s->gain[c] = bit;
+            }
+            i++;
+        }
+        else if ((cmd & 0xe0) == MCP4728_CMD_PWRDWNWRITE)
+        {
+            // 1 0 1 x PD1A PD0A PD1B PD0B, PD1C PD0C PD1D PD0D x x x x
+            if (i + 2 > size)
+                break;
+            uint8_t bits = (cmd << 4) | (data[i + 1] >> 4);
+            for (uint8_t c = 0; c < MCP4728_NUM_CH; c++)
+                s->powerdown[c] = (bits >> (6 - c * 2)) & 3;
+            i += 2;
+        }
+        else
+            break;
+    }
+}
+
+/* Update the shadow after a write, NULL data if it failed and the device
+ * state is unknown */
+static void shadow_written(const i2c_dev_t *dev, const uint8_t *data, size_t size)
+{
+    portENTER_CRITICAL(&shadow_lock);
+    mcp4728_array_t *s = shadow_find(dev);
+    if (s && s->valid)
+    {
+        if (data)
+            shadow_apply(s, data, size);
+        else
+            s->valid = false;
+    }
+    portEXIT_CRITICAL(&shadow_lock);
+}
+
 
 static esp_err_t read_data(i2c_dev_t *dev, void *data, uint8_t size)
 {
@@ -64,6 +268,235 @@ static esp_err_t read_data(i2c_dev_t *dev, void *data, uint8_t size)
     return ESP_OK;
 }
 
+static esp_err_t write_data(i2c_dev_t *dev, const void *data, size_t size)
+{
+    I2C_DEV_TAKE_MUTEX(dev);
+    esp_err_t res = i2c_dev_write(dev, NULL, 0, data, size);
+    shadow_written(dev, res == ESP_OK ? data : NULL, size);
+    I2C_DEV_GIVE_MUTEX(dev);
+
+    return res;
+}
+
+/* Copy of the shadow, read from the device first if it is not valid */
+static esp_err_t shadow_get(i2c_dev_t *dev, mcp4728_array_t *copy)
+{
+    for (int attempt = 0; attempt < 2; attempt++)
+    {
+        portENTER_CRITICAL(&shadow_lock);
+        mcp4728_array_t *s = shadow_find(dev);
+        bool valid = s && s->valid;
+        if (valid)
+            *copy = *s;
+        portEXIT_CRITICAL(&shadow_lock);
+        if (!s)
+            return ESP_ERR_INVALID_STATE;
+        if (valid)
+            return ESP_OK;
+        // Failed write in between leaves it invalid again
+        CHECK(mcp4728_refresh(dev));
+    }
+
+    return ESP_ERR_INVALID_STATE;
+}
+
+/* Fast write of all channels: 0 0 PD1 PD0 D11..D8, D7..D0 per channel, A to D,
+ * normal mode. Returns the size. */
+static size_t put_fast(uint8_t *data, const uint16_t *values)
+{
+    for (size_t ch = 0; ch < MCP4728_NUM_CH; ch++)
+    {
+        data[ch * 2] = (values[ch] >> 8) & 0x0f;
+        data[ch * 2 + 1] = values[ch] & 0xff;
+    }
+
+    return FAST_WRITE_SIZE;
+}
+
+/* Multi-write and single write: command, VREF PD1 PD0 Gx D11..D8, D7..D0.
+ * VDD reference, normal mode, x1 gain. */
+static uint8_t *put_channel(uint8_t *p, uint8_t cmd, uint8_t ch, uint16_t value, uint8_t udac)
+{
+    *p++ = cmd | (ch << 1) | udac;
+    *p++ = (value >> 8) & 0x0f;
+    *p++ = value & 0xff;
+    return p;
+}
+
+static mcp4728_eeprom_job_t *eeprom_job(const i2c_dev_t *dev)
+{
+    portENTER_CRITICAL(&shadow_lock);
+    mcp4728_array_t *s = shadow_find(dev);
+    portEXIT_CRITICAL(&shadow_lock);
+
+    return s ? &eeprom_jobs[s - shadows] : NULL;
+}
+
+static void eeprom_done(mcp4728_eeprom_job_t *job, esp_err_t res)
+{
+    i2c_dev_t *dev = job->dev;
+    mcp4728_eeprom_cb_t cb = job->cb;
+    void *arg = job->arg;
+
+    // EEPROM contents unknown, read them again
+    if (res != ESP_OK)
+        shadow_written(dev, NULL, 0);
+    job->result = res;
+    xSemaphoreGive(job->idle);
+
+    if (cb)
+        cb(dev, res, arg);
+}
+
+static void eeprom_poll_done(i2c_dev_req_t *req)
+{
+    mcp4728_eeprom_job_t *job = req->arg;
+
+    if (req->result == ESP_OK && (job->status & BIT_READY))
+        eeprom_done(job, ESP_OK);
+    else if (esp_timer_get_time() - job->start >= EEPROM_TIMEOUT_US)
+        eeprom_done(job, req->result == ESP_OK ? ESP_ERR_TIMEOUT : req->result);
+    else if (esp_timer_start_once(job->timer, EEPROM_POLL_US) != ESP_OK)
+        eeprom_done(job, ESP_FAIL);
+}
+
+/* Status byte through the port worker with CONFIG_I2CDEV_ASYNC, from the
+ * timer task otherwise */
+static void eeprom_poll(void *arg)
+{
+    mcp4728_eeprom_job_t *job = arg;
+
+    if (i2c_dev_submit(&job->req) != ESP_OK)
+    {
+        // Port queue full, try again next period
+        job->req.result = ESP_ERR_NO_MEM;
+        eeprom_poll_done(&job->req);
+    }
+}
+
+static esp_err_t eeprom_job_init(mcp4728_eeprom_job_t *job)
+{
+    memset(job, 0, sizeof(mcp4728_eeprom_job_t));
+
+    const esp_timer_create_args_t timer_args = {
+        .callback = eeprom_poll,
+        .arg = job,
+        .name = "mcp4728_eeprom",
+    };
+    CHECK(esp_timer_create(&timer_args, &job->timer));
+    job->idle = xSemaphoreCreateBinaryStatic(&job->idle_buf);
+    xSemaphoreGive(job->idle);
+
+    return ESP_OK;
+}
+
+static void eeprom_job_free(mcp4728_eeprom_job_t *job)
+{
+    // Write cycle in progress ends within the timeout
+    xSemaphoreTake(job->idle, portMAX_DELAY);
+    esp_timer_delete(job->timer);
+    vSemaphoreDelete(job->idle);
+    memset(job, 0, sizeof(mcp4728_eeprom_job_t));
+}
+
+/* Write that starts an EEPROM write cycle, tracked in the background */
+static esp_err_t eeprom_write(i2c_dev_t *dev, const uint8_t *data, size_t size, mcp4728_eeprom_cb_t cb, void *arg)
+{
+    mcp4728_eeprom_job_t *job = eeprom_job(dev);
+    if (!job)
+        return ESP_ERR_INVALID_STATE;
+    if (xSemaphoreTake(job->idle, 0) != pdTRUE)
+    {
+        ESP_LOGE(TAG, "[0x%02x at %d] EEPROM write in progress", dev->addr, dev->port);
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    esp_err_t res = write_data(dev, data, size);
+    if (res == ESP_OK)
+    {
+        job->dev = dev;
+        job->cb = cb;
+        job->arg = arg;
+        job->start = esp_timer_get_time();
+        job->seg = (i2c_dev_seg_t){ .dev = dev, .read = true, .data = &job->status, .size = 1 };
+        job->req = (i2c_dev_req_t){
+            .segs = &job->seg,
+            .count = 1,
+            .callback = eeprom_poll_done,
+            .arg = job,
+            .prio = I2C_DEV_PRIO_BULK,
+        };
+        res = esp_timer_start_once(job->timer, EEPROM_POLL_US);
+    }
+    if (res != ESP_OK)
+    {
+        job->result = res;
+        xSemaphoreGive(job->idle);
+    }
+
+    return res;
+}
+
+static const mcp4728_cal_t cal_ideal = { .gain = MCP4728_CAL_ONE, .offset_uv = 0 };
+
+/* Ideal output is code * VDD / 4096, calibrated output is ideal * gain + offset */
+static void scale_set(mcp4728_scale_t *sc, const mcp4728_cal_t *cal)
+{
+    sc->cal = *cal;
+    sc->mul = ((int64_t)4096 << 32) / ((int64_t)cal->gain * CONFIG_MCP4728_VDD);
+    sc->add = -(int32_t)((int64_t)cal->offset_uv * sc->mul / 1000);
+    sc->rmul = (int64_t)cal->gain * CONFIG_MCP4728_VDD / 4096;
+    sc->radd = ((int64_t)cal->offset_uv << 16) / 1000;
+}
+
+static inline bool cal_valid(const mcp4728_cal_t *cal)
+{
+    return cal->gain >= CAL_GAIN_MIN && cal->gain <= CAL_GAIN_MAX
+        && cal->offset_uv >= -CAL_OFFSET_MAX_UV && cal->offset_uv <= CAL_OFFSET_MAX_UV;
+}
+
+/* Conversion of all channels of the device */
+static esp_err_t scales_get(const i2c_dev_t *dev, mcp4728_scale_t *sc)
+{
+    portENTER_CRITICAL(&shadow_lock);
+    mcp4728_array_t *s = shadow_find(dev);
+    if (s)
+        memcpy(sc, scales[s - shadows], sizeof(scales[0]));
+    portEXIT_CRITICAL(&shadow_lock);
+
+    return s ? ESP_OK : ESP_ERR_INVALID_STATE;
+}
+
+static inline uint16_t mv_raw(const mcp4728_scale_t *sc, uint16_t mv)
+{
+    int32_t raw = ((mv < MV_MAX ? mv : MV_MAX) * sc->mul + sc->add + Q16_HALF) >> 16;
+    return raw < 0 ? 0 : raw > MCP4728_MAX_VALUE ? MCP4728_MAX_VALUE : raw;
+}
+
+static inline uint16_t raw_mv(const mcp4728_scale_t *sc, uint16_t raw)
+{
+    int32_t mv = (raw * sc->rmul + sc->radd + Q16_HALF) >> 16;
+    return mv < 0 ? 0 : mv > UINT16_MAX ? UINT16_MAX : mv;
+}
+
+/* One EEPROM write cycle from the shadowed registers of \p first: a single
+ * write if it is the only channel in \p channels, a sequential write up to D
+ * otherwise. Returns the size. */
+static size_t put_stored(uint8_t *data, const mcp4728_array_t *s, uint8_t first, uint8_t channels)
+{
+    uint8_t *p = data;
+    bool single = channels == MCP4728_CH_BIT(first);
+
+    *p++ = (single ? MCP4728_CMD_DACWRITE_SINGLE : MCP4728_CMD_DACWRITE_SEQ) | (first << 1) | MCP4728_UDAC_UPLOAD;
+    for (uint8_t ch = first; ch < (single ? first + 1 : MCP4728_NUM_CH); ch++)
+    {
+        *p++ = (s->vref[ch] << 7) | (s->powerdown[ch] << 5) | (s->gain[ch] << 4) | (s->valueraw[ch] >> 8);
+        *p++ = s->valueraw[ch] & 0xff;
+    }
+
+    return p - data;
+}
+
 esp_err_t mcp4728_init_desc(i2c_dev_t *dev, i2c_port_t port, uint8_t addr, gpio_num_t sda_gpio, gpio_num_t scl_gpio)
 {
     CHECK_ARG(dev);
@@ -73,24 +506,128 @@ esp_err_t mcp4728_init_desc(i2c_dev_t *dev, i2c_port_t port, uint8_t addr, gpio_
         return ESP_ERR_INVALID_ARG;
     }
 
-    dev->port = port;
-    dev->addr = addr;
-    dev->cfg.sda_io_num = sda_gpio;
-    dev->cfg.scl_io_num = scl_gpio;
+    i2c_config_t cfg = {
+        .sda_io_num = sda_gpio,
+        .scl_io_num = scl_gpio,
+    };
 #if HELPER_TARGET_IS_ESP32
-    dev->cfg.master.clk_speed = I2C_FREQ_HZ;
+    cfg.master.clk_speed = I2C_FREQ_HZ;
 #endif
 
-    return i2c_dev_create_mutex(dev);
+    dev->addr = addr;
+    dev->port = port;
+    bool first;
+    mcp4728_array_t *s = shadow_acquire(dev, &first);
+    if (!s)
+    {
+        ESP_LOGE(TAG, "[0x%02x at %d] No shadow left, NUM_MCP4728 is %d", addr, port, NUM_MCP4728);
+        return ESP_ERR_NO_MEM;
+    }
+    if (first)
+        for (uint8_t ch = 0; ch < MCP4728_NUM_CH; ch++)
+            scale_set(&scales[s - shadows][ch], &cal_ideal);
+    esp_err_t res = first ? eeprom_job_init(&eeprom_jobs[s - shadows]) : ESP_OK;
+    if (res == ESP_OK)
+        res = i2c_dev_attach(dev, port, &cfg, 0);
+    if (res == ESP_OK && (res = i2c_dev_create_mutex(dev)) != ESP_OK)
+        i2c_dev_detach(dev);
+    if (res != ESP_OK)
+    {
+        mcp4728_eeprom_job_t *job = eeprom_job(dev);
+        if (shadow_release(dev) && job->timer)
+            eeprom_job_free(job);
+        return res;
+    }
+
+#if CONFIG_I2CDEV_SCL_CALIBRATION
+    // Measured frequency if the device was calibrated
+    i2c_scl_load(dev);
+#endif
+#if CONFIG_MCP4728_CALIBRATION
+    // Stored channel calibration, ideal if there is none
+    mcp4728_load_cal(dev);
+#endif
+
+    return ESP_OK;
 }
 
 esp_err_t mcp4728_free_desc(i2c_dev_t *dev)
 {
     CHECK_ARG(dev);
 
+    // Tracking of a write cycle started with this descriptor ends first
+    mcp4728_eeprom_wait(dev, portMAX_DELAY);
+
+    CHECK(i2c_dev_detach(dev));
+    mcp4728_eeprom_job_t *job = eeprom_job(dev);
+    if (shadow_release(dev) && job)
+        eeprom_job_free(job);
+
     return i2c_dev_delete_mutex(dev);
 }
 
+esp_err_t mcp4728_refresh(i2c_dev_t *dev)
+{
+    CHECK_ARG(dev);
+
+    uint8_t buf[READBACK_SIZE];
+
+    // Read and load under the device mutex, so no write of it lands in between
+    I2C_DEV_TAKE_MUTEX(dev);
+    I2C_DEV_CHECK(dev, i2c_dev_read(dev, NULL, 0, buf, sizeof(buf)));
+
+    portENTER_CRITICAL(&shadow_lock);
+    mcp4728_array_t *s = shadow_find(dev);
+    if (s)
+    {
+        // Per channel: info, DAC register hi, lo, info, EEPROM hi, lo
+        for (uint8_t ch = 0; ch < MCP4728_NUM_CH; ch++)
+        {
+            shadow_set_input(s, ch, buf[ch * 6 + 1], buf[ch * 6 + 2]);
+            shadow_set_eeprom(s, ch, buf[ch * 6 + 4], buf[ch * 6 + 5]);
+        }
+        s->valid = true;
+    }
+    portEXIT_CRITICAL(&shadow_lock);
+    I2C_DEV_GIVE_MUTEX(dev);
+
+    return s ? ESP_OK : ESP_ERR_INVALID_STATE;
+}
+
+#if CONFIG_I2CDEV_SCL_CALIBRATION
+
+// Readback info bytes carry channel and address bits: 0 DAC1 DAC0 0 A2 A1 A0
+static esp_err_t scl_check(i2c_dev_t *dev, void *arg)
+{
+    uint8_t buf[READBACK_SIZE];
+    CHECK(read_data(dev, buf, sizeof(buf)));
+
+    for (size_t i = 0; i < READBACK_SIZE / 3; i++)
+        if ((buf[i * 3] & 0x3f) != (((i / 2) << 4) | (dev->addr & 0x07)))
+            return ESP_ERR_INVALID_RESPONSE;
+
+    return ESP_OK;
+}
+
+esp_err_t mcp4728_calibrate_scl(i2c_dev_t *dev, uint32_t max_hz, uint32_t *hz)
+{
+    CHECK_ARG(dev);
+
+    i2c_scl_config_t cfg = I2C_SCL_CONFIG_DEFAULT(scl_check);
+    cfg.max_hz = max_hz;
+
+    return i2c_scl_calibrate(dev, &cfg, hz);
+}
+
+#else
+
+esp_err_t mcp4728_calibrate_scl(i2c_dev_t *dev, uint32_t max_hz, uint32_t *hz)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+#endif /* CONFIG_I2CDEV_SCL_CALIBRATION */
+
 esp_err_t mcp4728_eeprom_busy(i2c_dev_t *dev, bool *busy)
 {
     CHECK_ARG(dev && busy);
@@ -107,10 +644,10 @@ esp_err_t mcp4728_get_power_mode(i2c_dev_t *dev, bool eeprom, mcp4728_power_mode
 {
     CHECK_ARG(dev && mode);
 
-    uint8_t buf[4];
-    CHECK(read_data(dev, buf, eeprom ? 4 : 1));
+    mcp4728_array_t s;
+    CHECK(shadow_get(dev, &s));
 
-    *mode = (eeprom ? buf[3] >> 5 : buf[0] >> 1) & 0x03;
+    *mode = eeprom ? s.epowerdown[MCP4728_CH_A] : s.powerdown[MCP4728_CH_A];
 
     return ESP_OK;
 }
@@ -119,32 +656,93 @@ esp_err_t mcp4728_set_power_mode(i2c_dev_t *dev, bool eeprom, mcp4728_power_mode
 {
     CHECK_ARG(dev);
 
-    uint16_t value;
-    CHECK(mcp4728_get_raw_output(dev, eeprom, &value));
+    uint8_t pd = (uint8_t)mode & 3;
+    if (!eeprom)
+    {
+        // 1 0 1 x PD1A PD0A PD1B PD0B, PD1C PD0C PD1D PD0D x x x x
+        uint8_t data[PD_WRITE_SIZE] = {
+            MCP4728_CMD_PWRDWNWRITE | (pd << 2) | pd,
+            (pd << 6) | (pd << 4)
+        };
+        return write_data(dev, data, sizeof(data));
+    }
 
-    uint8_t data[] = {
-        (MCP4728_CMD_PWRDWNWRITE) | (((uint8_t)mode & 3) << 1),
-        value >> 4,
-        value << 4
-    };
+    // EEPROM takes power-down bits only with values: sequential write of all
+    // channels with their shadowed values, reference and gain
+    mcp4728_array_t s;
+    CHECK(shadow_get(dev, &s));
 
-    I2C_DEV_TAKE_MUTEX(dev);
-    I2C_DEV_CHECK(dev, i2c_dev_write(dev, NULL, 0, data, 3));
-    I2C_DEV_GIVE_MUTEX(dev);
+    for (uint8_t ch = 0; ch < MCP4728_NUM_CH; ch++)
+        s.powerdown[ch] = pd;
+    uint8_t data[SEQ_WRITE_SIZE];
+    size_t size = put_stored(data, &s, MCP4728_CH_A, MCP4728_CH_ALL);
 
-    return ESP_OK;
+    return eeprom_write(dev, data, size, NULL, NULL);
+}
+
+static inline bool stored(const mcp4728_array_t *s, uint8_t ch)
+{
+    return s->valueraw[ch] == s->evalueraw[ch] && s->vref[ch] == s->evref[ch]
+        && s->gain[ch] == s->egain[ch] && s->powerdown[ch] == s->epowerdown[ch];
+}
+
+esp_err_t mcp4728_eeprom_commit(i2c_dev_t *dev, uint8_t channels, mcp4728_eeprom_cb_t cb, void *arg)
+{
+    CHECK_ARG(dev && channels && !(channels & ~MCP4728_CH_ALL));
+
+    mcp4728_array_t s;
+    CHECK(shadow_get(dev, &s));
+
+    uint8_t changed = 0;
+    for (uint8_t ch = 0; ch < MCP4728_NUM_CH; ch++)
+        if ((channels & MCP4728_CH_BIT(ch)) && !stored(&s, ch))
+            changed |= MCP4728_CH_BIT(ch);
+    if (!changed)
+    {
+        ESP_LOGV(TAG, "EEPROM up to date");
+        if (cb)
+            cb(dev, ESP_OK, arg);
+        return ESP_OK;
+    }
+
+    uint8_t first = 0;
+    while (!(changed & MCP4728_CH_BIT(first)))
+        first++;
+    uint8_t data[SEQ_WRITE_SIZE];
+    size_t size = put_stored(data, &s, first, changed);
+    ESP_LOGV(TAG, "EEPROM commit of channels 0x%x", changed);
+
+    return eeprom_write(dev, data, size, cb, arg);
+}
+
+esp_err_t mcp4728_eeprom_wait(i2c_dev_t *dev, TickType_t ticks)
+{
+    CHECK_ARG(dev);
+
+    mcp4728_eeprom_job_t *job = eeprom_job(dev);
+    if (!job || !job->idle)
+        return ESP_ERR_INVALID_STATE;
+    if (xSemaphoreTake(job->idle, ticks) != pdTRUE)
+        return ESP_ERR_TIMEOUT;
+    esp_err_t res = job->result;
+    xSemaphoreGive(job->idle);
+
+    return res;
 }
 
 esp_err_t mcp4728_get_raw_output(i2c_dev_t *dev, bool eeprom, uint16_t *value)
 {
-    CHECK_ARG(dev && value);
+    return mcp4728_get_channel_raw(dev, MCP4728_CH_A, eeprom, value);
+}
 
-    uint8_t buf[5];
-    CHECK(read_data(dev, buf, eeprom ? 5 : 3));
+esp_err_t mcp4728_get_channel_raw(i2c_dev_t *dev, uint8_t ch, bool eeprom, uint16_t *value)
+{
+    CHECK_ARG(dev && ch < MCP4728_NUM_CH && value);
 
-    *value = eeprom
-        ? ((uint16_t)(buf[3] & 0x0f) << 8) | buf[4]
-        : ((uint16_t)buf[0] << 4) | (buf[1] >> 4);
+    mcp4728_array_t s;
+    CHECK(shadow_get(dev, &s));
+
+    *value = eeprom ? s.evalueraw[ch] : s.valueraw[ch];
 
     return ESP_OK;
 }
@@ -153,19 +751,16 @@ esp_err_t mcp4728_set_raw_output(i2c_dev_t *dev, uint16_t value, bool eeprom)
 {
     CHECK_ARG(dev);
 
-    uint8_t data[] = {
-        (eeprom ? MCP4728_CMD_DACWRITE_SEQ : MCP4728_CMD_FASTWRITE),
-        value >> 4,
-        value << 4
-    };
-
     ESP_LOGV(TAG, "Set output value to %u", value);
 
-    I2C_DEV_TAKE_MUTEX(dev);
-    I2C_DEV_CHECK(dev, i2c_dev_write(dev, NULL, 0, data, 3));
-    I2C_DEV_GIVE_MUTEX(dev);
+    if (!eeprom)
+        return mcp4728_fast_write(dev, value);
 
-    return ESP_OK;
+    // Single write updates channel A and its EEPROM only
+    uint8_t data[3];
+    put_channel(data, MCP4728_CMD_DACWRITE_SINGLE, MCP4728_CH_A, value, MCP4728_UDAC_UPLOAD);
+
+    return eeprom_write(dev, data, sizeof(data), NULL, NULL);
 }
 
 esp_err_t mcp4728_fast_write(i2c_dev_t *dev, uint16_t value)
@@ -174,15 +769,34 @@ esp_err_t mcp4728_fast_write(i2c_dev_t *dev, uint16_t value)
     uint8_t data[] = {
         (value >> 8) & 0x0F,
         value & 0xFF
-    };  
+    };
 
     ESP_LOGV(TAG, "Set output value to %u", value);
 
-    I2C_DEV_TAKE_MUTEX(dev);
-    I2C_DEV_CHECK(dev, i2c_dev_write(dev, NULL, 0, data, 2));
-    I2C_DEV_GIVE_MUTEX(dev);
+    return write_data(dev, data, sizeof(data));
+}
 
-    return ESP_OK;
+esp_err_t mcp4728_fast_write_all(i2c_dev_t *dev, const uint16_t *values)
+{
+    CHECK_ARG(dev && values);
+
+    uint8_t data[FAST_WRITE_SIZE];
+
+    return write_data(dev, data, put_fast(data, values));
+}
+
+esp_err_t mcp4728_multi_write(i2c_dev_t *dev, uint8_t channels, const uint16_t *values)
+{
+    CHECK_ARG(dev && values && channels && !(channels & ~MCP4728_CH_ALL));
+
+    // All four channels too: a fast write would be held while LDAC is high
+    uint8_t data[MULTI_WRITE_SIZE];
+    uint8_t *p = data;
+    for (uint8_t ch = 0; ch < MCP4728_NUM_CH; ch++)
+        if (channels & MCP4728_CH_BIT(ch))
+            p = put_channel(p, MCP4728_CMD_DACWRITE_MULTI, ch, values[ch], MCP4728_UDAC_UPLOAD);
+
+    return write_data(dev, data, p - data);
 }
 
 esp_err_t mcp4728_get_voltage(i2c_dev_t *dev, float vdd, bool eeprom, float *voltage)
@@ -197,28 +811,372 @@ esp_err_t mcp4728_get_voltage(i2c_dev_t *dev, float vdd, bool eeprom, float *vol
     return ESP_OK;
 }
 
+static inline uint16_t voltage_raw(float vdd, float value)
+{
+    float raw = MCP4728_MAX_VALUE / vdd * value;
+    return raw <= 0 ? 0 : raw >= MCP4728_MAX_VALUE ? MCP4728_MAX_VALUE : (uint16_t)raw;
+}
+
 esp_err_t mcp4728_set_voltage(i2c_dev_t *dev, float vdd, float value, bool eeprom)
 {
-    return mcp4728_set_raw_output(dev, MCP4728_MAX_VALUE / vdd * value, eeprom);
+    return mcp4728_set_raw_output(dev, voltage_raw(vdd, value), eeprom);
 }
 
-esp_err_t mcp4728_write_channel_raw(i2c_dev_t *dev,uint8_t ch, uint16_t value)
+esp_err_t mcp4728_set_voltages(i2c_dev_t *dev, float vdd, uint8_t channels, const float *values)
+{
+    CHECK_ARG(values);
+
+    uint16_t raw[MCP4728_NUM_CH] = { 0 };
+    for (uint8_t ch = 0; ch < MCP4728_NUM_CH; ch++)
+        if (channels & MCP4728_CH_BIT(ch))
+            raw[ch] = voltage_raw(vdd, values[ch]);
+
+    return mcp4728_multi_write(dev, channels, raw);
+}
+
+esp_err_t mcp4728_write_channel_raw(i2c_dev_t *dev, uint8_t ch, uint16_t value)
+{
+    CHECK_ARG(dev && ch < MCP4728_NUM_CH);
+
+    uint16_t values[MCP4728_NUM_CH] = { 0 };
+    values[ch] = value;
+
+    ESP_LOGV(TAG, "Set output value of ch %u to %u", ch, value);
+
+    return mcp4728_multi_write(dev, MCP4728_CH_BIT(ch), values);
+}
+
+/* Multi-write of the channels in \p channels that leaves the outputs as they
+ * are until LDAC falls or a general call update. Returns the size. */
+static size_t put_staged(uint8_t *data, uint8_t channels, const uint16_t *values)
+{
+    // Held as well with LDAC high, in two thirds of the bytes
+    if (channels == MCP4728_CH_ALL)
+        return put_fast(data, values);
+
+    uint8_t *p = data;
+    for (uint8_t ch = 0; ch < MCP4728_NUM_CH; ch++)
+        if (channels & MCP4728_CH_BIT(ch))
+            p = put_channel(p, MCP4728_CMD_DACWRITE_MULTI, ch, values[ch], MCP4728_UDAC_NOLOAD);
+
+    return p - data;
+}
+
+esp_err_t mcp4728_stage(i2c_dev_t *dev, uint8_t channels, const uint16_t *values)
+{
+    CHECK_ARG(dev && values && channels && !(channels & ~MCP4728_CH_ALL));
+
+    uint8_t data[MULTI_WRITE_SIZE];
+
+    return write_data(dev, data, put_staged(data, channels, values));
+}
+
+esp_err_t mcp4728_stage_batch(const mcp4728_stage_t *stages, size_t count, i2c_dev_t *gc)
+{
+    CHECK_ARG(stages && count && count <= MCP4728_STAGE_MAX && stages[0].dev);
+
+    i2c_port_t port = stages[0].dev->port;
+    for (size_t i = 0; i < count; i++)
+    {
+        const mcp4728_stage_t *st = &stages[i];
+        CHECK_ARG(st->dev && st->dev->port == port && st->channels && !(st->channels & ~MCP4728_CH_ALL));
+        for (size_t j = 0; j < i; j++)
+            CHECK_ARG(stages[j].dev->addr != st->dev->addr);
+    }
+    CHECK_ARG(!gc || (gc->addr == MCP4728_GC_ADDR && gc->port == port));
+
+    uint8_t data[MCP4728_STAGE_MAX][MULTI_WRITE_SIZE];
+    i2c_dev_seg_t segs[MCP4728_STAGE_MAX + 1];
+    uint8_t update = MCP4728_GC_UPDATE;
+    memset(segs, 0, sizeof(segs));
+    for (size_t i = 0; i < count; i++)
+    {
+        segs[i].dev = stages[i].dev;
+        segs[i].data = data[i];
+        segs[i].size = put_staged(data[i], stages[i].channels, stages[i].values);
+    }
+    if (gc)
+    {
+        segs[count].dev = gc;
+        segs[count].data = &update;
+        segs[count].size = 1;
+    }
+
+    // Device mutexes in address order, so overlapping batches cannot deadlock
+    uint16_t taken = 0;
+    esp_err_t res = ESP_OK;
+    for (uint8_t addr = MCP4728_I2CADDR_DEFAULT; addr <= MCP4728_I2CADDR_MAX && res == ESP_OK; addr++)
+        for (size_t i = 0; i < count && res == ESP_OK; i++)
+            if (stages[i].dev->addr == addr && (res = i2c_dev_take_mutex(stages[i].dev)) == ESP_OK)
+                taken |= 1 << i;
+
+    // Joined into one transaction, general call update last
+    bool ran = res == ESP_OK;
+    if (ran)
+        res = i2c_dev_batch(segs, gc ? count + 1 : count);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        if (!(taken & (1 << i)))
+            continue;
+        if (ran)
+            shadow_written(stages[i].dev, segs[i].result == ESP_OK ? data[i] : NULL, segs[i].size);
+        i2c_dev_give_mutex(stages[i].dev);
+    }
+
+    return res;
+}
+
+esp_err_t mcp4728_init_gc_desc(i2c_dev_t *gc, const i2c_dev_t *dev)
+{
+    CHECK_ARG(gc && dev && dev->bus);
+
+    // Same bus configuration as the device, so batches join both
+    memset(gc, 0, sizeof(i2c_dev_t));
+    gc->addr = MCP4728_GC_ADDR;
+    gc->port = dev->port;
+    CHECK(i2c_dev_attach(gc, dev->port, &dev->bus->cfg, dev->bus->timeout_ticks));
+
+    esp_err_t res = i2c_dev_create_mutex(gc);
+    if (res != ESP_OK)
+        i2c_dev_detach(gc);
+
+    return res;
+}
+
+esp_err_t mcp4728_free_gc_desc(i2c_dev_t *gc)
+{
+    CHECK_ARG(gc);
+
+    CHECK(i2c_dev_detach(gc));
+
+    return i2c_dev_delete_mutex(gc);
+}
+
+/* General call effect on the shadows of the port, \p ok false if it failed */
+static void shadows_general_call(i2c_port_t port, uint8_t cmd, bool ok)
+{
+    portENTER_CRITICAL(&shadow_lock);
+    for (size_t i = 0; i < NUM_MCP4728; i++)
+    {
+        mcp4728_array_t *s = &shadows[i];
+        if (!s->refs || s->port != port || !s->valid)
+            continue;
+        if (!ok)
+        {
+            s->valid = false;
+            continue;
+        }
+        for (uint8_t ch = 0; ch < MCP4728_NUM_CH; ch++)
+        {
+            if (cmd == MCP4728_GC_RESET)
+            {
+                s->valueraw[ch] = s->evalueraw[ch];
+                s->gain[ch] = s->egain[ch];
+                s->vref[ch] = s->evref[ch];
+                s->powerdown[ch] = s->epowerdown[ch];
+            }
+            else if (cmd == MCP4728_GC_WAKEUP)
+                s->powerdown[ch] = MCP4728_PM_NORMAL;
+        }
+    }
+    portEXIT_CRITICAL(&shadow_lock);
+}
+
+esp_err_t mcp4728_general_call(i2c_dev_t *gc, uint8_t cmd)
+{
+    CHECK_ARG(gc && gc->addr == MCP4728_GC_ADDR);
+    CHECK_ARG(cmd == MCP4728_GC_RESET || cmd == MCP4728_GC_WAKEUP || cmd == MCP4728_GC_UPDATE);
+
+    I2C_DEV_TAKE_MUTEX(gc);
+    esp_err_t res = i2c_dev_write(gc, NULL, 0, &cmd, 1);
+    // Update only moves input registers to the outputs, the shadow has the former
+    if (cmd != MCP4728_GC_UPDATE)
+        shadows_general_call(gc->port, cmd, res == ESP_OK);
+    I2C_DEV_GIVE_MUTEX(gc);
+
+    return res;
+}
+
+esp_err_t mcp4728_mv_to_raw(i2c_dev_t *dev, uint8_t ch, const uint16_t *mv, uint16_t *raw, size_t count)
+{
+    CHECK_ARG(dev && ch < MCP4728_NUM_CH && ((mv && raw) || !count));
+
+    mcp4728_scale_t sc[MCP4728_NUM_CH];
+    CHECK(scales_get(dev, sc));
+
+    for (size_t i = 0; i < count; i++)
+        raw[i] = mv_raw(&sc[ch], mv[i]);
+
+    return ESP_OK;
+}
+
+esp_err_t mcp4728_raw_to_mv(i2c_dev_t *dev, uint8_t ch, uint16_t raw, uint16_t *mv)
+{
+    CHECK_ARG(dev && ch < MCP4728_NUM_CH && mv);
+
+    mcp4728_scale_t sc[MCP4728_NUM_CH];
+    CHECK(scales_get(dev, sc));
+
+    *mv = raw_mv(&sc[ch], raw);
+
+    return ESP_OK;
+}
+
+esp_err_t mcp4728_set_mv(i2c_dev_t *dev, uint8_t ch, uint16_t mv)
+{
+    CHECK_ARG(ch < MCP4728_NUM_CH);
+
+    uint16_t values[MCP4728_NUM_CH] = { 0 };
+    values[ch] = mv;
+
+    return mcp4728_set_mvs(dev, MCP4728_CH_BIT(ch), values);
+}
+
+esp_err_t mcp4728_set_mvs(i2c_dev_t *dev, uint8_t channels, const uint16_t *mv)
+{
+    CHECK_ARG(dev && mv);
+
+    mcp4728_scale_t sc[MCP4728_NUM_CH];
+    CHECK(scales_get(dev, sc));
+
+    uint16_t raw[MCP4728_NUM_CH] = { 0 };
+    for (uint8_t ch = 0; ch < MCP4728_NUM_CH; ch++)
+        if (channels & MCP4728_CH_BIT(ch))
+            raw[ch] = mv_raw(&sc[ch], mv[ch]);
+
+    return mcp4728_multi_write(dev, channels, raw);
+}
+
+esp_err_t mcp4728_get_mv(i2c_dev_t *dev, uint8_t ch, bool eeprom, uint16_t *mv)
+{
+    CHECK_ARG(mv);
+
+    uint16_t raw;
+    CHECK(mcp4728_get_channel_raw(dev, ch, eeprom, &raw));
+
+    return mcp4728_raw_to_mv(dev, ch, raw, mv);
+}
+
+esp_err_t mcp4728_cal_two_point(uint16_t raw1, int32_t uv1, uint16_t raw2, int32_t uv2, mcp4728_cal_t *cal)
+{
+    CHECK_ARG(cal && raw1 != raw2 && raw1 <= 0x0fff && raw2 <= 0x0fff);
+
+    // Ideal step is (raw2 - raw1) * VDD * 1000 / 4096 uV
+    int64_t ideal = ((int64_t)raw2 - raw1) * CONFIG_MCP4728_VDD * 1000;
+    mcp4728_cal_t c;
+    c.gain = (((int64_t)uv2 - uv1) * 4096 * MCP4728_CAL_ONE) / ideal;
+    c.offset_uv = uv1 - ((int64_t)raw1 * CONFIG_MCP4728_VDD * 1000 * c.gain) / (4096LL * MCP4728_CAL_ONE);
+    CHECK_ARG(cal_valid(&c));
+
+    *cal = c;
+
+    return ESP_OK;
+}
+
+esp_err_t mcp4728_set_cal(i2c_dev_t *dev, uint8_t ch, const mcp4728_cal_t *cal)
+{
+    CHECK_ARG(dev && ch < MCP4728_NUM_CH && (!cal || cal_valid(cal)));
+
+    mcp4728_scale_t sc;
+    scale_set(&sc, cal ? cal : &cal_ideal);
+
+    portENTER_CRITICAL(&shadow_lock);
+    mcp4728_array_t *s = shadow_find(dev);
+    if (s)
+        scales[s - shadows][ch] = sc;
+    portEXIT_CRITICAL(&shadow_lock);
+
+    return s ? ESP_OK : ESP_ERR_INVALID_STATE;
+}
+
+esp_err_t mcp4728_get_cal(i2c_dev_t *dev, uint8_t ch, mcp4728_cal_t *cal)
+{
+    CHECK_ARG(dev && ch < MCP4728_NUM_CH && cal);
+
+    mcp4728_scale_t sc[MCP4728_NUM_CH];
+    CHECK(scales_get(dev, sc));
+
+    *cal = sc[ch].cal;
+
+    return ESP_OK;
+}
+
+#if CONFIG_MCP4728_CALIBRATION
+
+static void nvs_key(const i2c_dev_t *dev, char *key, size_t size)
+{
+    snprintf(key, size, "cal_%u_%02x", (unsigned)dev->port, dev->addr);
+}
+
+esp_err_t mcp4728_store_cal(i2c_dev_t *dev)
 {
-    esp_err_t test = ESP_ERR_INVALID_ARG;
     CHECK_ARG(dev);
-    if(ch < 0x03){
-        test = ESP_OK;
-        uint8_t data[] = {
-            MCP4728_CMD_DACWRITE_SINGLE | (ch <<1),
-            (1<<4)|((value >> 8) & 0x0F),
-            value & 0xFF
-        };  
 
-        ESP_LOGV(TAG, "Set output value of ch %x reg %x to , [0x%x] , [0x%x] ",ch, data[0],data[1],data[2]);
+    mcp4728_scale_t sc[MCP4728_NUM_CH];
+    CHECK(scales_get(dev, sc));
 
-        I2C_DEV_TAKE_MUTEX(dev);
-        I2C_DEV_CHECK(dev, i2c_dev_write(dev, NULL, 0, data, 3));
-        I2C_DEV_GIVE_MUTEX(dev);
+    mcp4728_cal_t cal[MCP4728_NUM_CH];
+    bool ideal = true;
+    for (uint8_t ch = 0; ch < MCP4728_NUM_CH; ch++)
+    {
+        cal[ch] = sc[ch].cal;
+        ideal = ideal && !memcmp(&cal[ch], &cal_ideal, sizeof(mcp4728_cal_t));
     }
-    return test;
+
+    char key[16];
+    nvs_handle_t nvs;
+    nvs_key(dev, key, sizeof(key));
+    CHECK(nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs));
+    // Nothing to keep for an ideal device
+    esp_err_t res = ideal ? nvs_erase_key(nvs, key) : nvs_set_blob(nvs, key, cal, sizeof(cal));
+    if (res == ESP_ERR_NVS_NOT_FOUND)
+        res = ESP_OK;
+    if (res == ESP_OK)
+        res = nvs_commit(nvs);
+    nvs_close(nvs);
+
+    return res;
+}
+
+esp_err_t mcp4728_load_cal(i2c_dev_t *dev)
+{
+    CHECK_ARG(dev);
+
+    char key[16];
+    nvs_handle_t nvs;
+    mcp4728_cal_t cal[MCP4728_NUM_CH];
+    size_t size = sizeof(cal);
+
+    nvs_key(dev, key, sizeof(key));
+    CHECK(nvs_open(NVS_NAMESPACE, NVS_READONLY, &nvs));
+    esp_err_t res = nvs_get_blob(nvs, key, cal, &size);
+    nvs_close(nvs);
+    CHECK(res);
+    if (size != sizeof(cal))
+        return ESP_ERR_INVALID_SIZE;
+    for (uint8_t ch = 0; ch < MCP4728_NUM_CH; ch++)
+        if (!cal_valid(&cal[ch]))
+            return ESP_ERR_INVALID_RESPONSE;
+
+    for (uint8_t ch = 0; ch < MCP4728_NUM_CH; ch++)
+        CHECK(mcp4728_set_cal(dev, ch, &cal[ch]));
+
+    ESP_LOGD(TAG, "[0x%02x at %d] Stored calibration loaded", dev->addr, dev->port);
+
+    return ESP_OK;
 }
+
+#else
+
+esp_err_t mcp4728_store_cal(i2c_dev_t *dev)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t mcp4728_load_cal(i2c_dev_t *dev)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+#endif /* CONFIG_MCP4728_CALIBRATION */
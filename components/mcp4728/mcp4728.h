@@ -36,7 +36,14 @@ extern "C" {
 #endif /* CONFIG_MCP4728_LIMITRANGE */
  
 
-#define NUM_MCP4728 1
+#define NUM_MCP4728 CONFIG_MCP4728_MAX_DEVICES //!< Devices with a shadow, see ::mcp4728_init_desc()
+
+#define MCP4728_STAGE_MAX 8 //!< Devices of one port in a staged batch, one per address
+
+#define MCP4728_GC_RESET  0x06 //!< General call reset: registers reload from EEPROM
+#define MCP4728_GC_UPDATE 0x08 //!< General call software update: outputs load the input registers
+#define MCP4728_GC_WAKEUP 0x09 //!< General call wake-up: power-down bits are cleared
+
 /**
  * Power mode, see datasheet
  */
@@ -48,21 +55,72 @@ typedef enum
     MCP4728_PM_PD_500K,      //!< Power down, 500kOhm resistor to ground
 } mcp4728_power_mode_t;
 
+/**
+ * Output channel
+ */
 typedef enum
 {
-    MCP4728_CH_A = 0,   //!< Normal mode
-    MCP4728_CH_B,        //!< Power down, 1kOhm resistor to ground
-    MCP4728_CH_C,      //!< Power down, 100kOhm resistor to ground
-    MCP4728_CH_D,      //!< Power down, 500kOhm resistor to ground
+    MCP4728_CH_A = 0,   //!< Channel A
+    MCP4728_CH_B,       //!< Channel B
+    MCP4728_CH_C,       //!< Channel C
+    MCP4728_CH_D,       //!< Channel D
     MCP4728_NUM_CH,
 } mcp4728_channel_t;
 
+#define MCP4728_CH_BIT(ch) (1 << (ch))  //!< Channel bit in a channel mask
+#define MCP4728_CH_ALL 0x0f              //!< Mask of all channels
+
+#define MCP4728_CAL_ONE 65536 //!< Calibration gain of 1.0
+
+/**
+ * Values staged on a device, see ::mcp4728_stage_batch()
+ */
+typedef struct
+{
+    i2c_dev_t *dev;                   //!< I2C device descriptor
+    uint8_t channels;                 //!< Mask of channels to stage, see ::MCP4728_CH_BIT()
+    uint16_t values[MCP4728_NUM_CH];  //!< Raw values per channel, A to D, 0..4095
+} mcp4728_stage_t;
+
+/**
+ * Calibration of a channel, see ::mcp4728_set_cal()
+ *
+ * Output is modelled as `code * CONFIG_MCP4728_VDD / 4096 * gain + offset`.
+ */
+typedef struct
+{
+    int32_t gain;      //!< Output per ideal output, Q16, ::MCP4728_CAL_ONE is 1.0, 0.5 to 2.0
+    int32_t offset_uv; //!< Output at code 0, microvolts, up to +-100 mV
+} mcp4728_cal_t;
+
+/**
+ * EEPROM write cycle completion callback, see ::mcp4728_eeprom_commit()
+ *
+ * Called from the i2cdev port worker with `CONFIG_I2CDEV_ASYNC`, from the
+ * esp_timer task otherwise, or from the committing task when there was
+ * nothing to write. Must not block.
+ *
+ * @param dev I2C device descriptor that started the write
+ * @param result `ESP_OK` when the device reported the cycle done,
+ *               `ESP_ERR_TIMEOUT` if it stayed busy
+ * @param arg User argument
+ */
+typedef void (*mcp4728_eeprom_cb_t)(i2c_dev_t *dev, esp_err_t result, void *arg);
 
 
 /**
  * @brief Initialize device descriptor
  *
- * Default SCL frequency is 1MHz
+ * Default SCL frequency is 1MHz, or the calibrated one stored in NVS
+ * with `CONFIG_I2CDEV_SCL_CALIBRATION`, see ::mcp4728_calibrate_scl()
+ *
+ * Descriptors of a device share its shadow: a copy of the channel registers
+ * and EEPROM kept current by every write of the driver, which serves the
+ * getters without bus transfers. Up to ::NUM_MCP4728 devices. No bus
+ * transfer here: the shadow is filled by the first getter, or at once
+ * with ::mcp4728_refresh(), which ::mcp4728_bank_init() calls for every
+ * device. Channel calibration stored in NVS is loaded with
+ * `CONFIG_MCP4728_CALIBRATION`, see ::mcp4728_store_cal()
  *
  * @param dev I2C device descriptor
  * @param port I2C port number
@@ -81,9 +139,39 @@ esp_err_t mcp4728_init_desc(i2c_dev_t *dev, i2c_port_t port, uint8_t addr, gpio_
  */
 esp_err_t mcp4728_free_desc(i2c_dev_t *dev);
 
+/**
+ * @brief Read device state into the shadow
+ *
+ * One 24 byte readback of all channel registers and EEPROM. Done by the
+ * first getter otherwise; call again when something other than the driver
+ * changed the device (general call, LDAC pin, another master). A failed
+ * write leaves the shadow to be read again as well.
+ *
+ * @param dev I2C device descriptor
+ * @return `ESP_OK` on success
+ */
+esp_err_t mcp4728_refresh(i2c_dev_t *dev);
+
+/**
+ * @brief Calibrate SCL frequency and store it in NVS
+ *
+ * Steps the frequency up to \p max_hz, checking channel and address bits
+ * of the 24 byte readback at every step, see ::i2c_scl_calibrate().
+ * Needs `CONFIG_I2CDEV_SCL_CALIBRATION`.
+ *
+ * @param dev I2C device descriptor
+ * @param max_hz Highest frequency to try
+ * @param[out] hz Calibrated frequency if non-null
+ * @return `ESP_OK` on success
+ */
+esp_err_t mcp4728_calibrate_scl(i2c_dev_t *dev, uint32_t max_hz, uint32_t *hz);
+
 /**
  * @brief Get device EEPROM status
  *
+ * Reads RDY/BSY from the device, see ::mcp4728_eeprom_wait() to wait for
+ * a write cycle of the driver
+ *
  * @param dev I2C device descriptor
  * @param busy true when EEPROM is busy
  * @return `ESP_OK` on success
@@ -91,7 +179,9 @@ esp_err_t mcp4728_free_desc(i2c_dev_t *dev);
 esp_err_t mcp4728_eeprom_busy(i2c_dev_t *dev, bool *busy);
 
 /**
- * @brief Get power mode
+ * @brief Get power mode of channel A
+ *
+ * From the shadow, see ::mcp4728_refresh()
  *
  * @param dev I2C device descriptor
  * @param eeprom Read power mode from EEPROM if true
@@ -101,7 +191,11 @@ esp_err_t mcp4728_eeprom_busy(i2c_dev_t *dev, bool *busy);
 esp_err_t mcp4728_get_power_mode(i2c_dev_t *dev, bool eeprom, mcp4728_power_mode_t *mode);
 
 /**
- * @brief Set power mode
+ * @brief Set power mode of all channels
+ *
+ * Two byte power-down write, or a sequential write of all channels with
+ * their shadowed values, reference and gain that also stores them to
+ * EEPROM. EEPROM write cycles are tracked as for ::mcp4728_eeprom_commit()
  *
  * @param dev I2C device descriptor
  * @param mode Power mode
@@ -111,7 +205,9 @@ esp_err_t mcp4728_get_power_mode(i2c_dev_t *dev, bool eeprom, mcp4728_power_mode
 esp_err_t mcp4728_set_power_mode(i2c_dev_t *dev, bool eeprom, mcp4728_power_mode_t mode);
 
 /**
- * @brief Get current DAC value
+ * @brief Get current DAC value of channel A
+ *
+ * From the shadow, see ::mcp4728_refresh()
  *
  * @param dev I2C device descriptor
  * @param eeprom Read value from device EEPROM if true
@@ -120,9 +216,27 @@ esp_err_t mcp4728_set_power_mode(i2c_dev_t *dev, bool eeprom, mcp4728_power_mode
  */
 esp_err_t mcp4728_get_raw_output(i2c_dev_t *dev, bool eeprom, uint16_t *value);
 
+/**
+ * @brief Get current DAC value of a channel
+ *
+ * From the shadow, see ::mcp4728_refresh()
+ *
+ * @param dev I2C device descriptor
+ * @param ch Channel, see ::mcp4728_channel_t
+ * @param eeprom Read value from device EEPROM if true
+ * @param[out] value Raw output value, 0..4095
+ * @return `ESP_OK` on success
+ */
+esp_err_t mcp4728_get_channel_raw(i2c_dev_t *dev, uint8_t ch, bool eeprom, uint16_t *value);
+
 /**
  * @brief Set DAC output value
  *
+ * Sets channel A with a fast write, or with a single write that also
+ * stores it to EEPROM. EEPROM write cycles are tracked as for
+ * ::mcp4728_eeprom_commit(). A fast write leaves the output as it is
+ * while LDAC is high, see ::mcp4728_fast_write().
+ *
  * @param dev I2C device descriptor
  * @param value Raw output value, 0..4095
  * @param eeprom Store value to device EEPROM if true
@@ -131,7 +245,9 @@ esp_err_t mcp4728_get_raw_output(i2c_dev_t *dev, bool eeprom, uint16_t *value);
 esp_err_t mcp4728_set_raw_output(i2c_dev_t *dev, uint16_t value, bool eeprom);
 
 /**
- * @brief Get current DAC output voltage
+ * @brief Get current DAC output voltage of channel A
+ *
+ * From the shadow, see ::mcp4728_refresh()
  *
  * @param dev I2C device descriptor
  * @param vdd Device operating voltage, volts
@@ -152,10 +268,296 @@ esp_err_t mcp4728_get_voltage(i2c_dev_t *dev, float vdd, bool eeprom, float *vol
  */
 esp_err_t mcp4728_set_voltage(i2c_dev_t *dev, float vdd, float value, bool eeprom);
 
+/**
+ * @brief Set DAC output voltages of several channels in one transaction
+ *
+ * See ::mcp4728_multi_write()
+ *
+ * @param dev I2C device descriptor
+ * @param vdd Device operating voltage, volts
+ * @param channels Mask of channels to set, see ::MCP4728_CH_BIT()
+ * @param values Output values per channel, A to D, volts. Values of
+ *               channels not in \p channels are ignored
+ * @return `ESP_OK` on success
+ */
+esp_err_t mcp4728_set_voltages(i2c_dev_t *dev, float vdd, uint8_t channels, const float *values);
 
+/**
+ * @brief Set channel A output value with a fast write
+ *
+ * Two bytes, channel A is put into normal mode. Loads the input register
+ * only while LDAC is held high: the output follows on the LDAC falling
+ * edge or a general call update, see ::mcp4728_general_call()
+ *
+ * @param dev I2C device descriptor
+ * @param value Raw output value, 0..4095
+ * @return `ESP_OK` on success
+ */
 esp_err_t mcp4728_fast_write(i2c_dev_t *dev, uint16_t value);
-esp_err_t mcp4728_write_channel_raw(i2c_dev_t *dev,uint8_t ch, uint16_t value);
 
+/**
+ * @brief Set output values of all channels with one fast write
+ *
+ * Eight bytes in one transaction, all channels are put into normal mode,
+ * reference and gain are kept. Held while LDAC is high as
+ * ::mcp4728_fast_write()
+ *
+ * @param dev I2C device descriptor
+ * @param values Raw output values, A to D, 0..4095
+ * @return `ESP_OK` on success
+ */
+esp_err_t mcp4728_fast_write_all(i2c_dev_t *dev, const uint16_t *values);
+
+/**
+ * @brief Set output values of several channels in one transaction
+ *
+ * Multi-write of the channels in \p channels, three bytes per channel,
+ * EEPROM is not written. Channels get VDD reference, x1 gain and normal
+ * mode, outputs change at once whatever the LDAC level.
+ *
+ * @param dev I2C device descriptor
+ * @param channels Mask of channels to set, see ::MCP4728_CH_BIT()
+ * @param values Raw output values per channel, A to D, 0..4095. Values of
+ *               channels not in \p channels are ignored
+ * @return `ESP_OK` on success
+ */
+esp_err_t mcp4728_multi_write(i2c_dev_t *dev, uint8_t channels, const uint16_t *values);
+
+/**
+ * @brief Set output value of one channel
+ *
+ * Multi-write of one channel, EEPROM is not written
+ *
+ * @param dev I2C device descriptor
+ * @param ch Channel, see ::mcp4728_channel_t
+ * @param value Raw output value, 0..4095
+ * @return `ESP_OK` on success
+ */
+esp_err_t mcp4728_write_channel_raw(i2c_dev_t *dev, uint8_t ch, uint16_t value);
+
+/**
+ * @brief Stage values of several channels without changing the outputs
+ *
+ * Multi-write with the UDAC bit set: input registers take the values,
+ * outputs keep theirs until the LDAC pin falls or a general call update,
+ * see ::mcp4728_general_call(). Needs LDAC held high, outputs follow at
+ * once otherwise. Fast writes are held the same way while LDAC is high,
+ * so all four channels go as one, with the effects of
+ * ::mcp4728_fast_write_all(). The shadow holds the staged values.
+ *
+ * @param dev I2C device descriptor
+ * @param channels Mask of channels to stage, see ::MCP4728_CH_BIT()
+ * @param values Raw values per channel, A to D, 0..4095. Values of
+ *               channels not in \p channels are ignored
+ * @return `ESP_OK` on success
+ */
+esp_err_t mcp4728_stage(i2c_dev_t *dev, uint8_t channels, const uint16_t *values);
+
+/**
+ * @brief Stage values on several devices of a port in one transaction
+ *
+ * One staged multi-write per device, as ::mcp4728_stage(), joined with
+ * repeated starts into one bus transaction by ::i2c_dev_batch(), followed
+ * by a general call update through \p gc if given, so all outputs of the
+ * port change at once. Device mutexes are taken in address order.
+ *
+ * @param stages Devices and values, all on one port, one per device
+ * @param count Number of devices, up to ::MCP4728_STAGE_MAX
+ * @param gc General call descriptor of the port, see ::mcp4728_init_gc_desc(),
+ *           NULL to leave the outputs until a later update
+ * @return `ESP_OK` on success
+ */
+esp_err_t mcp4728_stage_batch(const mcp4728_stage_t *stages, size_t count, i2c_dev_t *gc);
+
+/**
+ * @brief Initialize general call descriptor
+ *
+ * Attached at address 0 with the bus configuration of \p dev, so batches
+ * join it with writes to the device.
+ *
+ * @param[out] gc General call descriptor
+ * @param dev Initialized device descriptor on the port
+ * @return `ESP_OK` on success
+ */
+esp_err_t mcp4728_init_gc_desc(i2c_dev_t *gc, const i2c_dev_t *dev);
+
+/**
+ * @brief Free general call descriptor
+ *
+ * @param gc General call descriptor
+ * @return `ESP_OK` on success
+ */
+esp_err_t mcp4728_free_gc_desc(i2c_dev_t *gc);
+
+/**
+ * @brief Send a general call command
+ *
+ * Reaches every device on the port that listens to general calls, not
+ * only MCP4728s. Shadows of the port follow reset and wake-up.
+ *
+ * @param gc General call descriptor, see ::mcp4728_init_gc_desc()
+ * @param cmd ::MCP4728_GC_RESET, ::MCP4728_GC_UPDATE or ::MCP4728_GC_WAKEUP
+ * @return `ESP_OK` on success
+ */
+esp_err_t mcp4728_general_call(i2c_dev_t *gc, uint8_t cmd);
+
+/**
+ * @brief Store channel registers to EEPROM where they differ
+ *
+ * Compares value, reference, gain and power mode of the channels in
+ * \p channels with their EEPROM copy in the shadow and stores the changed
+ * ones in one EEPROM write cycle: a single write of one channel, or a
+ * sequential write from the first changed channel through D. Channels in
+ * that range whose EEPROM differs are stored too, whether in \p channels
+ * or not.
+ *
+ * Returns once the command is written. RDY/BSY is then read every
+ * `CONFIG_MCP4728_EEPROM_POLL_MS` in the background, at bulk priority,
+ * and \p cb is called when the cycle is done. While it runs, EEPROM writes
+ * of the device fail with `ESP_ERR_INVALID_STATE`.
+ *
+ * @param dev I2C device descriptor
+ * @param channels Mask of channels to store, see ::MCP4728_CH_BIT()
+ * @param cb Completion callback if non-null, called once if the function
+ *           succeeds, at once if nothing differs
+ * @param arg User argument for \p cb
+ * @return `ESP_OK` on success
+ */
+esp_err_t mcp4728_eeprom_commit(i2c_dev_t *dev, uint8_t channels, mcp4728_eeprom_cb_t cb, void *arg);
+
+/**
+ * @brief Wait for the EEPROM write cycle of the driver
+ *
+ * @param dev I2C device descriptor
+ * @param ticks Time to wait, RTOS ticks
+ * @return Result of the last write cycle, `ESP_OK` if there was none,
+ *         `ESP_ERR_TIMEOUT` if it did not finish in time
+ */
+esp_err_t mcp4728_eeprom_wait(i2c_dev_t *dev, TickType_t ticks);
+
+
+/**
+ * @brief Convert millivolts to raw values of a channel
+ *
+ * Integer math with Q16 factors derived from `CONFIG_MCP4728_VDD` and
+ * the channel calibration, VDD reference and x1 gain as the driver sets
+ * them. Clamped to 0..::MCP4728_MAX_VALUE. Converting a whole block,
+ * e.g. for ::mcp4728_stream_write(), looks the factors up once.
+ *
+ * @param dev I2C device descriptor
+ * @param ch Channel, see ::mcp4728_channel_t
+ * @param mv Outputs, millivolts
+ * @param[out] raw Raw values, may be \p mv
+ * @param count Number of values
+ * @return `ESP_OK` on success
+ */
+esp_err_t mcp4728_mv_to_raw(i2c_dev_t *dev, uint8_t ch, const uint16_t *mv, uint16_t *raw, size_t count);
+
+/**
+ * @brief Convert a raw value of a channel to millivolts
+ *
+ * See ::mcp4728_mv_to_raw()
+ *
+ * @param dev I2C device descriptor
+ * @param ch Channel, see ::mcp4728_channel_t
+ * @param raw Raw value, 0..4095
+ * @param[out] mv Output, millivolts
+ * @return `ESP_OK` on success
+ */
+esp_err_t mcp4728_raw_to_mv(i2c_dev_t *dev, uint8_t ch, uint16_t raw, uint16_t *mv);
+
+/**
+ * @brief Set output of one channel, millivolts
+ *
+ * Calibrated, see ::mcp4728_mv_to_raw(), written as ::mcp4728_write_channel_raw()
+ *
+ * @param dev I2C device descriptor
+ * @param ch Channel, see ::mcp4728_channel_t
+ * @param mv Output, millivolts
+ * @return `ESP_OK` on success
+ */
+esp_err_t mcp4728_set_mv(i2c_dev_t *dev, uint8_t ch, uint16_t mv);
+
+/**
+ * @brief Set outputs of several channels in one transaction, millivolts
+ *
+ * Calibrated, see ::mcp4728_mv_to_raw(), written as ::mcp4728_multi_write()
+ *
+ * @param dev I2C device descriptor
+ * @param channels Mask of channels to set, see ::MCP4728_CH_BIT()
+ * @param mv Outputs per channel, A to D, millivolts. Values of channels
+ *           not in \p channels are ignored
+ * @return `ESP_OK` on success
+ */
+esp_err_t mcp4728_set_mvs(i2c_dev_t *dev, uint8_t channels, const uint16_t *mv);
+
+/**
+ * @brief Get output of a channel, millivolts
+ *
+ * Calibrated, from the shadow
+ *
+ * @param dev I2C device descriptor
+ * @param ch Channel, see ::mcp4728_channel_t
+ * @param eeprom Convert the EEPROM value if true
+ * @param[out] mv Output, millivolts
+ * @return `ESP_OK` on success
+ */
+esp_err_t mcp4728_get_mv(i2c_dev_t *dev, uint8_t ch, bool eeprom, uint16_t *mv);
+
+/**
+ * @brief Calibration from outputs measured at two raw values
+ *
+ * @param raw1 First raw value
+ * @param uv1 Output measured at \p raw1, microvolts
+ * @param raw2 Second raw value, far from the first for accuracy
+ * @param uv2 Output measured at \p raw2, microvolts
+ * @param[out] cal Calibration
+ * @return `ESP_OK` on success, `ESP_ERR_INVALID_ARG` if the result is out of range
+ */
+esp_err_t mcp4728_cal_two_point(uint16_t raw1, int32_t uv1, uint16_t raw2, int32_t uv2, mcp4728_cal_t *cal);
+
+/**
+ * @brief Set calibration of a channel
+ *
+ * Shared by the descriptors of the device, ideal until set or loaded
+ *
+ * @param dev I2C device descriptor
+ * @param ch Channel, see ::mcp4728_channel_t
+ * @param cal Calibration, NULL for ideal
+ * @return `ESP_OK` on success
+ */
+esp_err_t mcp4728_set_cal(i2c_dev_t *dev, uint8_t ch, const mcp4728_cal_t *cal);
+
+/**
+ * @brief Get calibration of a channel
+ *
+ * @param dev I2C device descriptor
+ * @param ch Channel, see ::mcp4728_channel_t
+ * @param[out] cal Calibration
+ * @return `ESP_OK` on success
+ */
+esp_err_t mcp4728_get_cal(i2c_dev_t *dev, uint8_t ch, mcp4728_cal_t *cal);
+
+/**
+ * @brief Store calibration of all channels in NVS
+ *
+ * Keyed by port and address; an ideal calibration erases the entry.
+ * ::mcp4728_init_desc() loads it. Needs `CONFIG_MCP4728_CALIBRATION`.
+ *
+ * @param dev I2C device descriptor
+ * @return `ESP_OK` on success
+ */
+esp_err_t mcp4728_store_cal(i2c_dev_t *dev);
+
+/**
+ * @brief Load calibration of all channels from NVS
+ *
+ * Needs `CONFIG_MCP4728_CALIBRATION`
+ *
+ * @param dev I2C device descriptor
+ * @return `ESP_OK` on success, `ESP_ERR_NVS_NOT_FOUND` if none is stored
+ */
+esp_err_t mcp4728_load_cal(i2c_dev_t *dev);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,218 @@
+/**
+ * @file mcp4728_bank.c
+ *
+ * Bank of MCP4728 DACs across I2C ports, latched together
+ *
+ * BSD Licensed as described in the file LICENSE
+ */
+#include <string.h>
+#include <esp_log.h>
+#include "mcp4728_bank.h"
+
+static const char *TAG = "mcp4728_bank";
+
+#define CHECK_ARG(VAL) do { if (!(VAL)) return ESP_ERR_INVALID_ARG; } while (0)
+
+#define PORT_BIT(port) (1 << (port))
+
+static inline size_t channels(const mcp4728_bank_t *bank)
+{
+    return bank->count * MCP4728_NUM_CH;
+}
+
+/* Staged writes of the changed devices on \p port, up to \p max, returns their number */
+static size_t port_stages(mcp4728_bank_t *bank, i2c_port_t port, mcp4728_stage_t *stages, size_t max,
+    uint32_t *staged)
+{
+    size_t n = 0;
+
+    for (size_t i = 0; i < bank->count && n < max; i++)
+    {
+        if (bank->dev[i].port != port || !bank->dirty[i])
+            continue;
+        stages[n].dev = &bank->dev[i];
+        stages[n].channels = bank->dirty[i];
+        memcpy(stages[n].values, bank->values[i], sizeof(stages[n].values));
+        for (uint8_t ch = 0; ch < MCP4728_NUM_CH; ch++)
+            *staged += (bank->dirty[i] >> ch) & 1;
+        n++;
+    }
+
+    return n;
+}
+
+esp_err_t mcp4728_bank_init(mcp4728_bank_t *bank, const mcp4728_bank_dac_t *dacs, size_t count)
+{
+    CHECK_ARG(bank && dacs && count && count <= NUM_MCP4728);
+    for (size_t i = 0; i < count; i++)
+    {
+        CHECK_ARG(dacs[i].port < I2C_NUM_MAX);
+        // Devices of a port are staged in one batch
+        size_t on_port = 1;
+        for (size_t j = 0; j < i; j++)
+        {
+            CHECK_ARG(dacs[j].port != dacs[i].port || dacs[j].addr != dacs[i].addr);
+            on_port += dacs[j].port == dacs[i].port;
+        }
+        CHECK_ARG(on_port <= MCP4728_STAGE_MAX);
+    }
+
+    memset(bank, 0, sizeof(mcp4728_bank_t));
+    bank->lock = xSemaphoreCreateMutexStatic(&bank->lock_buf);
+
+    esp_err_t res = ESP_OK;
+    for (size_t i = 0; i < count && res == ESP_OK; i++)
+    {
+        const mcp4728_bank_dac_t *d = &dacs[i];
+        res = mcp4728_init_desc(&bank->dev[i], d->port, d->addr, d->sda_gpio, d->scl_gpio);
+        if (res != ESP_OK)
+            break;
+        bank->count++;
+        if (!(bank->ports & PORT_BIT(d->port)))
+        {
+            res = mcp4728_init_gc_desc(&bank->gc[d->port], &bank->dev[i]);
+            if (res == ESP_OK)
+                bank->ports |= PORT_BIT(d->port);
+        }
+        // Registers and EEPROM, one readback into the shadow
+        if (res == ESP_OK)
+            res = mcp4728_refresh(&bank->dev[i]);
+        for (uint8_t ch = 0; ch < MCP4728_NUM_CH && res == ESP_OK; ch++)
+            res = mcp4728_get_channel_raw(&bank->dev[i], ch, false, &bank->values[i][ch]);
+    }
+    if (res != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Could not init device %u: %d", (unsigned)bank->count, res);
+        mcp4728_bank_free(bank);
+    }
+
+    return res;
+}
+
+esp_err_t mcp4728_bank_free(mcp4728_bank_t *bank)
+{
+    CHECK_ARG(bank && bank->lock);
+
+    for (size_t i = 0; i < bank->count; i++)
+        mcp4728_free_desc(&bank->dev[i]);
+    for (i2c_port_t port = 0; port < I2C_NUM_MAX; port++)
+        if (bank->ports & PORT_BIT(port))
+            mcp4728_free_gc_desc(&bank->gc[port]);
+    vSemaphoreDelete(bank->lock);
+    memset(bank, 0, sizeof(mcp4728_bank_t));
+
+    return ESP_OK;
+}
+
+esp_err_t mcp4728_bank_set(mcp4728_bank_t *bank, size_t channel, uint16_t value)
+{
+    return mcp4728_bank_set_many(bank, channel, &value, 1);
+}
+
+esp_err_t mcp4728_bank_get(mcp4728_bank_t *bank, size_t channel, uint16_t *value)
+{
+    CHECK_ARG(bank && bank->lock && value && channel < channels(bank));
+
+    xSemaphoreTake(bank->lock, portMAX_DELAY);
+    *value = bank->values[channel / MCP4728_NUM_CH][channel % MCP4728_NUM_CH];
+    xSemaphoreGive(bank->lock);
+
+    return ESP_OK;
+}
+
+esp_err_t mcp4728_bank_set_many(mcp4728_bank_t *bank, size_t first, const uint16_t *values, size_t count)
+{
+    CHECK_ARG(bank && bank->lock && (values || !count) && first + count <= channels(bank));
+
+    xSemaphoreTake(bank->lock, portMAX_DELAY);
+    for (size_t i = 0; i < count; i++)
+    {
+        size_t d = (first + i) / MCP4728_NUM_CH;
+        uint8_t ch = (first + i) % MCP4728_NUM_CH;
+        if (bank->values[d][ch] == values[i])
+            continue;
+        bank->values[d][ch] = values[i];
+        bank->dirty[d] |= MCP4728_CH_BIT(ch);
+    }
+    xSemaphoreGive(bank->lock);
+
+    return ESP_OK;
+}
+
+esp_err_t mcp4728_bank_write(mcp4728_bank_t *bank, size_t dac, uint8_t channels, const uint16_t *values)
+{
+    CHECK_ARG(bank && bank->lock && dac < bank->count && values && channels && !(channels & ~MCP4728_CH_ALL));
+
+    xSemaphoreTake(bank->lock, portMAX_DELAY);
+    esp_err_t res = mcp4728_multi_write(&bank->dev[dac], channels, values);
+    if (res == ESP_OK)
+    {
+        for (uint8_t ch = 0; ch < MCP4728_NUM_CH; ch++)
+            if (channels & MCP4728_CH_BIT(ch))
+                bank->values[dac][ch] = values[ch];
+        bank->dirty[dac] &= ~channels;
+    }
+    xSemaphoreGive(bank->lock);
+
+    return res;
+}
+
+esp_err_t mcp4728_bank_commit(mcp4728_bank_t *bank)
+{
+    CHECK_ARG(bank && bank->lock);
+
+    mcp4728_stage_t stages[MCP4728_STAGE_MAX];
+    uint32_t staged = 0, transactions = 0;
+    uint8_t latch = 0;
+    esp_err_t res = ESP_OK;
+
+    xSemaphoreTake(bank->lock, portMAX_DELAY);
+
+    // A single port latches in the staging transaction
+    bool joined = !(bank->ports & (bank->ports - 1));
+    for (i2c_port_t port = 0; port < I2C_NUM_MAX && res == ESP_OK; port++)
+    {
+        size_t n = port_stages(bank, port, stages, MCP4728_STAGE_MAX, &staged);
+        if (!n)
+            continue;
+        res = mcp4728_stage_batch(stages, n, joined ? &bank->gc[port] : NULL);
+        latch |= PORT_BIT(port);
+        transactions++;
+    }
+    // Updates of the ports back to back, one byte each
+    for (i2c_port_t port = 0; port < I2C_NUM_MAX && res == ESP_OK && !joined; port++)
+    {
+        if (!(latch & PORT_BIT(port)))
+            continue;
+        res = mcp4728_general_call(&bank->gc[port], MCP4728_GC_UPDATE);
+        transactions++;
+    }
+
+    if (res != ESP_OK)
+        bank->stats.errors++;
+    else if (latch)
+    {
+        memset(bank->dirty, 0, sizeof(bank->dirty));
+        bank->stats.commits++;
+        bank->stats.channels += staged;
+        bank->stats.transactions += transactions;
+    }
+
+    xSemaphoreGive(bank->lock);
+
+    return res;
+}
+
+esp_err_t mcp4728_bank_get_stats(mcp4728_bank_t *bank, mcp4728_bank_stats_t *stats, bool reset)
+{
+    CHECK_ARG(bank && bank->lock);
+
+    xSemaphoreTake(bank->lock, portMAX_DELAY);
+    if (stats)
+        *stats = bank->stats;
+    if (reset)
+        memset(&bank->stats, 0, sizeof(mcp4728_bank_stats_t));
+    xSemaphoreGive(bank->lock);
+
+    return ESP_OK;
+}
@@ -0,0 +1,179 @@
+/**
+ * @file mcp4728_bank.h
+ * @defgroup mcp4728_bank mcp4728_bank
+ * @{
+ *
+ * Bank of MCP4728 DACs across I2C ports, latched together
+ *
+ * Channels of all devices are numbered in configuration order, four per
+ * device. New values are set in RAM and go out on commit: every device
+ * with changed channels gets a staged multi-write, see ::mcp4728_stage(),
+ * the writes of a port are joined into one transaction and a general call
+ * software update then latches all outputs of the port. With one port the
+ * update ends that transaction. With more, all ports are staged first and
+ * their one byte updates follow back to back, so outputs of a port change
+ * one short transaction after those of the port before.
+ *
+ * LDAC of every device must be held high, outputs follow each write
+ * otherwise.
+ *
+ * BSD Licensed as described in the file LICENSE
+ */
+#ifndef __MCP4728_BANK_H__
+#define __MCP4728_BANK_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <esp_err.h>
+#include "mcp4728.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Device of a bank
+ */
+typedef struct
+{
+    i2c_port_t port;     //!< I2C port number
+    uint8_t addr;        //!< I2C address, one device per address and port
+    gpio_num_t sda_gpio; //!< SDA GPIO
+    gpio_num_t scl_gpio; //!< SCL GPIO
+} mcp4728_bank_dac_t;
+
+/**
+ * Bank counters, see ::mcp4728_bank_get_stats()
+ */
+typedef struct
+{
+    uint32_t commits;      //!< Commits that latched outputs
+    uint32_t channels;     //!< Channel values staged by them
+    uint32_t transactions; //!< Bus transactions of them
+    uint32_t errors;       //!< Failed commits
+} mcp4728_bank_stats_t;
+
+/**
+ * Bank, see ::mcp4728_bank_init()
+ */
+typedef struct
+{
+    size_t count;                                   //!< Number of devices
+    i2c_dev_t dev[NUM_MCP4728];                     //!< Device descriptors, in configuration order
+    i2c_dev_t gc[I2C_NUM_MAX];                      //!< General call descriptors per port
+    uint8_t ports;                                  //!< Mask of ports with devices
+    SemaphoreHandle_t lock;
+    StaticSemaphore_t lock_buf;
+    uint16_t values[NUM_MCP4728][MCP4728_NUM_CH];   //!< Last set values
+    uint8_t dirty[NUM_MCP4728];                     //!< Channels set since the last commit
+    mcp4728_bank_stats_t stats;
+} mcp4728_bank_t;
+
+/**
+ * @brief Init bank and its device descriptors
+ *
+ * Fills the shadow of every device with one readback, see
+ * ::mcp4728_refresh(), and takes its input registers as the starting
+ * values.
+ *
+ * @param bank Bank
+ * @param dacs Devices, up to ::NUM_MCP4728, up to ::MCP4728_STAGE_MAX per port
+ * @param count Number of devices
+ * @return `ESP_OK` on success
+ */
+esp_err_t mcp4728_bank_init(mcp4728_bank_t *bank, const mcp4728_bank_dac_t *dacs, size_t count);
+
+/**
+ * @brief Free bank and its device descriptors
+ *
+ * Values set and not committed are dropped.
+ *
+ * @param bank Bank
+ * @return `ESP_OK` on success
+ */
+esp_err_t mcp4728_bank_free(mcp4728_bank_t *bank);
+
+/**
+ * @brief Set value of a channel, to go out on the next commit
+ *
+ * No bus transfer. Setting the value a channel already has does not mark it.
+ *
+ * @param bank Bank
+ * @param channel Channel, device index * ::MCP4728_NUM_CH + channel of the device
+ * @param value Raw value, 0..4095
+ * @return `ESP_OK` on success
+ */
+esp_err_t mcp4728_bank_set(mcp4728_bank_t *bank, size_t channel, uint16_t value);
+
+/**
+ * @brief Get last set value of a channel
+ *
+ * Value set or written last, committed or not. No bus transfer.
+ *
+ * @param bank Bank
+ * @param channel Channel, see ::mcp4728_bank_set()
+ * @param[out] value Raw value
+ * @return `ESP_OK` on success
+ */
+esp_err_t mcp4728_bank_get(mcp4728_bank_t *bank, size_t channel, uint16_t *value);
+
+/**
+ * @brief Set values of consecutive channels, to go out on the next commit
+ *
+ * See ::mcp4728_bank_set()
+ *
+ * @param bank Bank
+ * @param first First channel
+ * @param values Raw values, 0..4095
+ * @param count Number of channels
+ * @return `ESP_OK` on success
+ */
+esp_err_t mcp4728_bank_set_many(mcp4728_bank_t *bank, size_t first, const uint16_t *values, size_t count);
+
+/**
+ * @brief Write channels of one device at once
+ *
+ * Multi-write that changes the outputs whatever the LDAC level, see
+ * ::mcp4728_multi_write(). Values set on other channels stay pending.
+ *
+ * @param bank Bank
+ * @param dac Device index
+ * @param channels Mask of channels to write, see ::MCP4728_CH_BIT()
+ * @param values Raw values per channel, A to D, 0..4095. Values of
+ *               channels not in \p channels are ignored
+ * @return `ESP_OK` on success
+ */
+esp_err_t mcp4728_bank_write(mcp4728_bank_t *bank, size_t dac, uint8_t channels, const uint16_t *values);
+
+/**
+ * @brief Stage the channels set since the last commit and latch all outputs
+ *
+ * One staged transaction per port with changed channels, see
+ * ::mcp4728_stage_batch(), and a general call update per such port. Does
+ * nothing if no channel changed. On failure the channels stay pending and
+ * the next commit writes them again.
+ *
+ * @param bank Bank
+ * @return `ESP_OK` on success
+ */
+esp_err_t mcp4728_bank_commit(mcp4728_bank_t *bank);
+
+/**
+ * @brief Get bank counters
+ *
+ * @param bank Bank
+ * @param[out] stats Counters if non-null
+ * @param reset Reset counters after reading if true
+ * @return `ESP_OK` on success
+ */
+esp_err_t mcp4728_bank_get_stats(mcp4728_bank_t *bank, mcp4728_bank_stats_t *stats, bool reset);
+
+#ifdef __cplusplus
+}
+#endif
+
+/**@}*/
+
+#endif /* __MCP4728_BANK_H__ */
@@ -0,0 +1,115 @@
+/**
+ * @file mcp4728_dds.c
+ *
+ * Integer DDS waveform generator for MCP4728 channels
+ *
+ * BSD Licensed as described in the file LICENSE
+ */
+#include <math.h>
+#include <string.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include "mcp4728_dds.h"
+
+#define CHECK_ARG(VAL) do { if (!(VAL)) return ESP_ERR_INVALID_ARG; } while (0)
+
+#define LUT_SHIFT (32 - MCP4728_DDS_LUT_BITS)
+#define LUT_MAX 0x0fff
+// Table deviation is scaled by amplitude / 2048
+#define AMP_SHIFT 11
+
+static uint16_t luts[MCP4728_DDS_USER][MCP4728_DDS_LUT_SIZE];
+static volatile bool luts_ready;
+
+// Float only here, once; samples are integer
+static void luts_build(void)
+{
+    for (uint32_t i = 0; i < MCP4728_DDS_LUT_SIZE; i++)
+    {
+        double s = sin(2 * M_PI * i / MCP4728_DDS_LUT_SIZE);
+        luts[MCP4728_DDS_SINE][i] = MCP4728_DDS_MID + (int32_t)lround(s * (MCP4728_DDS_MID - 1));
+
+        uint32_t half = MCP4728_DDS_LUT_SIZE / 2;
+        uint32_t rise = i < half ? i : MCP4728_DDS_LUT_SIZE - 1 - i;
+        luts[MCP4728_DDS_TRIANGLE][i] = rise * LUT_MAX / (half - 1);
+
+        luts[MCP4728_DDS_SQUARE][i] = i < half ? LUT_MAX : 0;
+    }
+}
+
+static inline uint16_t sample(mcp4728_dds_channel_t *c)
+{
+    int32_t dev = (int32_t)c->lut[c->acc >> LUT_SHIFT] - MCP4728_DDS_MID;
+    int32_t v = c->offset + ((dev * c->amplitude) >> AMP_SHIFT);
+    c->acc += c->inc;
+
+    return v < 0 ? 0 : v > MCP4728_MAX_VALUE ? MCP4728_MAX_VALUE : v;
+}
+
+esp_err_t mcp4728_dds_init(mcp4728_dds_t *dds, uint32_t rate_hz)
+{
+    CHECK_ARG(dds && rate_hz);
+
+    if (!luts_ready)
+    {
+        vTaskSuspendAll();
+        if (!luts_ready)
+        {
+            luts_build();
+            luts_ready = true;
+        }
+        xTaskResumeAll();
+    }
+
+    memset(dds, 0, sizeof(mcp4728_dds_t));
+    dds->rate_hz = rate_hz;
+
+    return ESP_OK;
+}
+
+esp_err_t mcp4728_dds_set_wave(mcp4728_dds_t *dds, uint8_t ch, const mcp4728_dds_wave_t *wave)
+{
+    CHECK_ARG(dds && ch < MCP4728_NUM_CH);
+
+    mcp4728_dds_channel_t *c = &dds->ch[ch];
+    if (!wave)
+    {
+        dds->channels &= ~MCP4728_CH_BIT(ch);
+        memset(c, 0, sizeof(mcp4728_dds_channel_t));
+        return ESP_OK;
+    }
+    CHECK_ARG(wave->shape <= MCP4728_DDS_USER && (wave->shape != MCP4728_DDS_USER || wave->lut));
+    CHECK_ARG(wave->amplitude <= MCP4728_DDS_MID && wave->offset <= LUT_MAX);
+    // Nyquist: rate_hz * 1000 / 2 millihertz
+    CHECK_ARG((uint64_t)wave->freq_mhz * 2 < (uint64_t)dds->rate_hz * 1000);
+
+    c->lut = wave->shape == MCP4728_DDS_USER ? wave->lut : luts[wave->shape];
+    c->inc = ((uint64_t)wave->freq_mhz << 32) / ((uint64_t)dds->rate_hz * 1000);
+    c->acc = wave->phase;
+    c->amplitude = wave->amplitude;
+    c->offset = wave->offset;
+    dds->channels |= MCP4728_CH_BIT(ch);
+
+    return ESP_OK;
+}
+
+esp_err_t mcp4728_dds_fill(mcp4728_dds_t *dds, uint8_t ch, uint16_t *buf, size_t count)
+{
+    CHECK_ARG(dds && ch < MCP4728_NUM_CH && (dds->channels & MCP4728_CH_BIT(ch)) && (buf || !count));
+
+    mcp4728_dds_channel_t *c = &dds->ch[ch];
+    for (size_t i = 0; i < count; i++)
+        buf[i] = sample(c);
+
+    return ESP_OK;
+}
+
+esp_err_t mcp4728_dds_next(mcp4728_dds_t *dds, uint16_t *values)
+{
+    CHECK_ARG(dds && values);
+
+    for (uint8_t ch = 0; ch < MCP4728_NUM_CH; ch++)
+        values[ch] = dds->channels & MCP4728_CH_BIT(ch) ? sample(&dds->ch[ch]) : 0;
+
+    return ESP_OK;
+}
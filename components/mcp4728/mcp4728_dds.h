@@ -0,0 +1,132 @@
+/**
+ * @file mcp4728_dds.h
+ * @defgroup mcp4728_dds mcp4728_dds
+ * @{
+ *
+ * Integer DDS waveform generator for MCP4728 channels
+ *
+ * Every channel has a 32-bit phase accumulator stepped once per sample;
+ * its top ::MCP4728_DDS_LUT_BITS bits index a 12-bit lookup table of one
+ * period. Sine, triangle and square tables are built once, user tables
+ * are the caller's. Table values are scaled by the channel amplitude
+ * around its offset and clamped to 0..::MCP4728_MAX_VALUE, all in
+ * integer math. Samples go to the DAC directly or fill
+ * mcp4728_stream blocks.
+ *
+ * BSD Licensed as described in the file LICENSE
+ */
+#ifndef __MCP4728_DDS_H__
+#define __MCP4728_DDS_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <esp_err.h>
+#include "mcp4728.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MCP4728_DDS_LUT_BITS 10                          //!< Phase bits indexing a table
+#define MCP4728_DDS_LUT_SIZE (1 << MCP4728_DDS_LUT_BITS) //!< Table entries per period
+#define MCP4728_DDS_MID 2048                             //!< Table value of zero amplitude
+
+/**
+ * Waveform shape
+ */
+typedef enum
+{
+    MCP4728_DDS_SINE = 0, //!< Sine
+    MCP4728_DDS_TRIANGLE, //!< Triangle, rising from the minimum
+    MCP4728_DDS_SQUARE,   //!< Square, high half first
+    MCP4728_DDS_USER,     //!< Caller's table
+} mcp4728_dds_shape_t;
+
+/**
+ * Channel waveform
+ */
+typedef struct
+{
+    mcp4728_dds_shape_t shape;
+    const uint16_t *lut;  /*!< ::MCP4728_DDS_LUT_SIZE values, 0..4095, ::MCP4728_DDS_MID
+                               is the offset, for ::MCP4728_DDS_USER. Kept by reference */
+    uint32_t freq_mhz;    //!< Frequency, millihertz, below half the sample rate
+    uint16_t amplitude;   //!< Peak deviation from the offset, raw value, up to 2048
+    uint16_t offset;      //!< Center, raw value
+    uint32_t phase;       //!< Start phase, 2^32 is a full period
+} mcp4728_dds_wave_t;
+
+/**
+ * Generator state of a channel
+ */
+typedef struct
+{
+    const uint16_t *lut;
+    uint32_t acc;
+    uint32_t inc;
+    int32_t amplitude;
+    int32_t offset;
+} mcp4728_dds_channel_t;
+
+/**
+ * Generator, see ::mcp4728_dds_init()
+ */
+typedef struct
+{
+    uint32_t rate_hz;                            //!< Sample rate
+    uint8_t channels;                            //!< Mask of channels with a waveform
+    mcp4728_dds_channel_t ch[MCP4728_NUM_CH];
+} mcp4728_dds_t;
+
+/**
+ * @brief Init generator, all channels off
+ *
+ * Builds the shared tables on first use.
+ *
+ * @param dds Generator
+ * @param rate_hz Sample rate
+ * @return `ESP_OK` on success
+ */
+esp_err_t mcp4728_dds_init(mcp4728_dds_t *dds, uint32_t rate_hz);
+
+/**
+ * @brief Set waveform of a channel
+ *
+ * Phase restarts at `wave->phase`.
+ *
+ * @param dds Generator
+ * @param ch Channel
+ * @param wave Waveform, NULL to turn the channel off
+ * @return `ESP_OK` on success
+ */
+esp_err_t mcp4728_dds_set_wave(mcp4728_dds_t *dds, uint8_t ch, const mcp4728_dds_wave_t *wave);
+
+/**
+ * @brief Fill samples of one channel
+ *
+ * @param dds Generator
+ * @param ch Channel with a waveform
+ * @param[out] buf Raw values
+ * @param count Number of samples
+ * @return `ESP_OK` on success
+ */
+esp_err_t mcp4728_dds_fill(mcp4728_dds_t *dds, uint8_t ch, uint16_t *buf, size_t count);
+
+/**
+ * @brief Next sample of all channels
+ *
+ * Channels without a waveform are set to 0.
+ *
+ * @param dds Generator
+ * @param[out] values Raw values, A to D, as for ::mcp4728_multi_write()
+ * @return `ESP_OK` on success
+ */
+esp_err_t mcp4728_dds_next(mcp4728_dds_t *dds, uint16_t *values);
+
+#ifdef __cplusplus
+}
+#endif
+
+/**@}*/
+
+#endif /* __MCP4728_DDS_H__ */
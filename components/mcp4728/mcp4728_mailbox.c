@@ -0,0 +1,155 @@
+/**
+ * @file mcp4728_mailbox.c
+ *
+ * Latest-value-wins mailbox for the channels of an MCP4728 bank
+ *
+ * BSD Licensed as described in the file LICENSE
+ */
+#include <string.h>
+#include <esp_log.h>
+#include "mcp4728_mailbox.h"
+
+static const char *TAG = "mcp4728_mailbox";
+
+#define CHECK_ARG(VAL) do { if (!(VAL)) return ESP_ERR_INVALID_ARG; } while (0)
+
+/**
+ * Hand the posted values to the bank and commit them
+ */
+static void mailbox_flush(mcp4728_mailbox_t *mb)
+{
+    uint16_t values[NUM_MCP4728 * MCP4728_NUM_CH];
+    uint8_t pending[NUM_MCP4728];
+
+    portENTER_CRITICAL(&mb->lock);
+    memcpy(values, mb->values, sizeof(values));
+    memcpy(pending, mb->pending, sizeof(pending));
+    memset(mb->pending, 0, sizeof(mb->pending));
+    mb->armed = false;
+    portEXIT_CRITICAL(&mb->lock);
+
+    uint32_t flushed = 0;
+    esp_err_t res = ESP_OK;
+    for (size_t i = 0; i < mb->bank->count * MCP4728_NUM_CH && res == ESP_OK; i++)
+    {
+        if (!(pending[i / MCP4728_NUM_CH] & MCP4728_CH_BIT(i % MCP4728_NUM_CH)))
+            continue;
+        res = mcp4728_bank_set(mb->bank, i, values[i]);
+        flushed++;
+    }
+    // Also retries values a failed commit left pending in the bank
+    if (res == ESP_OK)
+        res = mcp4728_bank_commit(mb->bank);
+
+    bool retry = false;
+    portENTER_CRITICAL(&mb->lock);
+    if (res != ESP_OK)
+    {
+        mb->stats.errors++;
+        retry = !mb->armed;
+        mb->armed = true;
+    }
+    else if (flushed)
+    {
+        mb->stats.flushes++;
+        mb->stats.flushed += flushed;
+    }
+    portEXIT_CRITICAL(&mb->lock);
+
+    // Commit again next period
+    if (retry)
+        xTaskNotifyGive(mb->task);
+}
+
+static void mailbox_task(void *arg)
+{
+    mcp4728_mailbox_t *mb = arg;
+    TickType_t last = xTaskGetTickCount() - mb->period;
+
+    while (!mb->stopping)
+    {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        if (mb->stopping)
+            break;
+        // One flush per period, values posted meanwhile replace older ones
+        TickType_t since = xTaskGetTickCount() - last;
+        if (since < mb->period)
+            vTaskDelay(mb->period - since);
+        mailbox_flush(mb);
+        last = xTaskGetTickCount();
+    }
+    mailbox_flush(mb);
+
+    xTaskNotifyGive(mb->stopper);
+    vTaskDelete(NULL);
+}
+
+esp_err_t mcp4728_mailbox_init(mcp4728_mailbox_t *mb, mcp4728_bank_t *bank, uint32_t period_ms)
+{
+    CHECK_ARG(mb && bank && bank->count);
+
+    memset(mb, 0, sizeof(mcp4728_mailbox_t));
+    mb->bank = bank;
+    mb->period = pdMS_TO_TICKS(period_ms);
+    mb->lock = (portMUX_TYPE)portMUX_INITIALIZER_UNLOCKED;
+
+    if (xTaskCreate(mailbox_task, "mcp4728_mailbox", CONFIG_MCP4728_MAILBOX_TASK_STACK, mb,
+            CONFIG_MCP4728_MAILBOX_TASK_PRIORITY, &mb->task) != pdPASS)
+    {
+        ESP_LOGE(TAG, "Could not create flusher task");
+        mb->task = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+
+    return ESP_OK;
+}
+
+esp_err_t mcp4728_mailbox_free(mcp4728_mailbox_t *mb)
+{
+    CHECK_ARG(mb && mb->task);
+
+    mb->stopper = xTaskGetCurrentTaskHandle();
+    mb->stopping = true;
+    xTaskNotifyGive(mb->task);
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    memset(mb, 0, sizeof(mcp4728_mailbox_t));
+
+    return ESP_OK;
+}
+
+esp_err_t mcp4728_mailbox_post(mcp4728_mailbox_t *mb, size_t channel, uint16_t value)
+{
+    CHECK_ARG(mb && mb->task && channel < mb->bank->count * MCP4728_NUM_CH);
+
+    uint8_t *pending = &mb->pending[channel / MCP4728_NUM_CH];
+    uint8_t bit = MCP4728_CH_BIT(channel % MCP4728_NUM_CH);
+
+    portENTER_CRITICAL(&mb->lock);
+    mb->stats.posted++;
+    if (*pending & bit)
+        mb->stats.coalesced++;
+    *pending |= bit;
+    mb->values[channel] = value;
+    bool wake = !mb->armed;
+    mb->armed = true;
+    portEXIT_CRITICAL(&mb->lock);
+
+    if (wake)
+        xTaskNotifyGive(mb->task);
+
+    return ESP_OK;
+}
+
+esp_err_t mcp4728_mailbox_get_stats(mcp4728_mailbox_t *mb, mcp4728_mailbox_stats_t *stats, bool reset)
+{
+    CHECK_ARG(mb);
+
+    portENTER_CRITICAL(&mb->lock);
+    if (stats)
+        *stats = mb->stats;
+    if (reset)
+        memset(&mb->stats, 0, sizeof(mcp4728_mailbox_stats_t));
+    portEXIT_CRITICAL(&mb->lock);
+
+    return ESP_OK;
+}
@@ -0,0 +1,111 @@
+/**
+ * @file mcp4728_mailbox.h
+ * @defgroup mcp4728_mailbox mcp4728_mailbox
+ * @{
+ *
+ * Latest-value-wins mailbox for the channels of an MCP4728 bank
+ *
+ * Producers post values without blocking; a value posted again before it
+ * is written replaces the older one. A flusher task wakes on the first
+ * post after a flush, waits until one period has passed since that flush,
+ * and hands the newest value of every posted channel to the bank in one
+ * commit, see ::mcp4728_bank_commit(). The bus thus sees at most one
+ * commit per period however fast values are posted. Values set on the
+ * bank by others go out with that commit too.
+ *
+ * BSD Licensed as described in the file LICENSE
+ */
+#ifndef __MCP4728_MAILBOX_H__
+#define __MCP4728_MAILBOX_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <esp_err.h>
+#include "mcp4728_bank.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Mailbox counters, see ::mcp4728_mailbox_get_stats()
+ */
+typedef struct
+{
+    uint32_t posted;    //!< Values posted
+    uint32_t coalesced; //!< Posted values replaced by a newer one before they were written
+    uint32_t flushes;   //!< Commits of posted values
+    uint32_t flushed;   //!< Channel values handed to the bank by them
+    uint32_t errors;    //!< Failed commits, retried one period later
+} mcp4728_mailbox_stats_t;
+
+/**
+ * Mailbox, see ::mcp4728_mailbox_init()
+ */
+typedef struct
+{
+    mcp4728_bank_t *bank;
+    TickType_t period;
+    TaskHandle_t task;
+    TaskHandle_t stopper;
+    volatile bool stopping;
+    portMUX_TYPE lock;
+    bool armed;                                    // Flusher notified since the last flush
+    uint16_t values[NUM_MCP4728 * MCP4728_NUM_CH]; // Newest posted values
+    uint8_t pending[NUM_MCP4728];                  // Posted channels per device
+    mcp4728_mailbox_stats_t stats;
+} mcp4728_mailbox_t;
+
+/**
+ * @brief Init mailbox and start its flusher task
+ *
+ * @param mb Mailbox
+ * @param bank Initialized bank, see ::mcp4728_bank_init()
+ * @param period_ms Shortest time between flushes, milliseconds, rounded
+ *                  to RTOS ticks
+ * @return `ESP_OK` on success
+ */
+esp_err_t mcp4728_mailbox_init(mcp4728_mailbox_t *mb, mcp4728_bank_t *bank, uint32_t period_ms);
+
+/**
+ * @brief Stop the flusher task and free mailbox
+ *
+ * Values posted before are written first.
+ *
+ * @param mb Mailbox
+ * @return `ESP_OK` on success
+ */
+esp_err_t mcp4728_mailbox_free(mcp4728_mailbox_t *mb);
+
+/**
+ * @brief Post value of a channel
+ *
+ * Never blocks: stores the value under a spinlock and notifies the
+ * flusher if it is idle. Not for ISRs.
+ *
+ * @param mb Mailbox
+ * @param channel Channel of the bank, see ::mcp4728_bank_set()
+ * @param value Raw value, 0..4095
+ * @return `ESP_OK` on success
+ */
+esp_err_t mcp4728_mailbox_post(mcp4728_mailbox_t *mb, size_t channel, uint16_t value);
+
+/**
+ * @brief Get mailbox counters
+ *
+ * @param mb Mailbox
+ * @param[out] stats Counters if non-null
+ * @param reset Reset counters after reading if true
+ * @return `ESP_OK` on success
+ */
+esp_err_t mcp4728_mailbox_get_stats(mcp4728_mailbox_t *mb, mcp4728_mailbox_stats_t *stats, bool reset);
+
+#ifdef __cplusplus
+}
+#endif
+
+/**@}*/
+
+#endif /* __MCP4728_MAILBOX_H__ */
@@ -0,0 +1,244 @@
+/**
+ * @file mcp4728_ramp.c
+ *
+ * Slew-rate-limited ramps for the channels of an MCP4728 bank
+ *
+ * BSD Licensed as described in the file LICENSE
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <esp_log.h>
+#include "mcp4728_ramp.h"
+
+static const char *TAG = "mcp4728_ramp";
+
+#define RAMP_FRAC 16
+#define RAMP_HALF (1 << (RAMP_FRAC - 1))
+
+#define CHECK(x) do { esp_err_t __; if ((__ = x) != ESP_OK) return __; } while (0)
+#define CHECK_ARG(VAL) do { if (!(VAL)) return ESP_ERR_INVALID_ARG; } while (0)
+
+static inline bool ramp_channel_ok(const mcp4728_ramp_t *ramp, size_t channel)
+{
+    return ramp && ramp->task && channel < ramp->bank->count * MCP4728_NUM_CH;
+}
+
+static inline uint16_t ramp_value(const mcp4728_ramp_ch_t *c)
+{
+    return (c->pos + RAMP_HALF) >> RAMP_FRAC;
+}
+
+/**
+ * Advance the active ramps and commit their values
+ *
+ * @return true while ramps are active or a commit has to be retried
+ */
+static bool ramp_tick(mcp4728_ramp_t *ramp)
+{
+    uint16_t values[NUM_MCP4728 * MCP4728_NUM_CH];
+    uint8_t changed[NUM_MCP4728];
+    size_t count = ramp->bank->count * MCP4728_NUM_CH;
+
+    portENTER_CRITICAL(&ramp->lock);
+    memcpy(changed, ramp->active, sizeof(changed));
+    for (size_t i = 0; i < count; i++)
+    {
+        uint8_t bit = MCP4728_CH_BIT(i % MCP4728_NUM_CH);
+        if (!(changed[i / MCP4728_NUM_CH] & bit))
+            continue;
+        mcp4728_ramp_ch_t *c = &ramp->ch[i];
+        int32_t left = ((int32_t)c->target << RAMP_FRAC) - c->pos;
+        // The step has the sign of the distance left, the last one is cut short
+        if (abs(left) <= abs(c->step))
+        {
+            c->pos = (int32_t)c->target << RAMP_FRAC;
+            ramp->active[i / MCP4728_NUM_CH] &= ~bit;
+            ramp->stats.finished++;
+        }
+        else
+            c->pos += c->step;
+        values[i] = ramp_value(c);
+    }
+    ramp->stats.ticks++;
+    portEXIT_CRITICAL(&ramp->lock);
+
+    esp_err_t res = ESP_OK;
+    for (size_t i = 0; i < count && res == ESP_OK; i++)
+        if (changed[i / MCP4728_NUM_CH] & MCP4728_CH_BIT(i % MCP4728_NUM_CH))
+            res = mcp4728_bank_set(ramp->bank, i, values[i]);
+    // Channels whose value did not change are not written
+    if (res == ESP_OK)
+        res = mcp4728_bank_commit(ramp->bank);
+
+    bool more = res != ESP_OK;
+    portENTER_CRITICAL(&ramp->lock);
+    if (res != ESP_OK)
+        ramp->stats.errors++;
+    for (size_t d = 0; d < ramp->bank->count && !more; d++)
+        more = ramp->active[d];
+    ramp->running = more;
+    portEXIT_CRITICAL(&ramp->lock);
+
+    return more;
+}
+
+static void ramp_task(void *arg)
+{
+    mcp4728_ramp_t *ramp = arg;
+
+    while (!ramp->stopping)
+    {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        // Ticks only while ramps are active, failed commits are retried
+        TickType_t wake = xTaskGetTickCount();
+        while (!ramp->stopping)
+        {
+            vTaskDelayUntil(&wake, ramp->period);
+            if (ramp->stopping || !ramp_tick(ramp))
+                break;
+        }
+    }
+
+    xTaskNotifyGive(ramp->stopper);
+    vTaskDelete(NULL);
+}
+
+/**
+ * Start or retarget the ramp of a channel, by number of ticks or by step
+ */
+static esp_err_t ramp_start(mcp4728_ramp_t *ramp, size_t channel, uint16_t target, uint32_t ticks, uint32_t step)
+{
+    CHECK_ARG(ramp_channel_ok(ramp, channel) && target <= MCP4728_MAX_VALUE);
+
+    uint16_t value;
+    CHECK(mcp4728_bank_get(ramp->bank, channel, &value));
+
+    mcp4728_ramp_ch_t *c = &ramp->ch[channel];
+    uint8_t *active = &ramp->active[channel / MCP4728_NUM_CH];
+    uint8_t bit = MCP4728_CH_BIT(channel % MCP4728_NUM_CH);
+
+    portENTER_CRITICAL(&ramp->lock);
+    bool retarget = *active & bit;
+    if (!retarget)
+        c->pos = (int32_t)value << RAMP_FRAC;
+    int32_t left = ((int32_t)target << RAMP_FRAC) - c->pos;
+    // Rounded up, so that the target is reached on the last tick
+    if (ticks)
+        step = (abs(left) + ticks - 1) / ticks;
+    c->step = left < 0 ? -(int32_t)step : (int32_t)step;
+    c->target = target;
+    *active |= bit;
+    ramp->stats.ramps++;
+    if (retarget)
+        ramp->stats.retargeted++;
+    bool wake = !ramp->running;
+    ramp->running = true;
+    portEXIT_CRITICAL(&ramp->lock);
+
+    if (wake)
+        xTaskNotifyGive(ramp->task);
+
+    return ESP_OK;
+}
+
+esp_err_t mcp4728_ramp_init(mcp4728_ramp_t *ramp, mcp4728_bank_t *bank, uint32_t period_ms)
+{
+    CHECK_ARG(ramp && bank && bank->count);
+
+    memset(ramp, 0, sizeof(mcp4728_ramp_t));
+    ramp->bank = bank;
+    ramp->period = pdMS_TO_TICKS(period_ms);
+    if (!ramp->period)
+        ramp->period = 1;
+    ramp->period_ms = ramp->period * portTICK_PERIOD_MS;
+    ramp->lock = (portMUX_TYPE)portMUX_INITIALIZER_UNLOCKED;
+
+    if (xTaskCreate(ramp_task, "mcp4728_ramp", CONFIG_MCP4728_RAMP_TASK_STACK, ramp,
+            CONFIG_MCP4728_RAMP_TASK_PRIORITY, &ramp->task) != pdPASS)
+    {
+        ESP_LOGE(TAG, "Could not create ramp task");
+        ramp->task = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+
+    return ESP_OK;
+}
+
+esp_err_t mcp4728_ramp_free(mcp4728_ramp_t *ramp)
+{
+    CHECK_ARG(ramp && ramp->task);
+
+    ramp->stopper = xTaskGetCurrentTaskHandle();
+    ramp->stopping = true;
+    xTaskNotifyGive(ramp->task);
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    memset(ramp, 0, sizeof(mcp4728_ramp_t));
+
+    return ESP_OK;
+}
+
+esp_err_t mcp4728_ramp_to(mcp4728_ramp_t *ramp, size_t channel, uint16_t target, uint32_t duration_ms)
+{
+    CHECK_ARG(ramp && ramp->period_ms);
+
+    uint32_t ticks = (duration_ms + ramp->period_ms - 1) / ramp->period_ms;
+
+    return ramp_start(ramp, channel, target, ticks ? ticks : 1, 0);
+}
+
+esp_err_t mcp4728_ramp_slew(mcp4728_ramp_t *ramp, size_t channel, uint16_t target, uint32_t rate)
+{
+    CHECK_ARG(ramp && ramp->period_ms && rate);
+
+    uint64_t step = ((uint64_t)rate * ramp->period_ms << RAMP_FRAC) / 1000;
+    if (step > (uint64_t)MCP4728_MAX_VALUE << RAMP_FRAC)
+        step = (uint64_t)MCP4728_MAX_VALUE << RAMP_FRAC;
+
+    return ramp_start(ramp, channel, target, 0, step ? (uint32_t)step : 1);
+}
+
+esp_err_t mcp4728_ramp_stop(mcp4728_ramp_t *ramp, size_t channel)
+{
+    CHECK_ARG(ramp_channel_ok(ramp, channel));
+
+    portENTER_CRITICAL(&ramp->lock);
+    ramp->active[channel / MCP4728_NUM_CH] &= ~MCP4728_CH_BIT(channel % MCP4728_NUM_CH);
+    portEXIT_CRITICAL(&ramp->lock);
+
+    return ESP_OK;
+}
+
+esp_err_t mcp4728_ramp_get(mcp4728_ramp_t *ramp, size_t channel, uint16_t *value, bool *active)
+{
+    CHECK_ARG(ramp_channel_ok(ramp, channel));
+
+    uint16_t set;
+    CHECK(mcp4728_bank_get(ramp->bank, channel, &set));
+
+    portENTER_CRITICAL(&ramp->lock);
+    bool ramping = ramp->active[channel / MCP4728_NUM_CH] & MCP4728_CH_BIT(channel % MCP4728_NUM_CH);
+    if (ramping)
+        set = ramp_value(&ramp->ch[channel]);
+    portEXIT_CRITICAL(&ramp->lock);
+
+    if (value)
+        *value = set;
+    if (active)
+        *active = ramping;
+
+    return ESP_OK;
+}
+
+esp_err_t mcp4728_ramp_get_stats(mcp4728_ramp_t *ramp, mcp4728_ramp_stats_t *stats, bool reset)
+{
+    CHECK_ARG(ramp);
+
+    portENTER_CRITICAL(&ramp->lock);
+    if (stats)
+        *stats = ramp->stats;
+    if (reset)
+        memset(&ramp->stats, 0, sizeof(mcp4728_ramp_stats_t));
+    portEXIT_CRITICAL(&ramp->lock);
+
+    return ESP_OK;
+}
@@ -0,0 +1,161 @@
+/**
+ * @file mcp4728_ramp.h
+ * @defgroup mcp4728_ramp mcp4728_ramp
+ * @{
+ *
+ * Slew-rate-limited ramps for the channels of an MCP4728 bank
+ *
+ * Every channel can ramp from its current value to a target, over a
+ * duration or at a slew rate. One ramp task advances all active ramps
+ * once per period in 16.16 fixed point and hands the changed values to
+ * the bank in one commit, see ::mcp4728_bank_commit(): one transaction
+ * per tick with all DACs on one port. A new target replaces the old one
+ * mid-flight and the ramp continues from where it is. Once every channel
+ * has reached its target the task sleeps until the next ramp starts.
+ *
+ * BSD Licensed as described in the file LICENSE
+ */
+#ifndef __MCP4728_RAMP_H__
+#define __MCP4728_RAMP_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <esp_err.h>
+#include "mcp4728_bank.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Ramp engine counters, see ::mcp4728_ramp_get_stats()
+ */
+typedef struct
+{
+    uint32_t ramps;      //!< Ramps started
+    uint32_t retargeted; //!< Of them, started on a channel still ramping
+    uint32_t finished;   //!< Ramps that reached their target
+    uint32_t ticks;      //!< Periods with active ramps
+    uint32_t errors;     //!< Failed commits, retried next tick
+} mcp4728_ramp_stats_t;
+
+/**
+ * Ramp of one channel
+ */
+typedef struct
+{
+    int32_t pos;     // Value reached, 16.16 fixed point
+    int32_t step;    // Change per tick, 16.16 fixed point
+    uint16_t target;
+} mcp4728_ramp_ch_t;
+
+/**
+ * Ramp engine, see ::mcp4728_ramp_init()
+ */
+typedef struct
+{
+    mcp4728_bank_t *bank;
+    TickType_t period;
+    uint32_t period_ms;
+    TaskHandle_t task;
+    TaskHandle_t stopper;
+    volatile bool stopping;
+    portMUX_TYPE lock;
+    bool running;                                      // Ramp task ticking
+    uint8_t active[NUM_MCP4728];                       // Ramping channels per device
+    mcp4728_ramp_ch_t ch[NUM_MCP4728 * MCP4728_NUM_CH];
+    mcp4728_ramp_stats_t stats;
+} mcp4728_ramp_t;
+
+/**
+ * @brief Init ramp engine and start its task
+ *
+ * @param ramp Ramp engine
+ * @param bank Initialized bank, see ::mcp4728_bank_init()
+ * @param period_ms Tick period, milliseconds, rounded to RTOS ticks
+ * @return `ESP_OK` on success
+ */
+esp_err_t mcp4728_ramp_init(mcp4728_ramp_t *ramp, mcp4728_bank_t *bank, uint32_t period_ms);
+
+/**
+ * @brief Stop the ramp task and free ramp engine
+ *
+ * Channels still ramping hold the value they reached.
+ *
+ * @param ramp Ramp engine
+ * @return `ESP_OK` on success
+ */
+esp_err_t mcp4728_ramp_free(mcp4728_ramp_t *ramp);
+
+/**
+ * @brief Ramp a channel to a target over a duration
+ *
+ * Starts from the value the channel reached if it is ramping, from its
+ * last set value otherwise, see ::mcp4728_bank_get(). The target is
+ * written on the tick that ends the duration, rounded up to periods, or
+ * on the next tick for 0.
+ *
+ * @param ramp Ramp engine
+ * @param channel Channel of the bank, see ::mcp4728_bank_set()
+ * @param target Raw target value, 0..4095
+ * @param duration_ms Ramp duration, milliseconds
+ * @return `ESP_OK` on success
+ */
+esp_err_t mcp4728_ramp_to(mcp4728_ramp_t *ramp, size_t channel, uint16_t target, uint32_t duration_ms);
+
+/**
+ * @brief Ramp a channel to a target at a slew rate
+ *
+ * Same as ::mcp4728_ramp_to() with the duration given by the distance to
+ * the target.
+ *
+ * @param ramp Ramp engine
+ * @param channel Channel of the bank, see ::mcp4728_bank_set()
+ * @param target Raw target value, 0..4095
+ * @param rate Slew rate, raw steps per second, > 0
+ * @return `ESP_OK` on success
+ */
+esp_err_t mcp4728_ramp_slew(mcp4728_ramp_t *ramp, size_t channel, uint16_t target, uint32_t rate);
+
+/**
+ * @brief Stop the ramp of a channel
+ *
+ * The channel holds the value it reached.
+ *
+ * @param ramp Ramp engine
+ * @param channel Channel of the bank, see ::mcp4728_bank_set()
+ * @return `ESP_OK` on success
+ */
+esp_err_t mcp4728_ramp_stop(mcp4728_ramp_t *ramp, size_t channel);
+
+/**
+ * @brief Get value and state of a channel
+ *
+ * @param ramp Ramp engine
+ * @param channel Channel of the bank, see ::mcp4728_bank_set()
+ * @param[out] value Value the ramp reached, or last set value if the
+ *                   channel is not ramping, if non-null
+ * @param[out] active True while the channel is ramping, if non-null
+ * @return `ESP_OK` on success
+ */
+esp_err_t mcp4728_ramp_get(mcp4728_ramp_t *ramp, size_t channel, uint16_t *value, bool *active);
+
+/**
+ * @brief Get ramp engine counters
+ *
+ * @param ramp Ramp engine
+ * @param[out] stats Counters if non-null
+ * @param reset Reset counters after reading if true
+ * @return `ESP_OK` on success
+ */
+esp_err_t mcp4728_ramp_get_stats(mcp4728_ramp_t *ramp, mcp4728_ramp_stats_t *stats, bool reset);
+
+#ifdef __cplusplus
+}
+#endif
+
+/**@}*/
+
+#endif /* __MCP4728_RAMP_H__ */
@@ -0,0 +1,333 @@
+/**
+ * @file mcp4728_stream.c
+ *
+ * Timer-paced sample streaming to MCP4728 channels
+ *
+ * BSD Licensed as described in the file LICENSE
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <esp_log.h>
+#include "mcp4728_stream.h"
+
+static const char *TAG = "mcp4728_stream";
+
+// Shortest esp_timer period
+#define RATE_MAX_HZ 20000
+
+#define CHECK(x) do { esp_err_t __; if ((__ = x) != ESP_OK) return __; } while (0)
+#define CHECK_ARG(VAL) do { if (!(VAL)) return ESP_ERR_INVALID_ARG; } while (0)
+
+static inline bool streamed(const mcp4728_stream_t *stream, uint8_t ch)
+{
+    return ch < MCP4728_NUM_CH && (stream->cfg.channels & MCP4728_CH_BIT(ch));
+}
+
+/**
+ * Next sample of a channel, false if both blocks are empty
+ */
+static bool ring_pop(mcp4728_stream_t *stream, mcp4728_stream_ring_t *r)
+{
+    portENTER_CRITICAL(&stream->lock);
+    size_t len = r->len[r->drain];
+    portEXIT_CRITICAL(&stream->lock);
+    if (r->drain_pos >= len)
+        return false;
+
+    r->last = r->block[r->drain][r->drain_pos++];
+    if (r->drain_pos == len)
+    {
+        portENTER_CRITICAL(&stream->lock);
+        r->len[r->drain] = 0;
+        portEXIT_CRITICAL(&stream->lock);
+        r->drain ^= 1;
+        r->drain_pos = 0;
+        xSemaphoreGive(r->space);
+    }
+
+    return true;
+}
+
+/**
+ * Write the sample of the last of \p wakes periods, the ones before are dropped
+ */
+static void stream_tick(mcp4728_stream_t *stream, uint32_t wakes)
+{
+    uint16_t values[MCP4728_NUM_CH] = { 0 };
+    bool fresh = false, underrun = false;
+
+    for (uint8_t ch = 0; ch < MCP4728_NUM_CH; ch++)
+    {
+        if (!streamed(stream, ch))
+            continue;
+        mcp4728_stream_ring_t *r = &stream->ring[ch];
+        bool popped = false;
+        for (uint32_t i = 0; i < wakes; i++)
+            if ((popped = ring_pop(stream, r)))
+                fresh = true;
+        if (!popped)
+            underrun = true;
+        values[ch] = r->last;
+    }
+
+    // Nothing new on any channel, outputs already show the held values
+    esp_err_t res = fresh ? mcp4728_multi_write(stream->dev, stream->cfg.channels, values) : ESP_OK;
+
+    portENTER_CRITICAL(&stream->lock);
+    if (underrun)
+        stream->stats.underruns++;
+    if (res != ESP_OK)
+        stream->stats.errors++;
+    else if (fresh)
+        stream->stats.samples++;
+    portEXIT_CRITICAL(&stream->lock);
+}
+
+static void stream_task(void *arg)
+{
+    mcp4728_stream_t *stream = arg;
+
+    while (!stream->stopping)
+    {
+        uint32_t wakes = ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        if (stream->stopping)
+            break;
+        if (wakes > 1)
+        {
+            portENTER_CRITICAL(&stream->lock);
+            stream->stats.missed += wakes - 1;
+            portEXIT_CRITICAL(&stream->lock);
+        }
+        stream_tick(stream, wakes);
+    }
+
+    xSemaphoreGive(stream->stopped);
+    vTaskDelete(NULL);
+}
+
+static void timer_cb(void *arg)
+{
+    mcp4728_stream_t *stream = arg;
+
+    // A stopping task is not notified, stop waits for a notify in flight
+    portENTER_CRITICAL(&stream->lock);
+    TaskHandle_t task = stream->stopping ? NULL : stream->task;
+    stream->notifying = task != NULL;
+    portEXIT_CRITICAL(&stream->lock);
+
+    if (task)
+    {
+        xTaskNotifyGive(task);
+        stream->notifying = false;
+    }
+}
+
+/**
+ * Hand the block being filled over to the stream task
+ */
+static void ring_push(mcp4728_stream_t *stream, mcp4728_stream_ring_t *r)
+{
+    portENTER_CRITICAL(&stream->lock);
+    r->len[r->fill] = r->fill_pos;
+    portEXIT_CRITICAL(&stream->lock);
+    r->fill ^= 1;
+    r->fill_pos = 0;
+}
+
+/**
+ * Wait until the block to fill is free, false on timeout
+ */
+static bool ring_wait(mcp4728_stream_t *stream, mcp4728_stream_ring_t *r, TimeOut_t *timeout, TickType_t *ticks)
+{
+    for (;;)
+    {
+        portENTER_CRITICAL(&stream->lock);
+        bool busy = r->len[r->fill] != 0;
+        portEXIT_CRITICAL(&stream->lock);
+        if (!busy)
+            return true;
+        if (xTaskCheckForTimeOut(timeout, ticks) == pdTRUE || xSemaphoreTake(r->space, *ticks) != pdTRUE)
+            break;
+    }
+
+    portENTER_CRITICAL(&stream->lock);
+    stream->stats.overruns++;
+    portEXIT_CRITICAL(&stream->lock);
+
+    return false;
+}
+
+esp_err_t mcp4728_stream_init(mcp4728_stream_t *stream, i2c_dev_t *dev, const mcp4728_stream_config_t *cfg)
+{
+    CHECK_ARG(stream && dev && cfg && cfg->block_len);
+    CHECK_ARG(cfg->rate_hz && cfg->rate_hz <= RATE_MAX_HZ);
+    CHECK_ARG(cfg->channels && !(cfg->channels & ~MCP4728_CH_ALL));
+
+    memset(stream, 0, sizeof(mcp4728_stream_t));
+    stream->dev = dev;
+    stream->cfg = *cfg;
+    stream->lock = (portMUX_TYPE)portMUX_INITIALIZER_UNLOCKED;
+
+    size_t count = 0;
+    for (uint8_t ch = 0; ch < MCP4728_NUM_CH; ch++)
+        count += streamed(stream, ch) ? 2 : 0;
+    stream->mem = calloc(count * cfg->block_len, sizeof(uint16_t));
+    if (!stream->mem)
+        return ESP_ERR_NO_MEM;
+
+    uint16_t *p = stream->mem;
+    for (uint8_t ch = 0; ch < MCP4728_NUM_CH; ch++)
+    {
+        if (!streamed(stream, ch))
+            continue;
+        mcp4728_stream_ring_t *r = &stream->ring[ch];
+        r->block[0] = p;
+        r->block[1] = p + cfg->block_len;
+        p += cfg->block_len * 2;
+        r->space = xSemaphoreCreateBinaryStatic(&r->space_buf);
+    }
+    stream->stopped = xSemaphoreCreateBinaryStatic(&stream->stopped_buf);
+
+    const esp_timer_create_args_t timer_args = {
+        .callback = timer_cb,
+        .arg = stream,
+        .name = "mcp4728_stream",
+    };
+    esp_err_t res = esp_timer_create(&timer_args, &stream->timer);
+    if (res != ESP_OK)
+    {
+        free(stream->mem);
+        stream->mem = NULL;
+    }
+
+    return res;
+}
+
+esp_err_t mcp4728_stream_free(mcp4728_stream_t *stream)
+{
+    CHECK_ARG(stream && stream->mem);
+
+    CHECK(mcp4728_stream_stop(stream));
+    for (uint8_t ch = 0; ch < MCP4728_NUM_CH; ch++)
+        if (stream->ring[ch].space)
+            vSemaphoreDelete(stream->ring[ch].space);
+    vSemaphoreDelete(stream->stopped);
+    esp_timer_delete(stream->timer);
+    free(stream->mem);
+    memset(stream, 0, sizeof(mcp4728_stream_t));
+
+    return ESP_OK;
+}
+
+esp_err_t mcp4728_stream_start(mcp4728_stream_t *stream)
+{
+    CHECK_ARG(stream && stream->mem);
+    if (stream->task)
+        return ESP_ERR_INVALID_STATE;
+
+    stream->stopping = false;
+    if (xTaskCreate(stream_task, "mcp4728_stream", CONFIG_MCP4728_STREAM_TASK_STACK, stream,
+            CONFIG_MCP4728_STREAM_TASK_PRIORITY, &stream->task) != pdPASS)
+    {
+        stream->task = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+    stream->stats_start = esp_timer_get_time();
+
+    esp_err_t res = esp_timer_start_periodic(stream->timer, 1000000 / stream->cfg.rate_hz);
+    if (res != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Could not start timer: %d", res);
+        mcp4728_stream_stop(stream);
+    }
+
+    return res;
+}
+
+esp_err_t mcp4728_stream_stop(mcp4728_stream_t *stream)
+{
+    CHECK_ARG(stream);
+    if (!stream->task)
+        return ESP_OK;
+
+    // The stop does not wait for a callback already running
+    esp_timer_stop(stream->timer);
+    portENTER_CRITICAL(&stream->lock);
+    stream->stopping = true;
+    portEXIT_CRITICAL(&stream->lock);
+    while (stream->notifying)
+        vTaskDelay(1);
+
+    xTaskNotifyGive(stream->task);
+    xSemaphoreTake(stream->stopped, portMAX_DELAY);
+    stream->task = NULL;
+
+    return ESP_OK;
+}
+
+esp_err_t mcp4728_stream_write(mcp4728_stream_t *stream, uint8_t ch, const uint16_t *samples, size_t count,
+        size_t *written, TickType_t ticks)
+{
+    CHECK_ARG(stream && stream->mem && streamed(stream, ch) && (samples || !count));
+
+    mcp4728_stream_ring_t *r = &stream->ring[ch];
+    TimeOut_t timeout;
+    size_t done = 0;
+    esp_err_t res = ESP_OK;
+
+    vTaskSetTimeOutState(&timeout);
+    while (done < count)
+    {
+        if (!ring_wait(stream, r, &timeout, &ticks))
+        {
+            res = ESP_ERR_TIMEOUT;
+            break;
+        }
+        size_t n = stream->cfg.block_len - r->fill_pos;
+        if (n > count - done)
+            n = count - done;
+        memcpy(r->block[r->fill] + r->fill_pos, samples + done, n * sizeof(uint16_t));
+        r->fill_pos += n;
+        done += n;
+        if (r->fill_pos == stream->cfg.block_len)
+            ring_push(stream, r);
+    }
+    if (written)
+        *written = done;
+
+    return res;
+}
+
+esp_err_t mcp4728_stream_flush(mcp4728_stream_t *stream, uint8_t ch)
+{
+    CHECK_ARG(stream && stream->mem && streamed(stream, ch));
+
+    mcp4728_stream_ring_t *r = &stream->ring[ch];
+    // Partly filled block is free, it was checked before the first sample went in
+    if (r->fill_pos)
+        ring_push(stream, r);
+
+    return ESP_OK;
+}
+
+esp_err_t mcp4728_stream_get_stats(mcp4728_stream_t *stream, mcp4728_stream_stats_t *stats, bool reset)
+{
+    CHECK_ARG(stream);
+
+    int64_t now = esp_timer_get_time();
+    portENTER_CRITICAL(&stream->lock);
+    if (stats)
+    {
+        *stats = stream->stats;
+        int64_t us = now - stream->stats_start;
+        stats->achieved_hz = us > 0 ? (uint64_t)stream->stats.samples * 1000000 / us : 0;
+    }
+    if (reset)
+    {
+        memset(&stream->stats, 0, sizeof(mcp4728_stream_stats_t));
+        stream->stats_start = now;
+    }
+    portEXIT_CRITICAL(&stream->lock);
+
+    return ESP_OK;
+}
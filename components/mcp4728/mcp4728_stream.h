@@ -0,0 +1,181 @@
+/**
+ * @file mcp4728_stream.h
+ * @defgroup mcp4728_stream mcp4728_stream
+ * @{
+ *
+ * Timer-paced sample streaming to MCP4728 channels
+ *
+ * Every streamed channel has a ring of two sample blocks. Producers fill
+ * one block while the stream task drains the other; a block is handed
+ * over when it is full or flushed. A periodic esp_timer wakes the stream
+ * task at the sample rate and every wake writes the next sample of all
+ * streamed channels in one multi-write, see ::mcp4728_multi_write():
+ * outputs change at once, whatever the LDAC level.
+ *
+ * A channel whose blocks are both empty holds its last value and counts
+ * an underrun, a producer that finds both blocks full waits for the
+ * stream task and counts an overrun if it times out. Periods that pass
+ * while a sample is still being written are counted as missed and their
+ * samples dropped, so that outputs stay on time and the achieved rate
+ * shows what the bus allows.
+ *
+ * BSD Licensed as described in the file LICENSE
+ */
+#ifndef __MCP4728_STREAM_H__
+#define __MCP4728_STREAM_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/semphr.h>
+#include <esp_timer.h>
+#include "mcp4728.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Stream config
+ */
+typedef struct
+{
+    uint32_t rate_hz;   //!< Sample rate, up to 20 kHz
+    uint8_t channels;   //!< Mask of streamed channels, see ::MCP4728_CH_BIT()
+    size_t block_len;   //!< Samples per block, two blocks per channel
+} mcp4728_stream_config_t;
+
+/**
+ * Counters of a stream, see ::mcp4728_stream_get_stats()
+ */
+typedef struct
+{
+    uint32_t samples;     //!< Samples written, all streamed channels at once
+    uint32_t underruns;   //!< Samples where a channel had no data and held its value
+    uint32_t overruns;    //!< Producer writes that timed out on full blocks
+    uint32_t missed;      //!< Periods passed while a sample was being written, samples dropped
+    uint32_t errors;      //!< Failed bus writes
+    uint32_t achieved_hz; //!< Samples per second since start or the last reset
+} mcp4728_stream_stats_t;
+
+/**
+ * Sample blocks of one channel
+ */
+typedef struct
+{
+    uint16_t *block[2];
+    size_t len[2];               // Samples in a handed over block, 0 if free
+    uint8_t fill;                // Block the producer fills
+    size_t fill_pos;
+    uint8_t drain;               // Block the stream task drains
+    size_t drain_pos;
+    uint16_t last;
+    SemaphoreHandle_t space;     // Given when a block is drained
+    StaticSemaphore_t space_buf;
+} mcp4728_stream_ring_t;
+
+/**
+ * Stream, see ::mcp4728_stream_init()
+ */
+typedef struct
+{
+    i2c_dev_t *dev;
+    mcp4728_stream_config_t cfg;
+    mcp4728_stream_ring_t ring[MCP4728_NUM_CH];
+    uint16_t *mem;
+    portMUX_TYPE lock;           // Guards block lengths and counters
+    esp_timer_handle_t timer;
+    TaskHandle_t task;
+    SemaphoreHandle_t stopped;   // Given by the stream task on exit
+    StaticSemaphore_t stopped_buf;
+    volatile bool stopping;
+    volatile bool notifying;     // Timer callback about to notify the task
+    mcp4728_stream_stats_t stats;
+    int64_t stats_start;
+} mcp4728_stream_t;
+
+/**
+ * @brief Init stream and allocate its blocks
+ *
+ * @param stream Stream
+ * @param dev MCP4728 device descriptor
+ * @param cfg Stream config
+ * @return `ESP_OK` on success
+ */
+esp_err_t mcp4728_stream_init(mcp4728_stream_t *stream, i2c_dev_t *dev, const mcp4728_stream_config_t *cfg);
+
+/**
+ * @brief Stop stream if running and free its blocks
+ *
+ * @param stream Stream
+ * @return `ESP_OK` on success
+ */
+esp_err_t mcp4728_stream_free(mcp4728_stream_t *stream);
+
+/**
+ * @brief Start stream task and timer
+ *
+ * Prefill the blocks before, so that the first samples do not underrun.
+ *
+ * @param stream Stream
+ * @return `ESP_OK` on success
+ */
+esp_err_t mcp4728_stream_start(mcp4728_stream_t *stream);
+
+/**
+ * @brief Stop stream
+ *
+ * When the function returns no sample is being written. Outputs keep the
+ * last written values, queued samples are kept.
+ *
+ * @param stream Stream
+ * @return `ESP_OK` on success
+ */
+esp_err_t mcp4728_stream_stop(mcp4728_stream_t *stream);
+
+/**
+ * @brief Queue samples of a channel
+ *
+ * Samples are copied into the block being filled, which is handed over to
+ * the stream task when full. One producer per channel.
+ *
+ * @param stream Stream
+ * @param ch Streamed channel
+ * @param samples Raw values, 0..4095
+ * @param count Number of samples
+ * @param[out] written Number of samples queued if non-null
+ * @param ticks Time to wait for a free block
+ * @return `ESP_OK` if all samples were queued, `ESP_ERR_TIMEOUT` on overrun
+ */
+esp_err_t mcp4728_stream_write(mcp4728_stream_t *stream, uint8_t ch, const uint16_t *samples, size_t count,
+        size_t *written, TickType_t ticks);
+
+/**
+ * @brief Hand over a partly filled block of a channel
+ *
+ * Never waits: a block being filled is free.
+ *
+ * @param stream Stream
+ * @param ch Streamed channel
+ * @return `ESP_OK` on success
+ */
+esp_err_t mcp4728_stream_flush(mcp4728_stream_t *stream, uint8_t ch);
+
+/**
+ * @brief Get counters of a stream
+ *
+ * @param stream Stream
+ * @param[out] stats Snapshot of counters if non-null
+ * @param reset Reset counters after the snapshot if true
+ * @return `ESP_OK` on success
+ */
+esp_err_t mcp4728_stream_get_stats(mcp4728_stream_t *stream, mcp4728_stream_stats_t *stats, bool reset);
+
+#ifdef __cplusplus
+}
+#endif
+
+/**@}*/
+
+#endif /* __MCP4728_STREAM_H__ */
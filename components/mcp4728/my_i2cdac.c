@@ -22,46 +22,40 @@
     
 
 #define ADDR MCP4728A0_I2C_ADDR0
-static i2c_dev_t dev;
+static mcp4728_bank_t bank;
+static mcp4728_mailbox_t mailbox;
+static mcp4728_ramp_t ramp;
 
 #ifdef CONFIG_MCP4728_TEST
 static TaskHandle_t dac_task;
 static void dac_test_task(void *pvParameters);
 #endif /* CONFIG_MCP4728_TEST */
 
-static void wait_for_eeprom(i2c_dev_t *dev)
-{
-    bool busy;
-    while (true)
-    {
-        ESP_ERROR_CHECK(mcp4728_eeprom_busy(dev, &busy));
-        if (!busy)
-            return;
-        printf("...DAC is busy, waiting...\n");
-        vTaskDelay(1);
-    }
+void init_mcp4728(int sda, int scl){
+    const mcp4728_bank_dac_t dac = { .port = 0, .addr = ADDR, .sda_gpio = sda, .scl_gpio = scl };
+
+    init_mcp4728_array(&dac, 1);
 }
 
-void init_mcp4728(int sda, int scl){
-    memset(&dev, 0, sizeof(i2c_dev_t));
-    
-    // Init device descriptor
-    ESP_ERROR_CHECK(mcp4728_init_desc(&dev, 0, ADDR, sda, scl));
+void init_mcp4728_array(const mcp4728_bank_dac_t *dacs, size_t count){
+    // Init device descriptors, input registers read back
+    ESP_ERROR_CHECK(mcp4728_bank_init(&bank, dacs, count));
+    ESP_ERROR_CHECK(mcp4728_mailbox_init(&mailbox, &bank, CONFIG_MCP4728_MAILBOX_PERIOD_MS));
+    ESP_ERROR_CHECK(mcp4728_ramp_init(&ramp, &bank, CONFIG_MCP4728_RAMP_PERIOD_MS));
 
-    mcp4728_power_mode_t pm;
-    ESP_ERROR_CHECK(mcp4728_get_power_mode(&dev, true, &pm));
-    if (pm != MCP4728_PM_NORMAL)
+    for (size_t i = 0; i < bank.count; i++)
     {
-        printf("DAC was sleeping... Wake up Neo!\n");
-        ESP_ERROR_CHECK(mcp4728_set_power_mode(&dev, true, MCP4728_PM_NORMAL));
-        wait_for_eeprom(&dev);
+        mcp4728_power_mode_t pm;
+        ESP_ERROR_CHECK(mcp4728_get_power_mode(&bank.dev[i], true, &pm));
+        if (pm != MCP4728_PM_NORMAL)
+        {
+            printf("DAC %u was sleeping... Wake up Neo!\n", (unsigned)i);
+            ESP_ERROR_CHECK(mcp4728_set_power_mode(&bank.dev[i], true, MCP4728_PM_NORMAL));
+        }
     }
     #ifdef CONFIG_MCP4728_TEST
         xTaskCreate(dac_test_task, "dac_task", configMINIMAL_STACK_SIZE * 3, NULL, 4, dac_task);
     #endif /* CONFIG_MCP4728_TEST */
-
-    
-    
 }
 #ifdef CONFIG_MCP4728_TEST
 
@@ -69,8 +63,7 @@ static void dac_test_task(void *pvParameters)
 {
     (void)pvParameters;
     printf("Set default DAC output value to MAX...\n");
-    ESP_ERROR_CHECK(mcp4728_set_raw_output(&dev, MCP4728_MAX_VALUE, false));
-    wait_for_eeprom(&dev);
+    dac_write_channel(0, MCP4728_MAX_VALUE);
 
     printf("Now let's generate the sawtooth wave in slow manner\n");
     uint16_t i = MCP4728_MAX_VALUE;
@@ -95,5 +88,42 @@ static void dac_test_task(void *pvParameters)
 #endif /* CONFIG_MCP4728_TEST */
 
 void dac_write_channel(uint8_t ch,uint16_t value){
-    ESP_ERROR_CHECK(mcp4728_write_channel_raw(&dev,ch, value));
-}
\ No newline at end of file
+    uint16_t values[MCP4728_NUM_CH] = { 0 };
+    values[ch % MCP4728_NUM_CH] = value;
+
+    ESP_ERROR_CHECK(mcp4728_bank_write(&bank, ch / MCP4728_NUM_CH, MCP4728_CH_BIT(ch % MCP4728_NUM_CH), values));
+}
+
+void dac_write_channels(uint8_t channels, const uint16_t *values){
+    ESP_ERROR_CHECK(mcp4728_bank_write(&bank, 0, channels, values));
+}
+
+void dac_stage_channel(uint8_t ch, uint16_t value){
+    ESP_ERROR_CHECK(mcp4728_bank_set(&bank, ch, value));
+}
+
+void dac_commit(void){
+    ESP_ERROR_CHECK(mcp4728_bank_commit(&bank));
+}
+
+void dac_post_channel(uint8_t ch, uint16_t value){
+    ESP_ERROR_CHECK(mcp4728_mailbox_post(&mailbox, ch, value));
+}
+
+void dac_get_post_stats(mcp4728_mailbox_stats_t *stats, bool reset){
+    ESP_ERROR_CHECK(mcp4728_mailbox_get_stats(&mailbox, stats, reset));
+}
+
+void dac_ramp_channel(uint8_t ch, uint16_t value, uint32_t duration_ms){
+    ESP_ERROR_CHECK(mcp4728_ramp_to(&ramp, ch, value, duration_ms));
+}
+
+void dac_slew_channel(uint8_t ch, uint16_t value, uint32_t rate){
+    ESP_ERROR_CHECK(mcp4728_ramp_slew(&ramp, ch, value, rate));
+}
+
+bool dac_ramping(uint8_t ch){
+    bool active;
+    ESP_ERROR_CHECK(mcp4728_ramp_get(&ramp, ch, NULL, &active));
+    return active;
+}
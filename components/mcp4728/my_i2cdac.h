@@ -1,4 +1,25 @@
 #pragma once
 #include "mcp4728.h"
+#include "mcp4728_bank.h"
+#include "mcp4728_mailbox.h"
+#include "mcp4728_ramp.h"
 void init_mcp4728(int sda, int scl);
-void dac_write_channel(uint8_t ch,uint16_t value);
\ No newline at end of file
+/* DACs across ports, channel n is channel n % 4 of DAC n / 4. LDAC held
+ * high: fast writes and mcp4728_set_raw_output() without EEPROM only load
+ * the input registers, use the dac_ functions below. */
+void init_mcp4728_array(const mcp4728_bank_dac_t *dacs, size_t count);
+void dac_write_channel(uint8_t ch,uint16_t value);
+void dac_write_channels(uint8_t channels, const uint16_t *values);
+/* Staged until dac_commit(), which latches all staged channels at once */
+void dac_stage_channel(uint8_t ch, uint16_t value);
+void dac_commit(void);
+/* Never blocks, only the newest value per channel is written, at most
+ * once per CONFIG_MCP4728_MAILBOX_PERIOD_MS, in one commit */
+void dac_post_channel(uint8_t ch, uint16_t value);
+void dac_get_post_stats(mcp4728_mailbox_stats_t *stats, bool reset);
+/* Ramp from the current value, retargets a ramp in flight. Channels are
+ * advanced together every CONFIG_MCP4728_RAMP_PERIOD_MS while any ramps */
+void dac_ramp_channel(uint8_t ch, uint16_t value, uint32_t duration_ms);
+/* Same, rate in raw steps per second */
+void dac_slew_channel(uint8_t ch, uint16_t value, uint32_t rate);
+bool dac_ramping(uint8_t ch);
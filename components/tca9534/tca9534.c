@@ -10,7 +10,12 @@
  * BSD Licensed as described in the file LICENSE
  */
 
+#include <stdlib.h>
 #include <esp_idf_lib_helpers.h>
+#include <i2c_regmap.h>
+#if CONFIG_I2CDEV_SCL_CALIBRATION
+#include <i2c_scl.h>
+#endif
 #include "tca9534.h"
 #include <esp_log.h>
 #define I2C_FREQ_HZ 400000
@@ -25,12 +30,19 @@
 #define BV(x) (1 << (x))
 static const char *TAG = "tca9534";
 
+// Input port is volatile, output, polarity and config are cached
+static const i2c_regmap_config_t regmap_cfg = {
+    .base = REG_IN0,
+    .count = REG_CONF0 - REG_IN0 + 1,
+    .volatile_mask = BV(REG_IN0),
+    .readonly_mask = BV(REG_IN0),
+    .auto_increment = false,
+};
+
 static esp_err_t read_reg_8(i2c_dev_t *dev, uint8_t reg, uint8_t *val)
 {
-    CHECK_ARG(dev && val);
-    I2C_DEV_TAKE_MUTEX(dev);
-    I2C_DEV_CHECK(dev, i2c_dev_read_reg(dev, reg, val, 1));
-    I2C_DEV_GIVE_MUTEX(dev);
+    CHECK_ARG(dev && dev->regmap && val);
+    CHECK(i2c_regmap_read(dev->regmap, reg, val));
     ESP_LOGI(TAG,"Reading reg: 0x%x val:0x%x",reg,*val);
     
     return ESP_OK;
@@ -38,14 +50,11 @@ static esp_err_t read_reg_8(i2c_dev_t *dev, uint8_t reg, uint8_t *val)
 
 static esp_err_t write_reg_8(i2c_dev_t *dev, uint8_t reg, uint8_t val)
 {
-    CHECK_ARG(dev);
+    CHECK_ARG(dev && dev->regmap);
 
-    I2C_DEV_TAKE_MUTEX(dev);
     ESP_LOGI(TAG,"Writing reg: 0x%x val:0x%x",reg,val);
-    I2C_DEV_CHECK(dev, i2c_dev_write_reg(dev, reg, &val, 1));
-    I2C_DEV_GIVE_MUTEX(dev);
 
-    return ESP_OK;
+    return i2c_regmap_update_sync(dev->regmap, reg, 0xff, val);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -54,24 +63,98 @@ esp_err_t tca9534_init_desc(i2c_dev_t *dev, i2c_port_t port, uint8_t addr, gpio_
 {
     CHECK_ARG(dev && (addr & TCA9534_I2C_ADDR_BASE));
 
-    dev->port = port;
-    dev->addr = addr;
-    dev->cfg.sda_io_num = sda_gpio;
-    dev->cfg.scl_io_num = scl_gpio;
+    i2c_config_t cfg = {
+        .sda_io_num = sda_gpio,
+        .scl_io_num = scl_gpio,
+    };
 #if HELPER_TARGET_IS_ESP32
-    dev->cfg.master.clk_speed = I2C_FREQ_HZ;
+    cfg.master.clk_speed = I2C_FREQ_HZ;
 #endif
 
-    return i2c_dev_create_mutex(dev);
+    dev->addr = addr;
+    CHECK(i2c_dev_attach(dev, port, &cfg, 0));
+
+    i2c_regmap_t *map = calloc(1, sizeof(i2c_regmap_t));
+    esp_err_t res = map ? i2c_regmap_init(map, dev, &regmap_cfg) : ESP_ERR_NO_MEM;
+    if (res == ESP_OK)
+        res = i2c_dev_create_mutex(dev);
+    if (res != ESP_OK)
+    {
+        free(map);
+        dev->regmap = NULL;
+        i2c_dev_detach(dev);
+        return res;
+    }
+
+#if CONFIG_I2CDEV_SCL_CALIBRATION
+    // Measured frequency if the device was calibrated
+    i2c_scl_load(dev);
+#endif
+
+    return ESP_OK;
 }
 
 esp_err_t tca9534_free_desc(i2c_dev_t *dev)
 {
     CHECK_ARG(dev);
 
+    CHECK(i2c_dev_detach(dev));
+    free(dev->regmap);
+    dev->regmap = NULL;
+
     return i2c_dev_delete_mutex(dev);
 }
 
+#if CONFIG_I2CDEV_SCL_CALIBRATION
+
+// Patterns go around the register cache, which keeps the value to restore
+static esp_err_t scl_check(i2c_dev_t *dev, void *arg)
+{
+    static const uint8_t patterns[] = { 0xa5, 0x5a };
+    esp_err_t res = ESP_OK;
+
+    I2C_DEV_TAKE_MUTEX(dev);
+    for (size_t i = 0; i < sizeof(patterns) && res == ESP_OK; i++)
+    {
+        uint8_t v;
+        res = i2c_dev_write_reg(dev, REG_POL0, &patterns[i], 1);
+        if (res == ESP_OK)
+            res = i2c_dev_read_reg(dev, REG_POL0, &v, 1);
+        if (res == ESP_OK && v != patterns[i])
+            res = ESP_ERR_INVALID_RESPONSE;
+    }
+    I2C_DEV_GIVE_MUTEX(dev);
+
+    return res;
+}
+
+esp_err_t tca9534_calibrate_scl(i2c_dev_t *dev, uint32_t max_hz, uint32_t *hz)
+{
+    CHECK_ARG(dev && dev->regmap);
+
+    uint8_t pol;
+    CHECK(i2c_regmap_read(dev->regmap, REG_POL0, &pol));
+
+    i2c_scl_config_t cfg = I2C_SCL_CONFIG_DEFAULT(scl_check);
+    cfg.max_hz = max_hz;
+    esp_err_t res = i2c_scl_calibrate(dev, &cfg, hz);
+
+    I2C_DEV_TAKE_MUTEX(dev);
+    I2C_DEV_CHECK(dev, i2c_dev_write_reg(dev, REG_POL0, &pol, 1));
+    I2C_DEV_GIVE_MUTEX(dev);
+
+    return res;
+}
+
+#else
+
+esp_err_t tca9534_calibrate_scl(i2c_dev_t *dev, uint32_t max_hz, uint32_t *hz)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+#endif /* CONFIG_I2CDEV_SCL_CALIBRATION */
+
 esp_err_t tca9534_port_get_mode(i2c_dev_t *dev, uint8_t *mode)
 {
     return read_reg_8(dev, REG_CONF0, mode);
@@ -113,14 +196,8 @@ esp_err_t tca9534_get_level(i2c_dev_t *dev, uint8_t pin, uint8_t *val)
 
 esp_err_t tca9534_set_level(i2c_dev_t *dev, uint8_t pin, uint8_t val)
 {
-    uint8_t v;
+    CHECK_ARG(dev && dev->regmap);
 
-    I2C_DEV_TAKE_MUTEX(dev);
-    I2C_DEV_CHECK(dev, i2c_dev_read_reg(dev, REG_OUT0, &v, 1));
-    v = (v & ~BV(pin)) | (val ? BV(pin) : 0);
-    I2C_DEV_CHECK(dev, i2c_dev_write_reg(dev, REG_OUT0, &v, 1));
-    I2C_DEV_GIVE_MUTEX(dev);
-
-    return ESP_OK;
+    // Output register is cached, read-modify-write costs one bus write
+    return i2c_regmap_update_sync(dev->regmap, REG_OUT0, BV(pin), val ? BV(pin) : 0);
 }
-
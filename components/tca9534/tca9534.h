@@ -23,7 +23,9 @@ extern "C" {
 /**
  * @brief Initialize device descriptor
  *
- * Default SCL frequency is 400kHz
+ * Default SCL frequency is 400kHz. Allocates the register cache of the
+ * device, free an initialized descriptor with ::tca9534_free_desc()
+ * before initializing it again.
  *
  * @param dev Pointer to I2C device descriptor
  * @param port I2C port number
@@ -41,6 +43,21 @@ esp_err_t tca9534_init_desc(i2c_dev_t *dev, i2c_port_t port, uint8_t addr, gpio_
  */
 esp_err_t tca9534_free_desc(i2c_dev_t *dev);
 
+/**
+ * @brief Calibrate SCL frequency and store it in NVS
+ *
+ * Steps the frequency up to \p max_hz, writing test patterns to the
+ * polarity register and reading them back at every step, see
+ * ::i2c_scl_calibrate(). The polarity register is restored at the
+ * calibrated frequency. Needs `CONFIG_I2CDEV_SCL_CALIBRATION`.
+ *
+ * @param dev Pointer to I2C device descriptor
+ * @param max_hz Highest frequency to try
+ * @param[out] hz Calibrated frequency if non-null
+ * @return `ESP_OK` on success
+ */
+esp_err_t tca9534_calibrate_scl(i2c_dev_t *dev, uint32_t max_hz, uint32_t *hz);
+
 /**
  * @brief Get GPIO pins mode
  *
@@ -0,0 +1,143 @@
+/**
+ * @file bank_bench.c
+ *
+ * Updates of an MCP4728 bank across two simulated I2C ports
+ *
+ * Eight DACs, four per port, 32 channels get new values every round:
+ * channel by channel, device by device with multi-writes, and with bank
+ * commits that stage all channels and latch them with general call
+ * updates, over both ports and over the DACs of one port. Reports bus
+ * transactions and bus time per round, and the skew: time between the
+ * first and the last output of the round to change, from the model's
+ * output load times.
+ *
+ * Usage: i2c_bank_bench [rounds]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <esp_log.h>
+#include <i2cdev.h>
+#include <i2c_sim.h>
+#include <sim_mcp4728.h>
+#include <mcp4728.h>
+#include <mcp4728_bank.h>
+
+#define PORTS 2
+#define PER_PORT 4
+#define DACS (PORTS * PER_PORT)
+#define CHANNELS (DACS * MCP4728_NUM_CH)
+#define SDA 21
+#define SCL 22
+
+static sim_mcp4728_t sim_dacs[DACS];
+static mcp4728_bank_dac_t cfg[DACS];
+static mcp4728_bank_t bank;
+static uint16_t values[CHANNELS];
+
+typedef struct
+{
+    const char *name;
+    size_t dacs;
+    bool ldac;
+    void (*run)(size_t dacs);
+} method_t;
+
+static void run_channels(size_t dacs)
+{
+    for (size_t i = 0; i < dacs * MCP4728_NUM_CH; i++)
+        ESP_ERROR_CHECK(mcp4728_write_channel_raw(&bank.dev[i / MCP4728_NUM_CH], i % MCP4728_NUM_CH, values[i]));
+}
+
+static void run_devices(size_t dacs)
+{
+    for (size_t d = 0; d < dacs; d++)
+        ESP_ERROR_CHECK(mcp4728_multi_write(&bank.dev[d], MCP4728_CH_ALL, &values[d * MCP4728_NUM_CH]));
+}
+
+static void run_commit(size_t dacs)
+{
+    ESP_ERROR_CHECK(mcp4728_bank_set_many(&bank, 0, values, dacs * MCP4728_NUM_CH));
+    ESP_ERROR_CHECK(mcp4728_bank_commit(&bank));
+}
+
+static void measure(const method_t *m, uint32_t rounds)
+{
+    ESP_ERROR_CHECK(mcp4728_bank_init(&bank, cfg, m->dacs));
+    for (size_t d = 0; d < DACS; d++)
+        sim_mcp4728_set_ldac(&sim_dacs[d], m->ldac);
+
+    i2c_sim_stats_t st;
+    for (int p = 0; p < PORTS; p++)
+        i2c_sim_get_stats(p, &st, true);
+
+    int64_t skew = 0, skew_max = 0;
+    uint32_t wrong = 0;
+    for (uint32_t r = 0; r < rounds; r++)
+    {
+        for (size_t i = 0; i < m->dacs * MCP4728_NUM_CH; i++)
+            values[i] = (r * 37 + i * 101) & 0x0fff;
+        m->run(m->dacs);
+
+        int64_t first = INT64_MAX, last = 0;
+        for (size_t i = 0; i < m->dacs * MCP4728_NUM_CH; i++)
+        {
+            const sim_mcp4728_t *dac = &sim_dacs[i / MCP4728_NUM_CH];
+            int64_t t = dac->latched_at[i % MCP4728_NUM_CH];
+            first = t < first ? t : first;
+            last = t > last ? t : last;
+            wrong += dac->output[i % MCP4728_NUM_CH].value != values[i];
+        }
+        skew += last - first;
+        skew_max = last - first > skew_max ? last - first : skew_max;
+    }
+
+    uint32_t xfers = 0;
+    uint64_t bus_us = 0;
+    for (int p = 0; p < PORTS; p++)
+    {
+        i2c_sim_get_stats(p, &st, false);
+        xfers += st.transactions;
+        bus_us += st.bus_time_us;
+    }
+    printf("%-26s %8.1f %10.1f %10.1f %10lld %8u\n", m->name, (double)xfers / rounds, (double)bus_us / rounds,
+           (double)skew / rounds, (long long)skew_max, (unsigned)wrong);
+
+    ESP_ERROR_CHECK(mcp4728_bank_free(&bank));
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t rounds = argc > 1 ? strtoul(argv[1], NULL, 0) : 1000;
+    if (!rounds)
+        rounds = 1;
+
+    esp_log_level_set("*", ESP_LOG_NONE);
+
+    // Port 0 DACs first, so a bank of PER_PORT devices is port 0 only
+    for (size_t d = 0; d < DACS; d++)
+    {
+        i2c_port_t port = d / PER_PORT;
+        uint8_t addr = MCP4728A0_I2C_ADDR0 + d % PER_PORT;
+        cfg[d] = (mcp4728_bank_dac_t){ .port = port, .addr = addr, .sda_gpio = SDA, .scl_gpio = SCL };
+        sim_mcp4728_init(&sim_dacs[d], addr);
+        ESP_ERROR_CHECK(i2c_sim_attach(port, &sim_dacs[d].model));
+    }
+    ESP_ERROR_CHECK(i2cdev_init());
+
+    static const method_t methods[] = {
+        { "32 x write_channel_raw", DACS, false, run_channels },
+        { "8 x multi_write", DACS, false, run_devices },
+        { "bank commit, 2 ports", DACS, true, run_commit },
+        { "bank commit, 1 port", PER_PORT, true, run_commit },
+    };
+
+    printf("%d DACs on %d ports, %u rounds, values per round: 32 channels, 16 for 1 port\n\n", DACS, PORTS,
+           (unsigned)rounds);
+    printf("%-26s %8s %10s %10s %10s %8s\n", "method", "xfers", "bus, us", "skew, us", "max, us", "wrong");
+    for (size_t i = 0; i < sizeof(methods) / sizeof(methods[0]); i++)
+        measure(&methods[i], rounds);
+
+    i2cdev_done();
+
+    return 0;
+}
@@ -0,0 +1,119 @@
+/**
+ * @file dds_bench.c
+ *
+ * MCP4728 DDS generator throughput on one host core
+ *
+ * Fills blocks of all four channels with every shape and reports samples
+ * per second of one thread, per channel and as 4-channel samples, next to
+ * the 4-channel sample rate the simulated bus allows with fast writes at
+ * the driver's 1 MHz. Also checks the range of a full scale sine.
+ *
+ * Usage: i2c_dds_bench [samples per channel]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <i2cdev.h>
+#include <i2c_sim.h>
+#include <sim_mcp4728.h>
+#include <mcp4728.h>
+#include <mcp4728_dds.h>
+
+#define PORT 0
+#define SDA 21
+#define SCL 22
+#define DAC_ADDR MCP4728A0_I2C_ADDR0
+#define RATE_HZ 10000
+#define BLOCK_LEN 256
+#define BUS_SAMPLES 1000
+
+static const char *shape_names[] = { "sine", "triangle", "square", "user (sawtooth)" };
+static uint16_t user_lut[MCP4728_DDS_LUT_SIZE];
+static volatile uint32_t sink; // Keeps the samples alive
+
+static double bus_rate(void)
+{
+    static sim_mcp4728_t sim_dac;
+    i2c_dev_t dac = { 0 };
+    i2c_sim_stats_t st;
+    uint16_t values[MCP4728_NUM_CH] = { 0 };
+
+    sim_mcp4728_init(&sim_dac, DAC_ADDR);
+    ESP_ERROR_CHECK(i2c_sim_attach(PORT, &sim_dac.model));
+    ESP_ERROR_CHECK(i2cdev_init());
+    ESP_ERROR_CHECK(mcp4728_init_desc(&dac, PORT, DAC_ADDR, SDA, SCL));
+
+    i2c_sim_get_stats(PORT, &st, true);
+    for (int i = 0; i < BUS_SAMPLES; i++)
+        ESP_ERROR_CHECK(mcp4728_fast_write_all(&dac, values));
+    i2c_sim_get_stats(PORT, &st, false);
+
+    mcp4728_free_desc(&dac);
+    i2cdev_done();
+
+    return 1e6 * BUS_SAMPLES / st.bus_time_us;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t samples = argc > 1 ? strtoul(argv[1], NULL, 0) : 10000000;
+    if (samples < BLOCK_LEN)
+        samples = BLOCK_LEN;
+
+    esp_log_level_set("*", ESP_LOG_NONE);
+
+    for (int i = 0; i < MCP4728_DDS_LUT_SIZE; i++)
+        user_lut[i] = i * 4095 / (MCP4728_DDS_LUT_SIZE - 1);
+
+    mcp4728_dds_t dds;
+    uint16_t buf[BLOCK_LEN];
+    ESP_ERROR_CHECK(mcp4728_dds_init(&dds, RATE_HZ));
+
+    printf("%u samples per channel, 4 channels, one thread\n\n", (unsigned)samples);
+    printf("%-16s %10s %16s %16s\n", "shape", "ns/sample", "Msamples/s", "4-ch Msamples/s");
+    for (int shape = MCP4728_DDS_SINE; shape <= MCP4728_DDS_USER; shape++)
+    {
+        for (uint8_t ch = 0; ch < MCP4728_NUM_CH; ch++)
+        {
+            mcp4728_dds_wave_t wave = {
+                .shape = shape,
+                .lut = user_lut,
+                .freq_mhz = (ch + 1) * 123457,
+                .amplitude = 2048,
+                .offset = MCP4728_DDS_MID,
+                .phase = ch << 30,
+            };
+            ESP_ERROR_CHECK(mcp4728_dds_set_wave(&dds, ch, &wave));
+        }
+
+        int64_t start = esp_timer_get_time();
+        for (uint32_t done = 0; done < samples; done += BLOCK_LEN)
+            for (uint8_t ch = 0; ch < MCP4728_NUM_CH; ch++)
+            {
+                mcp4728_dds_fill(&dds, ch, buf, BLOCK_LEN);
+                sink += buf[done % BLOCK_LEN];
+            }
+        int64_t us = esp_timer_get_time() - start;
+
+        double total = (double)(samples / BLOCK_LEN * BLOCK_LEN) * MCP4728_NUM_CH;
+        printf("%-16s %10.2f %16.1f %16.1f\n", shape_names[shape], us * 1000.0 / total, total / us,
+               total / MCP4728_NUM_CH / us);
+    }
+
+    // Full scale sine over one period
+    mcp4728_dds_wave_t sine = { .shape = MCP4728_DDS_SINE, .freq_mhz = RATE_HZ * 1000 / BLOCK_LEN,
+                                .amplitude = 2048, .offset = MCP4728_DDS_MID };
+    ESP_ERROR_CHECK(mcp4728_dds_set_wave(&dds, 0, &sine));
+    mcp4728_dds_fill(&dds, 0, buf, BLOCK_LEN);
+    uint16_t lo = 0xffff, hi = 0;
+    for (int i = 0; i < BLOCK_LEN; i++)
+    {
+        lo = buf[i] < lo ? buf[i] : lo;
+        hi = buf[i] > hi ? buf[i] : hi;
+    }
+    printf("\nFull scale sine: %u..%u, MCP4728_MAX_VALUE %u\n", lo, hi, MCP4728_MAX_VALUE);
+    printf("Bus limit with 4-channel fast writes: %.0f samples/s\n", bus_rate());
+
+    return 0;
+}
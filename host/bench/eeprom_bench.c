@@ -0,0 +1,122 @@
+/**
+ * @file eeprom_bench.c
+ *
+ * MCP4728 EEPROM commits on the simulated I2C bus
+ *
+ * The bus runs in realtime mode and the model keeps the device busy for
+ * its 50 ms EEPROM write cycle. Storing four channel values one by one,
+ * each followed by a wait, is compared with setting them and committing
+ * the difference once, and with commits of one changed channel and of
+ * nothing. Reports how long the caller was blocked, how long until the
+ * values were stored, EEPROM write cycles and bus transactions.
+ *
+ * Usage: i2c_eeprom_bench
+ */
+#include <stdio.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <i2cdev.h>
+#include <i2c_sim.h>
+#include <sim_mcp4728.h>
+#include <mcp4728.h>
+
+#define PORT 0
+#define SDA 21
+#define SCL 22
+#define DAC_ADDR MCP4728A0_I2C_ADDR0
+
+static sim_mcp4728_t sim_dac;
+static i2c_dev_t dac;
+static SemaphoreHandle_t committed;
+static int64_t committed_us;
+static esp_err_t committed_res;
+
+static void on_commit(i2c_dev_t *dev, esp_err_t result, void *arg)
+{
+    committed_us = esp_timer_get_time();
+    committed_res = result;
+    xSemaphoreGive(committed);
+}
+
+typedef struct
+{
+    int64_t start;
+    uint32_t cycles;
+    i2c_sim_stats_t bus;
+} mark_t;
+
+static void mark(mark_t *m)
+{
+    m->start = esp_timer_get_time();
+    m->cycles = sim_dac.eeprom_writes;
+    i2c_sim_get_stats(PORT, &m->bus, true);
+}
+
+static void report(const char *name, const mark_t *m, int64_t blocked_us, int64_t stored_us)
+{
+    i2c_sim_stats_t bus;
+    i2c_sim_get_stats(PORT, &bus, false);
+    printf("%-22s %12.2f %12.2f %8u %8u\n", name, blocked_us / 1000.0, stored_us / 1000.0,
+           (unsigned)(sim_dac.eeprom_writes - m->cycles), (unsigned)bus.transactions);
+}
+
+static void run_commit(const char *name)
+{
+    mark_t m;
+    mark(&m);
+    ESP_ERROR_CHECK(mcp4728_eeprom_commit(&dac, MCP4728_CH_ALL, on_commit, NULL));
+    int64_t blocked = esp_timer_get_time() - m.start;
+    xSemaphoreTake(committed, portMAX_DELAY);
+    ESP_ERROR_CHECK(committed_res);
+    report(name, &m, blocked, committed_us - m.start);
+}
+
+int main(int argc, char **argv)
+{
+    esp_log_level_set("*", ESP_LOG_NONE);
+
+    sim_mcp4728_init(&sim_dac, DAC_ADDR);
+    ESP_ERROR_CHECK(i2c_sim_attach(PORT, &sim_dac.model));
+    i2c_sim_timing_t timing = { .overhead_us = 20, .byte_bits = 9, .cond_bits = 1, .realtime = true };
+    i2c_sim_set_timing(&timing);
+
+    ESP_ERROR_CHECK(i2cdev_init());
+    ESP_ERROR_CHECK(mcp4728_init_desc(&dac, PORT, DAC_ADDR, SDA, SCL));
+    ESP_ERROR_CHECK(mcp4728_refresh(&dac));
+    committed = xSemaphoreCreateBinary();
+
+    printf("%d ms EEPROM write cycle, busy polled every %d ms\n\n", SIM_MCP4728_EEPROM_WRITE_US / 1000,
+           CONFIG_MCP4728_EEPROM_POLL_MS);
+    printf("%-22s %12s %12s %8s %8s\n", "case", "blocked, ms", "stored, ms", "cycles", "xfers");
+
+    // Old way: every value stored on its own, waiting for each write cycle
+    static const uint16_t values[MCP4728_NUM_CH] = { 0x100, 0x200, 0x300, 0x400 };
+    mark_t m;
+    mark(&m);
+    for (uint8_t i = 0; i < MCP4728_NUM_CH; i++)
+    {
+        ESP_ERROR_CHECK(mcp4728_set_raw_output(&dac, values[i], true));
+        ESP_ERROR_CHECK(mcp4728_eeprom_wait(&dac, portMAX_DELAY));
+    }
+    int64_t us = esp_timer_get_time() - m.start;
+    report("4 x set_raw_output", &m, us, us);
+
+    uint16_t next[MCP4728_NUM_CH] = { 0x500, 0x600, 0x700, 0x800 };
+    ESP_ERROR_CHECK(mcp4728_fast_write_all(&dac, next));
+    run_commit("commit, 4 changed");
+
+    ESP_ERROR_CHECK(mcp4728_write_channel_raw(&dac, MCP4728_CH_C, 0x0fff));
+    run_commit("commit, 1 changed");
+
+    run_commit("commit, none changed");
+
+    printf("\nMCP4728 EEPROM C 0x%03x, %u commands ignored while busy\n", sim_dac.eeprom[MCP4728_CH_C].value,
+           (unsigned)sim_dac.ignored);
+
+    mcp4728_free_desc(&dac);
+    i2cdev_done();
+
+    return 0;
+}
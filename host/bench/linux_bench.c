@@ -0,0 +1,156 @@
+/**
+ * @file linux_bench.c
+ *
+ * Register read throughput on a Linux i2c-dev adapter
+ *
+ * Compares a register read as one combined transaction (register write,
+ * repeated start, data read) with the same read issued as separate write
+ * and read syscalls, each ending with a stop, and with i2c_dev_read_reg()
+ * on the i2cdev Linux backend.
+ *
+ * Adapters without I2C_FUNC_I2C are measured with the SMBus equivalents:
+ * one I2C block read against a send byte followed by receive bytes.
+ * Testable without hardware with the i2c-stub module:
+ *
+ *   modprobe i2c-dev
+ *   modprobe i2c-stub chip_addr=0x38
+ *   i2c_linux_bench <adapter of "SMBus stub driver"> 0x38 0 1 100000
+ *
+ * Usage: i2c_linux_bench adapter addr [reg [size [iterations]]]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/i2c.h>
+#include <linux/i2c-dev.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <i2cdev.h>
+#include <i2cdev_linux.h>
+
+#define PORT 0
+
+static int fd = -1;
+static uint8_t addr;
+static uint8_t reg;
+static size_t size;
+static uint8_t buf[I2C_SMBUS_BLOCK_MAX];
+static i2c_dev_t dev;
+
+static int smbus(char rw, uint8_t cmd, int type, union i2c_smbus_data *data)
+{
+    struct i2c_smbus_ioctl_data args = { .read_write = rw, .command = cmd, .size = type, .data = data };
+    return ioctl(fd, I2C_SMBUS, &args);
+}
+
+/* Register read as one transaction, returns syscalls used or -1 */
+static int read_combined(bool i2c)
+{
+    if (i2c)
+    {
+        struct i2c_msg msgs[] = {
+            { .addr = addr, .flags = 0, .len = 1, .buf = &reg },
+            { .addr = addr, .flags = I2C_M_RD, .len = size, .buf = buf },
+        };
+        struct i2c_rdwr_ioctl_data data = { .msgs = msgs, .nmsgs = 2 };
+        return ioctl(fd, I2C_RDWR, &data) < 0 ? -1 : 1;
+    }
+    union i2c_smbus_data data = { .block = { size } };
+    return smbus(I2C_SMBUS_READ, reg, I2C_SMBUS_I2C_BLOCK_DATA, &data) < 0 ? -1 : 1;
+}
+
+/* Register read as register write and data read transactions */
+static int read_separate(bool i2c)
+{
+    if (i2c)
+    {
+        if (write(fd, &reg, 1) != 1 || read(fd, buf, size) != (ssize_t)size)
+            return -1;
+        return 2;
+    }
+    union i2c_smbus_data data;
+    if (smbus(I2C_SMBUS_WRITE, reg, I2C_SMBUS_BYTE, NULL) < 0)
+        return -1;
+    for (size_t i = 0; i < size; i++)
+        if (smbus(I2C_SMBUS_READ, 0, I2C_SMBUS_BYTE, &data) < 0)
+            return -1;
+    return 1 + size;
+}
+
+static int read_i2cdev(bool i2c)
+{
+    return i2c_dev_read_reg(&dev, reg, buf, size) == ESP_OK ? 1 : -1;
+}
+
+static void run(const char *name, int (*op)(bool), bool i2c, uint32_t iterations)
+{
+    int calls = 0;
+    int64_t start = esp_timer_get_time();
+    for (uint32_t i = 0; i < iterations; i++)
+    {
+        int res = op(i2c);
+        if (res < 0)
+        {
+            printf("%-24s failed: %s\n", name, strerror(errno));
+            return;
+        }
+        calls = res;
+    }
+    double us = (double)(esp_timer_get_time() - start) / iterations;
+    printf("%-24s %10.2f %12.0f %12.0f %8d\n", name, us, 1e6 / us, size * 1e6 / us, calls);
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 3)
+    {
+        fprintf(stderr, "Usage: %s adapter addr [reg [size [iterations]]]\n", argv[0]);
+        return 1;
+    }
+    int adapter = strtol(argv[1], NULL, 0);
+    addr = strtoul(argv[2], NULL, 0);
+    reg = argc > 3 ? strtoul(argv[3], NULL, 0) : 0;
+    size = argc > 4 ? strtoul(argv[4], NULL, 0) : 1;
+    uint32_t iterations = argc > 5 ? strtoul(argv[5], NULL, 0) : 10000;
+    if (!size || size > sizeof(buf) || !iterations)
+    {
+        fprintf(stderr, "size must be 1..%u, iterations > 0\n", (unsigned)sizeof(buf));
+        return 1;
+    }
+
+    esp_log_level_set("*", ESP_LOG_WARN);
+
+    char path[32];
+    snprintf(path, sizeof(path), "/dev/i2c-%d", adapter);
+    fd = open(path, O_RDWR);
+    unsigned long funcs = 0;
+    if (fd < 0 || ioctl(fd, I2C_FUNCS, &funcs) < 0 || ioctl(fd, I2C_SLAVE, addr) < 0)
+    {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        return 1;
+    }
+    bool i2c = funcs & I2C_FUNC_I2C;
+
+    ESP_ERROR_CHECK(i2cdev_init());
+    ESP_ERROR_CHECK(i2cdev_linux_set_adapter(PORT, adapter));
+    i2c_config_t cfg = { .mode = I2C_MODE_MASTER };
+    dev.addr = addr;
+    ESP_ERROR_CHECK(i2c_dev_attach(&dev, PORT, &cfg, 0));
+
+    printf("%s, %s transfers, %u byte reads of register 0x%02x at 0x%02x, %u iterations\n\n",
+           path, i2c ? "I2C" : "SMBus", (unsigned)size, reg, addr, (unsigned)iterations);
+    printf("%-24s %10s %12s %12s %8s\n", "method", "us/read", "reads/s", "bytes/s", "syscalls");
+    run(i2c ? "combined (I2C_RDWR)" : "combined (block read)", read_combined, i2c, iterations);
+    run(i2c ? "separate (write, read)" : "separate (byte ops)", read_separate, i2c, iterations);
+    run("i2c_dev_read_reg", read_i2cdev, i2c, iterations);
+
+    i2c_dev_detach(&dev);
+    i2cdev_done();
+    close(fd);
+
+    return 0;
+}
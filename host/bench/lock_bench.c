@@ -0,0 +1,152 @@
+/**
+ * @file lock_bench.c
+ *
+ * Locking cost of driver calls on the simulated I2C bus
+ *
+ * Runs driver calls from one task with the bus in virtual time, so only
+ * host CPU time is measured, and counts semaphore takes and gives per call
+ * (host_semaphore_ops()). Build with and without -DI2CDEV_SINGLE_LOCK=ON
+ * to compare the two locking modes; CONFIG_I2CDEV_PRIORITY doubles the
+ * cost of every port lock round trip. The host build enables options that
+ * Kconfig leaves off, the header line lists those built in.
+ *
+ * Usage: i2c_lock_bench [iterations]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <i2cdev.h>
+#include <i2c_sim.h>
+#include <sim_mcp4728.h>
+#include <sim_tca9534.h>
+#include <mcp4728.h>
+#include <tca9534.h>
+
+#define PORT 0
+#define SDA 21
+#define SCL 22
+#define DAC_ADDR MCP4728A0_I2C_ADDR0
+#define EXP_ADDR 0x38
+#define ROUNDS 5
+
+static sim_mcp4728_t sim_dac;
+static sim_tca9534_t sim_exp;
+static i2c_dev_t dac;
+static i2c_dev_t exp;
+
+typedef struct
+{
+    const char *name;
+    void (*op)(uint32_t i);
+} bench_op_t;
+
+static void op_write_reg(uint32_t i)
+{
+    uint8_t v = i;
+    ESP_ERROR_CHECK(i2c_dev_write_reg(&exp, 0x01, &v, 1));
+}
+
+static void op_dac_fast_write(uint32_t i)
+{
+    ESP_ERROR_CHECK(mcp4728_fast_write(&dac, i & 0x0fff));
+}
+
+static void op_dac_get_raw_output(uint32_t i)
+{
+    uint16_t v;
+    ESP_ERROR_CHECK(mcp4728_get_raw_output(&dac, false, &v));
+}
+
+static void op_exp_port_write(uint32_t i)
+{
+    // Alternate values, unchanged ones are dropped by the register cache
+    ESP_ERROR_CHECK(tca9534_port_write(&exp, i & 1 ? 0x55 : 0xaa));
+}
+
+static void op_exp_set_level(uint32_t i)
+{
+    ESP_ERROR_CHECK(tca9534_set_level(&exp, 3, i & 1));
+}
+
+static const bench_op_t ops[] = {
+    { "i2c_dev_write_reg (no mutex)", op_write_reg },
+    { "mcp4728_fast_write", op_dac_fast_write },
+    { "mcp4728_get_raw_output", op_dac_get_raw_output },
+    { "tca9534_port_write", op_exp_port_write },
+    { "tca9534_set_level", op_exp_set_level },
+};
+
+int main(int argc, char **argv)
+{
+    uint32_t iterations = argc > 1 ? strtoul(argv[1], NULL, 0) : 100000;
+    if (!iterations)
+        iterations = 1;
+
+    esp_log_level_set("*", ESP_LOG_NONE);
+
+    sim_mcp4728_init(&sim_dac, DAC_ADDR);
+    sim_tca9534_init(&sim_exp, EXP_ADDR);
+    ESP_ERROR_CHECK(i2c_sim_attach(PORT, &sim_dac.model));
+    ESP_ERROR_CHECK(i2c_sim_attach(PORT, &sim_exp.model));
+
+    ESP_ERROR_CHECK(i2cdev_init());
+    ESP_ERROR_CHECK(mcp4728_init_desc(&dac, PORT, DAC_ADDR, SDA, SCL));
+    ESP_ERROR_CHECK(tca9534_init_desc(&exp, PORT, EXP_ADDR, SDA, SCL));
+
+    printf("%u iterations, best of %d rounds, %s, %s\n", (unsigned)iterations, ROUNDS,
+#if CONFIG_I2CDEV_SINGLE_LOCK
+           "single lock",
+#else
+           "device mutex and port lock",
+#endif
+#if CONFIG_I2CDEV_PRIORITY
+           "priority port lock"
+#else
+           "mutex port lock"
+#endif
+    );
+    printf("options:"
+#if CONFIG_I2CDEV_STATS
+           " stats"
+#endif
+#if CONFIG_I2CDEV_TRACE
+           " trace"
+#endif
+#if CONFIG_I2CDEV_BREAKER
+           " breaker"
+#endif
+#if CONFIG_I2CDEV_SCL_CALIBRATION
+           " scl_calibration"
+#endif
+#if !CONFIG_I2CDEV_STATS && !CONFIG_I2CDEV_TRACE && !CONFIG_I2CDEV_BREAKER && !CONFIG_I2CDEV_SCL_CALIBRATION
+           " none"
+#endif
+           "\n\n");
+    printf("%-30s %12s %12s\n", "call", "sem ops", "ns/call");
+    for (size_t k = 0; k < sizeof(ops) / sizeof(ops[0]); k++)
+    {
+        double best = 0;
+        uint32_t sem_ops = 0;
+        for (int r = 0; r < ROUNDS; r++)
+        {
+            uint32_t before = host_semaphore_ops();
+            int64_t start = esp_timer_get_time();
+            for (uint32_t i = 0; i < iterations; i++)
+                ops[k].op(i);
+            double ns = (double)(esp_timer_get_time() - start) * 1000 / iterations;
+            sem_ops = host_semaphore_ops() - before;
+            if (!r || ns < best)
+                best = ns;
+        }
+        printf("%-30s %12.1f %12.1f\n", ops[k].name, (double)sem_ops / iterations, best);
+    }
+
+    tca9534_free_desc(&exp);
+    mcp4728_free_desc(&dac);
+    i2cdev_done();
+
+    return 0;
+}
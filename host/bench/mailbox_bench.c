@@ -0,0 +1,167 @@
+/**
+ * @file mailbox_bench.c
+ *
+ * Latest-value-wins mailbox against direct writes on the simulated I2C bus
+ *
+ * Two producers run on one MCP4728 with the bus in realtime mode: an
+ * encoder posting channel A every millisecond, and a dimmer posting bursts
+ * of ten steps on channels B to D every 20 ms. They write directly with
+ * one transaction per value, then post to an mcp4728_mailbox. Reports
+ * producer calls, the time they took, bus transactions and bus time,
+ * values coalesced and whether the outputs end at the last values.
+ *
+ * Usage: i2c_mailbox_bench [duration, ms]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <i2cdev.h>
+#include <i2c_sim.h>
+#include <sim_mcp4728.h>
+#include <mcp4728.h>
+#include <mcp4728_bank.h>
+#include <mcp4728_mailbox.h>
+
+#define PORT 0
+#define SDA 21
+#define SCL 22
+#define DAC_ADDR MCP4728A0_I2C_ADDR0
+#define BURST_PERIOD_MS 20
+#define BURST_STEPS 10
+
+static sim_mcp4728_t sim_dac;
+static mcp4728_bank_t bank;
+static mcp4728_mailbox_t mailbox;
+static bool use_mailbox;
+static uint32_t duration_ms;
+static TaskHandle_t main_task;
+
+typedef struct
+{
+    uint32_t calls;
+    int64_t us;
+    int64_t max_us;
+    uint16_t last[MCP4728_NUM_CH];
+} producer_t;
+
+static producer_t encoder, dimmer;
+
+static void put(producer_t *p, uint8_t ch, uint16_t value)
+{
+    int64_t start = esp_timer_get_time();
+    if (use_mailbox)
+        ESP_ERROR_CHECK(mcp4728_mailbox_post(&mailbox, ch, value));
+    else
+    {
+        uint16_t values[MCP4728_NUM_CH] = { 0 };
+        values[ch] = value;
+        ESP_ERROR_CHECK(mcp4728_bank_write(&bank, 0, MCP4728_CH_BIT(ch), values));
+    }
+    int64_t us = esp_timer_get_time() - start;
+
+    p->calls++;
+    p->us += us;
+    p->max_us = us > p->max_us ? us : p->max_us;
+    p->last[ch] = value;
+}
+
+static void encoder_task(void *arg)
+{
+    TickType_t wake = xTaskGetTickCount();
+    for (uint32_t i = 0; i < duration_ms; i++)
+    {
+        put(&encoder, MCP4728_CH_A, (i * 7) & 0x0fff);
+        xTaskDelayUntil(&wake, pdMS_TO_TICKS(1));
+    }
+    xTaskNotifyGive(main_task);
+    vTaskDelete(NULL);
+}
+
+static void dimmer_task(void *arg)
+{
+    TickType_t wake = xTaskGetTickCount();
+    for (uint32_t i = 0; i < duration_ms / BURST_PERIOD_MS; i++)
+    {
+        for (uint16_t step = 1; step <= BURST_STEPS; step++)
+            for (uint8_t ch = MCP4728_CH_B; ch < MCP4728_NUM_CH; ch++)
+                put(&dimmer, ch, (i * 64 + step * 4 + ch) & 0x0fff);
+        xTaskDelayUntil(&wake, pdMS_TO_TICKS(BURST_PERIOD_MS));
+    }
+    xTaskNotifyGive(main_task);
+    vTaskDelete(NULL);
+}
+
+static void report(const char *name, const producer_t *p)
+{
+    printf("  %-8s %8u calls %10.1f us avg %10lld us max\n", name, (unsigned)p->calls,
+           p->calls ? (double)p->us / p->calls : 0.0, (long long)p->max_us);
+}
+
+static void run(bool mailbox_on)
+{
+    use_mailbox = mailbox_on;
+    encoder = (producer_t){ 0 };
+    dimmer = (producer_t){ 0 };
+    if (use_mailbox)
+        ESP_ERROR_CHECK(mcp4728_mailbox_init(&mailbox, &bank, CONFIG_MCP4728_MAILBOX_PERIOD_MS));
+
+    i2c_sim_stats_t st;
+    i2c_sim_get_stats(PORT, &st, true);
+
+    main_task = xTaskGetCurrentTaskHandle();
+    xTaskCreate(encoder_task, "encoder", 4096, NULL, 5, NULL);
+    xTaskCreate(dimmer_task, "dimmer", 4096, NULL, 5, NULL);
+    ulTaskNotifyTake(pdFALSE, portMAX_DELAY);
+    ulTaskNotifyTake(pdFALSE, portMAX_DELAY);
+
+    mcp4728_mailbox_stats_t mst = { 0 };
+    if (use_mailbox)
+    {
+        mcp4728_mailbox_get_stats(&mailbox, &mst, false);
+        // Writes what is still posted
+        ESP_ERROR_CHECK(mcp4728_mailbox_free(&mailbox));
+    }
+    i2c_sim_get_stats(PORT, &st, false);
+
+    bool ok = sim_dac.output[MCP4728_CH_A].value == encoder.last[MCP4728_CH_A];
+    for (uint8_t ch = MCP4728_CH_B; ch < MCP4728_NUM_CH; ch++)
+        ok = ok && sim_dac.output[ch].value == dimmer.last[ch];
+
+    printf("%s\n", use_mailbox ? "mailbox" : "direct writes");
+    report("encoder", &encoder);
+    report("dimmer", &dimmer);
+    printf("  %u transactions, %.1f ms bus time, %u coalesced in %u flushes, outputs %s\n\n",
+           (unsigned)st.transactions, st.bus_time_us / 1000.0, (unsigned)mst.coalesced, (unsigned)mst.flushes,
+           ok ? "at last values" : "WRONG");
+}
+
+int main(int argc, char **argv)
+{
+    duration_ms = argc > 1 ? strtoul(argv[1], NULL, 0) : 1000;
+    if (duration_ms < BURST_PERIOD_MS)
+        duration_ms = BURST_PERIOD_MS;
+
+    esp_log_level_set("*", ESP_LOG_NONE);
+
+    sim_mcp4728_init(&sim_dac, DAC_ADDR);
+    ESP_ERROR_CHECK(i2c_sim_attach(PORT, &sim_dac.model));
+    i2c_sim_timing_t timing = { .overhead_us = 20, .byte_bits = 9, .cond_bits = 1, .realtime = true };
+    i2c_sim_set_timing(&timing);
+
+    ESP_ERROR_CHECK(i2cdev_init());
+    const mcp4728_bank_dac_t dac = { .port = PORT, .addr = DAC_ADDR, .sda_gpio = SDA, .scl_gpio = SCL };
+    ESP_ERROR_CHECK(mcp4728_bank_init(&bank, &dac, 1));
+
+    printf("%u ms, encoder every 1 ms, %d-step bursts on 3 channels every %d ms, flush period %d ms\n\n",
+           (unsigned)duration_ms, BURST_STEPS, BURST_PERIOD_MS, CONFIG_MCP4728_MAILBOX_PERIOD_MS);
+    run(false);
+    run(true);
+
+    mcp4728_bank_free(&bank);
+    i2cdev_done();
+
+    return 0;
+}
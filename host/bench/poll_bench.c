@@ -0,0 +1,190 @@
+/**
+ * @file poll_bench.c
+ *
+ * Periodic polling on the simulated I2C bus: one task per job against the
+ * i2c_poll scheduler
+ *
+ * Four jobs poll a TCA9534 and an MCP4728 at 1 kHz, 100 Hz, 10 Hz and 1 Hz,
+ * the DAC ones with 24 byte readbacks that hold the bus for over half a
+ * tick. The bus runs in realtime mode. First every job runs in its own
+ * task with vTaskDelayUntil(), all started on the same tick, then the same
+ * jobs run on the scheduler, which lays them out on different ticks.
+ * Reports runs, deadline misses and release jitter per job.
+ *
+ * Usage: i2c_poll_bench [duration, ms]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/semphr.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <i2cdev.h>
+#include <i2c_poll.h>
+#include <i2c_sim.h>
+#include <sim_mcp4728.h>
+#include <sim_tca9534.h>
+#include <mcp4728.h>
+#include <tca9534.h>
+
+#define PORT 0
+#define SDA 21
+#define SCL 22
+#define DAC_ADDR MCP4728A0_I2C_ADDR0
+#define EXP_ADDR 0x38
+#define READBACK_SIZE 24
+#define JOBS 4
+
+#define TICK_US (1000000 / configTICK_RATE_HZ)
+
+static sim_mcp4728_t sim_dac;
+static sim_tca9534_t sim_exp;
+static i2c_dev_t dac;
+static i2c_dev_t exp;
+
+static uint8_t exp_regs[JOBS] = { 0x00, 0, 0, 0x03 }; // input, -, -, config
+static uint8_t bufs[JOBS][READBACK_SIZE];
+static i2c_dev_seg_t segs[JOBS];
+static i2c_poll_job_t jobs[JOBS];
+static const char *names[JOBS] = { "exp input", "dac readback", "dac readback", "exp config" };
+static const uint32_t periods_ms[JOBS] = { 1, 10, 100, 1000 };
+
+static SemaphoreHandle_t done;
+static volatile bool stop;
+
+static void init_jobs(void)
+{
+    for (int i = 0; i < JOBS; i++)
+    {
+        bool is_exp = i == 0 || i == JOBS - 1;
+        segs[i] = (i2c_dev_seg_t) {
+            .dev = is_exp ? &exp : &dac,
+            .read = true,
+            .out = is_exp ? &exp_regs[i] : NULL,
+            .out_size = is_exp ? 1 : 0,
+            .data = bufs[i],
+            .size = is_exp ? 1 : READBACK_SIZE,
+        };
+        memset(&jobs[i], 0, sizeof(i2c_poll_job_t));
+        jobs[i].segs = &segs[i];
+        jobs[i].count = 1;
+        jobs[i].period_ms = periods_ms[i];
+    }
+}
+
+// Same accounting as the scheduler
+static void account(i2c_poll_job_t *job, TickType_t release, int64_t start, int64_t end, esp_err_t res)
+{
+    int64_t release_us = (int64_t)release * TICK_US;
+    uint32_t jitter = start > release_us ? start - release_us : 0;
+    job->stats.runs++;
+    if (res != ESP_OK)
+        job->stats.errors++;
+    job->stats.jitter_sum_us += jitter;
+    if (jitter > job->stats.jitter_max_us)
+        job->stats.jitter_max_us = jitter;
+    if (end - start > job->stats.duration_max_us)
+        job->stats.duration_max_us = end - start;
+    if (end > release_us + (int64_t)job->period * TICK_US)
+        job->stats.misses++;
+}
+
+static void poller(void *arg)
+{
+    i2c_poll_job_t *job = arg;
+    TickType_t wake = job->release - job->period;
+
+    while (!stop)
+    {
+        vTaskDelayUntil(&wake, job->period);
+        int64_t start = esp_timer_get_time();
+        esp_err_t res = i2c_dev_batch(job->segs, job->count);
+        account(job, wake, start, esp_timer_get_time(), res);
+    }
+
+    xSemaphoreGive(done);
+    vTaskDelete(NULL);
+}
+
+static void report(const char *name)
+{
+    printf("%s\n", name);
+    printf("%-13s %7s %7s %6s %7s %12s %12s %10s\n", "job", "period", "offset", "runs", "misses",
+           "jitter, us", "max, us", "run max");
+    for (int i = 0; i < JOBS; i++)
+    {
+        i2c_poll_stats_t st = jobs[i].stats;
+        printf("%-13s %5ums %7u %6u %7u %12.1f %12u %10u\n", names[i], (unsigned)jobs[i].period_ms,
+               (unsigned)jobs[i].offset, (unsigned)st.runs, (unsigned)st.misses,
+               st.runs ? (double)st.jitter_sum_us / st.runs : 0.0, (unsigned)st.jitter_max_us,
+               (unsigned)st.duration_max_us);
+    }
+    printf("\n");
+}
+
+static void run_tasks(uint32_t duration_ms)
+{
+    init_jobs();
+    stop = false;
+    TickType_t first = xTaskGetTickCount() + 2;
+    for (int i = 0; i < JOBS; i++)
+    {
+        jobs[i].period = pdMS_TO_TICKS(jobs[i].period_ms);
+        jobs[i].release = first;
+        xTaskCreate(poller, names[i], 4096, &jobs[i], 5, NULL);
+    }
+    vTaskDelay(pdMS_TO_TICKS(duration_ms));
+    stop = true;
+    for (int i = 0; i < JOBS; i++)
+        xSemaphoreTake(done, portMAX_DELAY);
+
+    report("One task per job, vTaskDelayUntil()");
+}
+
+static void run_scheduler(uint32_t duration_ms)
+{
+    init_jobs();
+    for (int i = 0; i < JOBS; i++)
+        ESP_ERROR_CHECK(i2c_poll_add(&jobs[i]));
+    vTaskDelay(pdMS_TO_TICKS(duration_ms));
+    // Stats are read before the stop removes the jobs
+    for (int i = 0; i < JOBS; i++)
+        i2c_poll_get_stats(&jobs[i], &jobs[i].stats, false);
+    ESP_ERROR_CHECK(i2c_poll_stop(PORT));
+
+    report("i2c_poll scheduler");
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t duration = argc > 1 ? strtoul(argv[1], NULL, 0) : 3000;
+    if (!duration)
+        duration = 1;
+
+    esp_log_level_set("*", ESP_LOG_NONE);
+
+    sim_mcp4728_init(&sim_dac, DAC_ADDR);
+    sim_tca9534_init(&sim_exp, EXP_ADDR);
+    ESP_ERROR_CHECK(i2c_sim_attach(PORT, &sim_dac.model));
+    ESP_ERROR_CHECK(i2c_sim_attach(PORT, &sim_exp.model));
+    i2c_sim_timing_t timing = { .overhead_us = 20, .byte_bits = 9, .cond_bits = 1, .realtime = true };
+    i2c_sim_set_timing(&timing);
+
+    done = xSemaphoreCreateCounting(JOBS, 0);
+
+    ESP_ERROR_CHECK(i2cdev_init());
+    ESP_ERROR_CHECK(mcp4728_init_desc(&dac, PORT, DAC_ADDR, SDA, SCL));
+    ESP_ERROR_CHECK(tca9534_init_desc(&exp, PORT, EXP_ADDR, SDA, SCL));
+
+    printf("%u ms per run, %u us ticks\n\n", (unsigned)duration, (unsigned)TICK_US);
+    run_tasks(duration);
+    run_scheduler(duration);
+
+    tca9534_free_desc(&exp);
+    mcp4728_free_desc(&dac);
+    i2cdev_done();
+
+    return 0;
+}
@@ -0,0 +1,187 @@
+/**
+ * @file prio_bench.c
+ *
+ * Port arbitration under contention on the simulated I2C bus
+ *
+ * Bulk tasks keep the port busy with 24 byte MCP4728 readbacks while a
+ * realtime task writes the DAC and a normal task polls the TCA9534. The bus
+ * runs in realtime mode, so transfers hold the port for their bus time.
+ * Every scenario runs twice: with all devices in one class and with
+ * realtime, normal and bulk classes, and reports call latency per role and
+ * the per-class port wait counters of i2cdev.
+ *
+ * Usage: i2c_prio_bench [duration, ms]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/semphr.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <i2cdev.h>
+#include <i2c_sim.h>
+#include <sim_mcp4728.h>
+#include <sim_tca9534.h>
+#include <mcp4728.h>
+#include <tca9534.h>
+
+#define PORT 0
+#define SDA 21
+#define SCL 22
+#define DAC_ADDR MCP4728A0_I2C_ADDR0
+#define EXP_ADDR 0x38
+#define BULK_TASKS 3
+#define READBACK_SIZE 24
+
+typedef enum
+{
+    ROLE_REALTIME = 0,
+    ROLE_NORMAL,
+    ROLE_BULK,
+    ROLE_MAX
+} role_t;
+
+static const char *role_names[ROLE_MAX] = { "realtime", "normal", "bulk" };
+static const i2c_dev_prio_t role_prio[ROLE_MAX] = { I2C_DEV_PRIO_REALTIME, I2C_DEV_PRIO_NORMAL, I2C_DEV_PRIO_BULK };
+
+typedef struct
+{
+    uint32_t calls;
+    uint32_t errors;
+    int64_t total_us;
+    int64_t max_us;
+} role_stats_t;
+
+static sim_mcp4728_t sim_dac;
+static sim_tca9534_t sim_exp;
+static i2c_dev_t dac;      // realtime role
+static i2c_dev_t exp;      // normal role
+static i2c_dev_t readback; // bulk role, same DAC
+static role_stats_t stats[ROLE_MAX];
+static SemaphoreHandle_t stats_lock;
+static SemaphoreHandle_t done;
+static volatile bool stop;
+
+static esp_err_t call(role_t role, uint32_t i)
+{
+    uint8_t buf[READBACK_SIZE];
+    switch (role)
+    {
+        case ROLE_REALTIME:
+            return mcp4728_fast_write(&dac, i & 0x0fff);
+        case ROLE_NORMAL:
+            return tca9534_port_read(&exp, buf);
+        default:
+            return i2c_dev_read(&readback, NULL, 0, buf, sizeof(buf));
+    }
+}
+
+static void worker(void *arg)
+{
+    role_t role = (role_t)(intptr_t)arg;
+    // Realtime and normal roles are periodic, bulk transfers run back to back
+    TickType_t period = role == ROLE_REALTIME ? pdMS_TO_TICKS(2) : role == ROLE_NORMAL ? pdMS_TO_TICKS(5) : 0;
+
+    for (uint32_t i = 0; !stop; i++)
+    {
+        int64_t start = esp_timer_get_time();
+        esp_err_t res = call(role, i);
+        int64_t us = esp_timer_get_time() - start;
+
+        xSemaphoreTake(stats_lock, portMAX_DELAY);
+        stats[role].calls++;
+        if (res != ESP_OK)
+            stats[role].errors++;
+        stats[role].total_us += us;
+        if (us > stats[role].max_us)
+            stats[role].max_us = us;
+        xSemaphoreGive(stats_lock);
+
+        if (period)
+            vTaskDelay(period);
+    }
+
+    xSemaphoreGive(done);
+    vTaskDelete(NULL);
+}
+
+static void run(const char *name, bool classes, uint32_t duration_ms)
+{
+    dac.prio = classes ? I2C_DEV_PRIO_REALTIME : I2C_DEV_PRIO_NORMAL;
+    exp.prio = I2C_DEV_PRIO_NORMAL;
+    readback.prio = classes ? I2C_DEV_PRIO_BULK : I2C_DEV_PRIO_NORMAL;
+
+    memset(stats, 0, sizeof(stats));
+    for (int i = I2C_DEV_PRIO_BULK; i <= I2C_DEV_PRIO_REALTIME; i++)
+        i2cdev_get_prio_stats(PORT, i, NULL, true);
+
+    stop = false;
+    size_t tasks = 0;
+    for (role_t role = 0; role < ROLE_MAX; role++)
+        for (int i = 0; i < (role == ROLE_BULK ? BULK_TASKS : 1); i++, tasks++)
+            xTaskCreate(worker, role_names[role], 4096, (void *)(intptr_t)role, 5, NULL);
+    vTaskDelay(pdMS_TO_TICKS(duration_ms));
+    stop = true;
+    while (tasks--)
+        xSemaphoreTake(done, portMAX_DELAY);
+
+    printf("%s\n", name);
+    printf("%-10s %8s %6s %10s %10s %14s\n", "role", "calls", "errors", "mean, us", "max, us", "port wait, us");
+    for (role_t role = 0; role < ROLE_MAX; role++)
+    {
+        // Per-class wait is only meaningful when every role has its own class
+        i2cdev_prio_stats_t prio;
+        bool own = classes && i2cdev_get_prio_stats(PORT, role_prio[role], &prio, false) == ESP_OK;
+        printf("%-10s %8u %6u %10.1f %10lld", role_names[role], (unsigned)stats[role].calls,
+               (unsigned)stats[role].errors, stats[role].calls ? (double)stats[role].total_us / stats[role].calls : 0.0,
+               (long long)stats[role].max_us);
+        if (own)
+            printf(" %14u\n", (unsigned)prio.wait.max_us);
+        else
+            printf(" %14s\n", "-");
+    }
+    printf("\n");
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t duration = argc > 1 ? strtoul(argv[1], NULL, 0) : 2000;
+    if (!duration)
+        duration = 1;
+
+    esp_log_level_set("*", ESP_LOG_NONE);
+
+    sim_mcp4728_init(&sim_dac, DAC_ADDR);
+    sim_tca9534_init(&sim_exp, EXP_ADDR);
+    ESP_ERROR_CHECK(i2c_sim_attach(PORT, &sim_dac.model));
+    ESP_ERROR_CHECK(i2c_sim_attach(PORT, &sim_exp.model));
+    i2c_sim_timing_t timing = { .overhead_us = 20, .byte_bits = 9, .cond_bits = 1, .realtime = true };
+    i2c_sim_set_timing(&timing);
+
+    stats_lock = xSemaphoreCreateMutex();
+    done = xSemaphoreCreateCounting(BULK_TASKS + ROLE_MAX, 0);
+
+    ESP_ERROR_CHECK(i2cdev_init());
+    ESP_ERROR_CHECK(mcp4728_init_desc(&dac, PORT, DAC_ADDR, SDA, SCL));
+    ESP_ERROR_CHECK(mcp4728_init_desc(&readback, PORT, DAC_ADDR, SDA, SCL));
+    ESP_ERROR_CHECK(tca9534_init_desc(&exp, PORT, EXP_ADDR, SDA, SCL));
+
+    printf("%u ms per run, %d bulk tasks, %s\n\n", (unsigned)duration, BULK_TASKS,
+#if CONFIG_I2CDEV_PRIORITY
+           "priority arbitration"
+#else
+           "no priority arbitration (CONFIG_I2CDEV_PRIORITY off)"
+#endif
+    );
+    run("One class", false, duration);
+    run("Realtime, normal and bulk classes", true, duration);
+
+    tca9534_free_desc(&exp);
+    mcp4728_free_desc(&readback);
+    mcp4728_free_desc(&dac);
+    i2cdev_done();
+
+    return 0;
+}
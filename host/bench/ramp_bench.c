@@ -0,0 +1,176 @@
+/**
+ * @file ramp_bench.c
+ *
+ * Ramp engine against caller-timed ramps on the simulated I2C bus
+ *
+ * The four channels of one MCP4728 ramp from zero to full scale with the
+ * bus in realtime mode: A, B and C over 100, 200 and 300 ms, D at 10000
+ * steps per second. Caller-timed, one task per channel writes a value
+ * every 10 ms. With mcp4728_ramp, channel A is also retargeted halfway
+ * up, to 1000 over another 100 ms. Reports bus transactions, bus time,
+ * the largest jump of D seen by sampling the outputs every millisecond,
+ * whether the outputs end at their targets and the transactions in the
+ * 200 ms after all ramps finished.
+ *
+ * Usage: i2c_ramp_bench
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <esp_log.h>
+#include <i2cdev.h>
+#include <i2c_sim.h>
+#include <sim_mcp4728.h>
+#include <mcp4728.h>
+#include <mcp4728_bank.h>
+#include <mcp4728_ramp.h>
+
+#define PORT 0
+#define SDA 21
+#define SCL 22
+#define DAC_ADDR MCP4728A0_I2C_ADDR0
+#define PERIOD_MS 10
+#define SLEW_RATE 10000
+#define RETARGET 1000
+#define IDLE_MS 200
+
+static const uint32_t durations[MCP4728_NUM_CH - 1] = { 100, 200, 300 };
+
+static sim_mcp4728_t sim_dac;
+static mcp4728_bank_t bank;
+static mcp4728_ramp_t ramp;
+static TaskHandle_t main_task;
+
+static void write_channel(uint8_t ch, uint16_t value)
+{
+    uint16_t values[MCP4728_NUM_CH] = { 0 };
+    values[ch] = value;
+    ESP_ERROR_CHECK(mcp4728_bank_write(&bank, 0, MCP4728_CH_BIT(ch), values));
+}
+
+// Caller-timed ramp of one channel to full scale
+static void caller_task(void *arg)
+{
+    uint8_t ch = (uintptr_t)arg;
+    uint32_t steps = ch < MCP4728_CH_D
+        ? durations[ch] / PERIOD_MS
+        : (MCP4728_MAX_VALUE * 1000 / SLEW_RATE + PERIOD_MS - 1) / PERIOD_MS;
+
+    TickType_t wake = xTaskGetTickCount();
+    for (uint32_t i = 1; i <= steps; i++)
+    {
+        vTaskDelayUntil(&wake, pdMS_TO_TICKS(PERIOD_MS));
+        write_channel(ch, MCP4728_MAX_VALUE * i / steps);
+    }
+    xTaskNotifyGive(main_task);
+    vTaskDelete(NULL);
+}
+
+static bool ramps_active(void)
+{
+    for (uint8_t ch = 0; ch < MCP4728_NUM_CH; ch++)
+    {
+        bool active;
+        ESP_ERROR_CHECK(mcp4728_ramp_get(&ramp, ch, NULL, &active));
+        if (active)
+            return true;
+    }
+    return false;
+}
+
+static void run(bool engine)
+{
+    static const uint16_t zero[MCP4728_NUM_CH] = { 0 };
+    ESP_ERROR_CHECK(mcp4728_bank_write(&bank, 0, MCP4728_CH_ALL, zero));
+
+    uint16_t targets[MCP4728_NUM_CH] = { MCP4728_MAX_VALUE, MCP4728_MAX_VALUE, MCP4728_MAX_VALUE,
+                                         MCP4728_MAX_VALUE };
+    i2c_sim_stats_t st;
+    i2c_sim_get_stats(PORT, &st, true);
+    TickType_t start = xTaskGetTickCount();
+
+    main_task = xTaskGetCurrentTaskHandle();
+    if (engine)
+    {
+        for (uint8_t ch = MCP4728_CH_A; ch < MCP4728_CH_D; ch++)
+            ESP_ERROR_CHECK(mcp4728_ramp_to(&ramp, ch, MCP4728_MAX_VALUE, durations[ch]));
+        ESP_ERROR_CHECK(mcp4728_ramp_slew(&ramp, MCP4728_CH_D, MCP4728_MAX_VALUE, SLEW_RATE));
+    }
+    else
+        for (uint8_t ch = 0; ch < MCP4728_NUM_CH; ch++)
+            xTaskCreate(caller_task, "caller", 4096, (void *)(uintptr_t)ch, 6, NULL);
+
+    // Sample D every millisecond until all ramps are done
+    uint16_t prev = 0, jump = 0;
+    uint32_t done = 0;
+    bool retargeted = false;
+    TickType_t wake = start;
+    while (engine ? ramps_active() : done < MCP4728_NUM_CH)
+    {
+        vTaskDelayUntil(&wake, 1);
+        if (!engine)
+            done += ulTaskNotifyTake(pdFALSE, 0);
+        uint16_t v = sim_dac.output[MCP4728_CH_D].value;
+        jump = v - prev > jump ? v - prev : jump;
+        prev = v;
+        if (engine && !retargeted && xTaskGetTickCount() - start >= pdMS_TO_TICKS(durations[0] / 2))
+        {
+            ESP_ERROR_CHECK(mcp4728_ramp_to(&ramp, MCP4728_CH_A, RETARGET, 100));
+            targets[MCP4728_CH_A] = RETARGET;
+            retargeted = true;
+        }
+    }
+    uint32_t took = (xTaskGetTickCount() - start) * portTICK_PERIOD_MS;
+    i2c_sim_get_stats(PORT, &st, false);
+
+    i2c_sim_stats_t idle;
+    i2c_sim_get_stats(PORT, &idle, true);
+    vTaskDelay(pdMS_TO_TICKS(IDLE_MS));
+    i2c_sim_get_stats(PORT, &idle, false);
+
+    bool ok = true;
+    for (uint8_t ch = 0; ch < MCP4728_NUM_CH; ch++)
+        ok = ok && sim_dac.output[ch].value == targets[ch];
+
+    printf("%s\n", engine ? "mcp4728_ramp" : "caller-timed writes");
+    printf("  %u ms, %u transactions, %.1f ms bus time, largest jump on D %u (limit %d), outputs %s\n",
+           (unsigned)took, (unsigned)st.transactions, st.bus_time_us / 1000.0, (unsigned)jump,
+           SLEW_RATE * PERIOD_MS / 1000, ok ? "at targets" : "WRONG");
+    if (engine)
+    {
+        mcp4728_ramp_stats_t rst;
+        mcp4728_ramp_get_stats(&ramp, &rst, true);
+        printf("  %u ramps, %u retargeted, %u finished, %u ticks\n", (unsigned)rst.ramps,
+               (unsigned)rst.retargeted, (unsigned)rst.finished, (unsigned)rst.ticks);
+    }
+    printf("  %u transactions in %d ms after the ramps\n\n", (unsigned)idle.transactions, IDLE_MS);
+}
+
+int main(int argc, char **argv)
+{
+    esp_log_level_set("*", ESP_LOG_NONE);
+
+    sim_mcp4728_init(&sim_dac, DAC_ADDR);
+    ESP_ERROR_CHECK(i2c_sim_attach(PORT, &sim_dac.model));
+    i2c_sim_timing_t timing = { .overhead_us = 20, .byte_bits = 9, .cond_bits = 1, .realtime = true };
+    i2c_sim_set_timing(&timing);
+
+    ESP_ERROR_CHECK(i2cdev_init());
+    const mcp4728_bank_dac_t dac = { .port = PORT, .addr = DAC_ADDR, .sda_gpio = SDA, .scl_gpio = SCL };
+    ESP_ERROR_CHECK(mcp4728_bank_init(&bank, &dac, 1));
+    // Outputs change on the latch of a commit
+    sim_mcp4728_set_ldac(&sim_dac, true);
+    ESP_ERROR_CHECK(mcp4728_ramp_init(&ramp, &bank, PERIOD_MS));
+
+    printf("A, B, C to full scale over %u, %u, %u ms, D at %d steps/s, %d ms period\n\n",
+           (unsigned)durations[0], (unsigned)durations[1], (unsigned)durations[2], SLEW_RATE, PERIOD_MS);
+    run(false);
+    run(true);
+
+    mcp4728_ramp_free(&ramp);
+    mcp4728_bank_free(&bank);
+    i2cdev_done();
+
+    return 0;
+}
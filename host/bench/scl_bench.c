@@ -0,0 +1,139 @@
+/**
+ * @file scl_bench.c
+ *
+ * SCL calibration on the simulated I2C bus
+ *
+ * The wiring to the MCP4728 takes 760 kHz, less than the 1 MHz its driver
+ * defaults to, the wiring to the TCA9534 900 kHz, more than its 400 kHz
+ * default (see i2c_sim_model_t.max_clk_hz). Both devices are polled at
+ * their default frequency, calibrated, then the descriptors are freed and
+ * created again as after a reboot, picking up the frequencies stored in
+ * NVS, and polled again. Reports frequency, bus time per call and calls
+ * that returned corrupted data.
+ *
+ * Usage: i2c_scl_bench [calls]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <esp_log.h>
+#include <nvs_flash.h>
+#include <i2cdev.h>
+#include <i2c_scl.h>
+#include <i2c_sim.h>
+#include <sim_mcp4728.h>
+#include <sim_tca9534.h>
+#include <mcp4728.h>
+#include <tca9534.h>
+
+#define PORT 0
+#define SDA 21
+#define SCL 22
+#define DAC_ADDR MCP4728A0_I2C_ADDR0
+#define EXP_ADDR 0x38
+#define DAC_MAX_CLK 760000
+#define EXP_MAX_CLK 900000
+#define EXP_PINS 0xa5
+#define READBACK_SIZE 24
+
+static sim_mcp4728_t sim_dac;
+static sim_tca9534_t sim_exp;
+static i2c_dev_t dac;
+static i2c_dev_t exp;
+
+static void init_descs(void)
+{
+    ESP_ERROR_CHECK(mcp4728_init_desc(&dac, PORT, DAC_ADDR, SDA, SCL));
+    ESP_ERROR_CHECK(tca9534_init_desc(&exp, PORT, EXP_ADDR, SDA, SCL));
+}
+
+static void free_descs(void)
+{
+    tca9534_free_desc(&exp);
+    mcp4728_free_desc(&dac);
+}
+
+static bool dac_call(void)
+{
+    uint8_t buf[READBACK_SIZE];
+    if (i2c_dev_read(&dac, NULL, 0, buf, sizeof(buf)) != ESP_OK)
+        return false;
+    for (size_t i = 0; i < READBACK_SIZE / 3; i++)
+        if ((buf[i * 3] & 0x3f) != (((i / 2) << 4) | (DAC_ADDR & 0x07)))
+            return false;
+    return true;
+}
+
+static bool exp_call(void)
+{
+    uint8_t val;
+    return tca9534_port_read(&exp, &val) == ESP_OK && val == EXP_PINS;
+}
+
+static void poll(const char *name, i2c_dev_t *dev, bool (*call)(void), uint32_t calls)
+{
+    i2c_sim_stats_t st;
+    uint32_t bad = 0;
+    i2c_sim_get_stats(PORT, &st, true);
+    for (uint32_t i = 0; i < calls; i++)
+        bad += !call();
+    i2c_sim_get_stats(PORT, &st, false);
+
+    printf("%-8s %8u %14.1f %10u\n", name, (unsigned)(dev->bus->cfg.master.clk_speed / 1000),
+           (double)st.bus_time_us / calls, (unsigned)bad);
+}
+
+static void report(const char *name, uint32_t calls)
+{
+    printf("%s\n%-8s %8s %14s %10s\n", name, "device", "SCL, kHz", "bus us/call", "corrupted");
+    poll("MCP4728", &dac, dac_call, calls);
+    poll("TCA9534", &exp, exp_call, calls);
+    printf("\n");
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t calls = argc > 1 ? strtoul(argv[1], NULL, 0) : 1000;
+    if (!calls)
+        calls = 1;
+
+    esp_log_level_set("*", ESP_LOG_NONE);
+    ESP_ERROR_CHECK(nvs_flash_init());
+
+    sim_mcp4728_init(&sim_dac, DAC_ADDR);
+    sim_tca9534_init(&sim_exp, EXP_ADDR);
+    sim_dac.model.max_clk_hz = DAC_MAX_CLK;
+    sim_exp.model.max_clk_hz = EXP_MAX_CLK;
+    sim_exp.pins = EXP_PINS;
+    ESP_ERROR_CHECK(i2c_sim_attach(PORT, &sim_dac.model));
+    ESP_ERROR_CHECK(i2c_sim_attach(PORT, &sim_exp.model));
+
+    ESP_ERROR_CHECK(i2cdev_init());
+
+    printf("%u calls per device, wiring takes %u kHz (MCP4728) and %u kHz (TCA9534)\n\n",
+           (unsigned)calls, DAC_MAX_CLK / 1000, EXP_MAX_CLK / 1000);
+
+    init_descs();
+    report("Driver defaults", calls);
+
+#if !CONFIG_I2CDEV_SCL_CALIBRATION
+    printf("No calibration (CONFIG_I2CDEV_SCL_CALIBRATION off)\n");
+    free_descs();
+    i2cdev_done();
+    return 0;
+#endif
+
+    uint32_t dac_hz, exp_hz;
+    ESP_ERROR_CHECK(mcp4728_calibrate_scl(&dac, 1000000, &dac_hz));
+    ESP_ERROR_CHECK(tca9534_calibrate_scl(&exp, 1000000, &exp_hz));
+    printf("Calibrated: MCP4728 %u kHz, TCA9534 %u kHz, TCA9534 polarity 0x%02x\n\n",
+           (unsigned)(dac_hz / 1000), (unsigned)(exp_hz / 1000), sim_exp.polarity);
+
+    free_descs();
+    init_descs();
+    report("After reboot, frequencies from NVS", calls);
+
+    free_descs();
+    i2cdev_done();
+
+    return 0;
+}
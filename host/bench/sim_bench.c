@@ -0,0 +1,218 @@
+/**
+ * @file sim_bench.c
+ *
+ * Driver benchmark on the simulated I2C bus
+ *
+ * Runs MCP4728 and TCA9534 driver calls against the bus models and reports
+ * per call wall time (host CPU cost of the driver stack) and simulated bus
+ * time, transactions and bytes (what the call costs on a real bus).
+ *
+ * With a trace file, transactions of the last calls are dumped to it with
+ * i2cdev_trace_dump(), as CSV if the name ends with .csv. Binary traces
+ * can be replayed with i2c_replay.
+ *
+ * Usage: i2c_sim_bench [iterations [trace file]]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <i2cdev.h>
+#include <i2c_sim.h>
+#include <sim_mcp4728.h>
+#include <sim_tca9534.h>
+#include <mcp4728.h>
+#include <my_i2cdac.h>
+#include <tca9534.h>
+#include <i2c_exp.h>
+
+#define PORT 0
+#define SDA 21
+#define SCL 22
+#define DAC_ADDR MCP4728A0_I2C_ADDR0
+#define EXP_ADDR 0x38
+#define TRACE_RECORDS 4096
+
+static sim_mcp4728_t sim_dac;
+static sim_tca9534_t sim_exp;
+static i2c_dev_t dac;
+static i2c_dev_t exp;
+
+typedef struct
+{
+    const char *name;
+    void (*op)(uint32_t i);
+} bench_op_t;
+
+static void op_dac_write_channel(uint32_t i)
+{
+    dac_write_channel(i % 4, i & 0x0fff);
+}
+
+/* 4-channel updates: one transaction per channel, then one for all */
+static void op_dac_write_4ch(uint32_t i)
+{
+    for (uint8_t ch = 0; ch < MCP4728_NUM_CH; ch++)
+        dac_write_channel(ch, (i + ch) & 0x0fff);
+}
+
+static void op_dac_fast_write_all(uint32_t i)
+{
+    uint16_t values[MCP4728_NUM_CH] = { i & 0x0fff, (i + 1) & 0x0fff, (i + 2) & 0x0fff, (i + 3) & 0x0fff };
+    ESP_ERROR_CHECK(mcp4728_fast_write_all(&dac, values));
+}
+
+static void op_dac_multi_write(uint32_t i)
+{
+    uint16_t values[MCP4728_NUM_CH] = { 0, i & 0x0fff, 0, (i + 3) & 0x0fff };
+    ESP_ERROR_CHECK(mcp4728_multi_write(&dac, MCP4728_CH_BIT(MCP4728_CH_B) | MCP4728_CH_BIT(MCP4728_CH_D), values));
+}
+
+static void op_dac_fast_write(uint32_t i)
+{
+    ESP_ERROR_CHECK(mcp4728_fast_write(&dac, i & 0x0fff));
+}
+
+static void op_dac_get_raw_output(uint32_t i)
+{
+    uint16_t value;
+    ESP_ERROR_CHECK(mcp4728_get_raw_output(&dac, false, &value));
+}
+
+static void op_exp_set_pin(uint32_t i)
+{
+    if (i2c_exp_set_pin(i % 5, i & 1))
+        abort();
+}
+
+static void op_exp_port_read(uint32_t i)
+{
+    uint8_t val;
+    ESP_ERROR_CHECK(tca9534_port_read(&exp, &val));
+}
+
+static void op_mixed(uint32_t i)
+{
+    // Devices on the same port with different SCL frequencies
+    op_dac_fast_write(i);
+    op_exp_port_read(i);
+}
+
+static const bench_op_t ops[] = {
+    { "dac_write_channel", op_dac_write_channel },
+    { "4 x dac_write_channel", op_dac_write_4ch },
+    { "mcp4728_fast_write_all", op_dac_fast_write_all },
+    { "multi_write, B and D", op_dac_multi_write },
+    { "mcp4728_fast_write", op_dac_fast_write },
+    { "mcp4728_get_raw_output", op_dac_get_raw_output },
+    { "i2c_exp_set_pin", op_exp_set_pin },
+    { "tca9534_port_read", op_exp_port_read },
+    { "fast_write+port_read", op_mixed },
+};
+
+static void run(const bench_op_t *op, uint32_t iterations)
+{
+    i2c_sim_stats_t stats;
+    i2c_sim_get_stats(PORT, &stats, true);
+
+    int64_t start = esp_timer_get_time();
+    for (uint32_t i = 0; i < iterations; i++)
+        op->op(i);
+    int64_t wall = esp_timer_get_time() - start;
+
+    i2c_sim_get_stats(PORT, &stats, true);
+    printf("%-24s %10.2f %10.2f %8.2f %8.2f %6u\n", op->name,
+           (double)wall / iterations,
+           (double)stats.bus_time_us / iterations,
+           (double)stats.transactions / iterations,
+           (double)stats.bytes / iterations,
+           (unsigned)stats.nacks);
+}
+
+/* Expander gone from the bus: NACKs until the breaker opens, then fail fast */
+static void run_dead_device(uint32_t iterations)
+{
+    uint32_t nacks = 0, rejected = 0;
+    uint8_t val;
+
+    ESP_ERROR_CHECK(i2c_sim_detach(PORT, &sim_exp.model));
+    int64_t start = esp_timer_get_time();
+    for (uint32_t i = 0; i < iterations; i++)
+    {
+        esp_err_t res = tca9534_port_read(&exp, &val);
+        if (res == ESP_FAIL)
+            nacks++;
+        else if (res == ESP_ERR_INVALID_STATE)
+            rejected++;
+    }
+    int64_t wall = esp_timer_get_time() - start;
+    ESP_ERROR_CHECK(i2c_sim_attach(PORT, &sim_exp.model));
+
+    printf("%-24s %10.2f %10s %8s %8s %6u, %u failed fast\n", "port_read, no device",
+           (double)wall / iterations, "", "", "", (unsigned)nacks, (unsigned)rejected);
+}
+
+static esp_err_t trace_write(const void *data, size_t size, void *ctx)
+{
+    return fwrite(data, 1, size, ctx) == size ? ESP_OK : ESP_FAIL;
+}
+
+static void dump_trace(const char *path)
+{
+    size_t len = strlen(path);
+    bool csv = len > 4 && !strcmp(path + len - 4, ".csv");
+    FILE *f = fopen(path, csv ? "w" : "wb");
+    if (!f)
+    {
+        perror(path);
+        return;
+    }
+    ESP_ERROR_CHECK(i2cdev_trace_stop(PORT));
+    ESP_ERROR_CHECK(i2cdev_trace_dump(PORT, csv ? I2CDEV_TRACE_CSV : I2CDEV_TRACE_BINARY, trace_write, f));
+    fclose(f);
+    printf("\nTrace of the last %d transactions written to %s\n", TRACE_RECORDS, path);
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t iterations = argc > 1 ? strtoul(argv[1], NULL, 0) : 10000;
+    if (!iterations)
+        iterations = 1;
+
+    esp_log_level_set("*", ESP_LOG_NONE);
+
+    sim_mcp4728_init(&sim_dac, DAC_ADDR);
+    sim_tca9534_init(&sim_exp, EXP_ADDR);
+    ESP_ERROR_CHECK(i2c_sim_attach(PORT, &sim_dac.model));
+    ESP_ERROR_CHECK(i2c_sim_attach(PORT, &sim_exp.model));
+
+    ESP_ERROR_CHECK(i2cdev_init());
+    init_mcp4728(SDA, SCL);
+    i2c_exp_init(SDA, SCL);
+    ESP_ERROR_CHECK(mcp4728_init_desc(&dac, PORT, DAC_ADDR, SDA, SCL));
+    ESP_ERROR_CHECK(tca9534_init_desc(&exp, PORT, EXP_ADDR, SDA, SCL));
+
+    const char *trace = argc > 2 ? argv[2] : NULL;
+    if (trace)
+        ESP_ERROR_CHECK(i2cdev_trace_start(PORT, TRACE_RECORDS));
+
+    printf("%u iterations per call\n\n", (unsigned)iterations);
+    printf("%-24s %10s %10s %8s %8s %6s\n", "call", "wall, us", "bus, us", "xfers", "bytes", "nacks");
+    for (size_t i = 0; i < sizeof(ops) / sizeof(ops[0]); i++)
+        run(&ops[i], iterations);
+    run_dead_device(iterations);
+
+    printf("\nMCP4728: %u EEPROM writes, %u commands ignored while busy\n",
+           (unsigned)sim_dac.eeprom_writes, (unsigned)sim_dac.ignored);
+    printf("TCA9534: config 0x%02x, output 0x%02x\n", sim_exp.config, sim_exp.output);
+    if (trace)
+        dump_trace(trace);
+
+    tca9534_free_desc(&exp);
+    mcp4728_free_desc(&dac);
+    i2c_exp_deinit();
+    i2cdev_done();
+
+    return 0;
+}
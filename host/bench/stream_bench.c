@@ -0,0 +1,139 @@
+/**
+ * @file stream_bench.c
+ *
+ * MCP4728 sample streaming on the simulated I2C bus
+ *
+ * The bus runs in realtime mode at the driver's 1 MHz, so a sample of all
+ * four channels holds it for about 140 us. A producer task keeps the
+ * blocks of all channels full with sawtooths while the stream runs at
+ * rising sample rates; the achieved rate levels off at what the bus
+ * allows, and the periods the stream task could not keep up with show as
+ * missed. The next run feeds the stream at half its rate and shows
+ * underruns. The last one holds LDAC high, as a bank does, and fails the
+ * bench unless the outputs still follow the stream.
+ *
+ * Usage: i2c_stream_bench [duration, ms]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <esp_log.h>
+#include <i2cdev.h>
+#include <i2c_sim.h>
+#include <sim_mcp4728.h>
+#include <mcp4728.h>
+#include <mcp4728_stream.h>
+
+#define PORT 0
+#define SDA 21
+#define SCL 22
+#define DAC_ADDR MCP4728A0_I2C_ADDR0
+#define BLOCK_LEN 256
+#define CHUNK 64
+#define PRODUCER_PRIORITY 5
+
+static sim_mcp4728_t sim_dac;
+static i2c_dev_t dac;
+static mcp4728_stream_t stream;
+
+typedef struct
+{
+    uint32_t rate_hz;       // Samples per second per channel, 0 to keep blocks full
+    volatile bool stopping;
+    TaskHandle_t stopper;
+} producer_t;
+
+static void producer_task(void *arg)
+{
+    producer_t *p = arg;
+    uint16_t chunk[CHUNK];
+    uint16_t phase[MCP4728_NUM_CH] = { 0, 1024, 2048, 3072 };
+    TickType_t wake = xTaskGetTickCount();
+    TickType_t period = p->rate_hz ? pdMS_TO_TICKS(1000 * CHUNK / p->rate_hz) : 0;
+
+    while (!p->stopping)
+    {
+        for (uint8_t ch = 0; ch < MCP4728_NUM_CH && !p->stopping; ch++)
+        {
+            for (size_t i = 0; i < CHUNK; i++)
+                chunk[i] = (phase[ch] += 16) & 0x0fff;
+            mcp4728_stream_write(&stream, ch, chunk, CHUNK, NULL, pdMS_TO_TICKS(1000));
+        }
+        if (period)
+            vTaskDelayUntil(&wake, period);
+    }
+
+    xTaskNotifyGive(p->stopper);
+    vTaskDelete(NULL);
+}
+
+static void run(uint32_t rate_hz, uint32_t feed_hz, uint32_t ms)
+{
+    mcp4728_stream_config_t cfg = { .rate_hz = rate_hz, .channels = MCP4728_CH_ALL, .block_len = BLOCK_LEN };
+    producer_t producer = { .rate_hz = feed_hz, .stopper = xTaskGetCurrentTaskHandle() };
+    mcp4728_stream_stats_t st;
+
+    ESP_ERROR_CHECK(mcp4728_stream_init(&stream, &dac, &cfg));
+    xTaskCreate(producer_task, "producer", 4096, &producer, PRODUCER_PRIORITY, NULL);
+    // Let the producer fill the blocks before the first sample
+    vTaskDelay(pdMS_TO_TICKS(20));
+
+    ESP_ERROR_CHECK(mcp4728_stream_start(&stream));
+    vTaskDelay(pdMS_TO_TICKS(ms));
+    mcp4728_stream_get_stats(&stream, &st, false);
+
+    producer.stopping = true;
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    ESP_ERROR_CHECK(mcp4728_stream_free(&stream));
+
+    char feed[16] = "full";
+    if (feed_hz)
+        snprintf(feed, sizeof(feed), "%u Hz", (unsigned)feed_hz);
+    printf("%8u %8s %10u %8u %10u %10u %8u\n", (unsigned)rate_hz, feed, (unsigned)st.achieved_hz,
+           (unsigned)st.missed, (unsigned)st.underruns, (unsigned)st.overruns, (unsigned)st.errors);
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t ms = argc > 1 ? strtoul(argv[1], NULL, 0) : 1000;
+    if (!ms)
+        ms = 1;
+
+    esp_log_level_set("*", ESP_LOG_NONE);
+
+    sim_mcp4728_init(&sim_dac, DAC_ADDR);
+    ESP_ERROR_CHECK(i2c_sim_attach(PORT, &sim_dac.model));
+    i2c_sim_timing_t timing = { .overhead_us = 20, .byte_bits = 9, .cond_bits = 1, .realtime = true };
+    i2c_sim_set_timing(&timing);
+
+    ESP_ERROR_CHECK(i2cdev_init());
+    ESP_ERROR_CHECK(mcp4728_init_desc(&dac, PORT, DAC_ADDR, SDA, SCL));
+
+    printf("4 channels, %u ms per run, blocks of %d samples\n\n", (unsigned)ms, BLOCK_LEN);
+    printf("%8s %8s %10s %8s %10s %10s %8s\n", "rate, Hz", "feed", "achieved", "missed", "underruns",
+           "overruns", "errors");
+    static const uint32_t rates[] = { 1000, 2000, 5000, 10000, 20000 };
+    for (size_t i = 0; i < sizeof(rates) / sizeof(rates[0]); i++)
+        run(rates[i], 0, ms);
+    run(2000, 1000, ms);
+
+    int64_t latched[MCP4728_NUM_CH];
+    memcpy(latched, sim_dac.latched_at, sizeof(latched));
+    sim_mcp4728_set_ldac(&sim_dac, true);
+    printf("\nLDAC high\n");
+    run(2000, 0, ms);
+    bool follow = true;
+    for (uint8_t ch = 0; ch < MCP4728_NUM_CH; ch++)
+        follow = follow && sim_dac.latched_at[ch] > latched[ch]
+            && sim_dac.output[ch].value == sim_dac.input[ch].value;
+    printf("outputs %s\n", follow ? "follow the stream" : "HELD");
+
+    printf("\nMCP4728 channel A output 0x%03x\n", sim_dac.output[0].value);
+
+    mcp4728_free_desc(&dac);
+    i2cdev_done();
+
+    return follow ? 0 : 1;
+}
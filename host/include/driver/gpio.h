@@ -0,0 +1,11 @@
+/*
+ * Host build: GPIO types used by driver descriptors
+ */
+#pragma once
+
+typedef int gpio_num_t;
+
+typedef enum {
+    GPIO_PULLUP_DISABLE = 0,
+    GPIO_PULLUP_ENABLE = 1,
+} gpio_pullup_t;
@@ -0,0 +1,33 @@
+/*
+ * Host build: FreeRTOS semaphores, built on the queue shim
+ */
+#pragma once
+
+#include <freertos/queue.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef QueueHandle_t SemaphoreHandle_t;
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void);
+SemaphoreHandle_t xSemaphoreCreateMutexStatic(StaticSemaphore_t *buffer);
+SemaphoreHandle_t xSemaphoreCreateBinary(void);
+SemaphoreHandle_t xSemaphoreCreateBinaryStatic(StaticSemaphore_t *buffer);
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t max, UBaseType_t initial);
+SemaphoreHandle_t xSemaphoreCreateCountingStatic(UBaseType_t max, UBaseType_t initial, StaticSemaphore_t *buffer);
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks);
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem);
+UBaseType_t uxSemaphoreGetCount(SemaphoreHandle_t sem);
+
+/* Host build only: takes and gives since start, for benchmarks */
+uint32_t host_semaphore_ops(void);
+
+#define vSemaphoreDelete(sem) vQueueDelete(sem)
+#define xSemaphoreGiveFromISR(sem, woken) xSemaphoreGive(sem)
+#define xSemaphoreTakeFromISR(sem, woken) xSemaphoreTake(sem, 0)
+
+#ifdef __cplusplus
+}
+#endif
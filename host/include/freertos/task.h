@@ -0,0 +1,60 @@
+/*
+ * Host build: FreeRTOS tasks and task notifications
+ */
+#pragma once
+
+#include <freertos/FreeRTOS.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct host_task_s *TaskHandle_t;
+typedef void (*TaskFunction_t)(void *);
+
+typedef enum {
+    eNoAction = 0,
+    eSetBits,
+    eIncrement,
+    eSetValueWithOverwrite,
+    eSetValueWithoutOverwrite,
+} eNotifyAction;
+
+typedef struct {
+    TickType_t xTimeOnEntering;
+} TimeOut_t;
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char *name, uint32_t stack, void *arg,
+        UBaseType_t priority, TaskHandle_t *created, BaseType_t core);
+TaskHandle_t xTaskCreateStaticPinnedToCore(TaskFunction_t fn, const char *name, uint32_t stack, void *arg,
+        UBaseType_t priority, StackType_t *stack_buffer, StaticTask_t *task_buffer, BaseType_t core);
+void vTaskDelete(TaskHandle_t task);
+void vTaskDelay(TickType_t ticks);
+BaseType_t xTaskDelayUntil(TickType_t *previous, TickType_t period);
+TickType_t xTaskGetTickCount(void);
+TaskHandle_t xTaskGetCurrentTaskHandle(void);
+UBaseType_t uxTaskPriorityGet(TaskHandle_t task);
+void vTaskPrioritySet(TaskHandle_t task, UBaseType_t priority);
+const char *pcTaskGetName(TaskHandle_t task);
+void vTaskSuspendAll(void);
+BaseType_t xTaskResumeAll(void);
+void vTaskSetTimeOutState(TimeOut_t *timeout);
+BaseType_t xTaskCheckForTimeOut(TimeOut_t *timeout, TickType_t *remaining);
+
+BaseType_t xTaskNotify(TaskHandle_t task, uint32_t value, eNotifyAction action);
+BaseType_t xTaskNotifyWait(uint32_t clear_on_entry, uint32_t clear_on_exit, uint32_t *value, TickType_t ticks);
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t ticks);
+
+#define xTaskCreate(fn, name, stack, arg, priority, created) \
+    xTaskCreatePinnedToCore(fn, name, stack, arg, priority, created, tskNO_AFFINITY)
+#define xTaskCreateStatic(fn, name, stack, arg, priority, stack_buffer, task_buffer) \
+    xTaskCreateStaticPinnedToCore(fn, name, stack, arg, priority, stack_buffer, task_buffer, tskNO_AFFINITY)
+#define vTaskDelayUntil(previous, period) ((void)xTaskDelayUntil(previous, period))
+#define xTaskNotifyGive(task) xTaskNotify(task, 0, eIncrement)
+#define vTaskNotifyGiveFromISR(task, woken) ((void)xTaskNotify(task, 0, eIncrement))
+#define xTaskNotifyFromISR(task, value, action, woken) xTaskNotify(task, value, action)
+#define taskYIELD() vTaskDelay(0)
+
+#ifdef __cplusplus
+}
+#endif
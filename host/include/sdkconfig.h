@@ -0,0 +1,92 @@
+/*
+ * Host build configuration
+ *
+ * Stands in for the sdkconfig.h generated by ESP-IDF. Values may be
+ * overridden with compile definitions, see host/CMakeLists.txt.
+ */
+#pragma once
+
+#define CONFIG_IDF_TARGET_ESP32 1
+#define CONFIG_IDF_TARGET_LINUX 1
+#define CONFIG_FREERTOS_HZ 1000
+#define CONFIG_LOG_DEFAULT_LEVEL 3
+
+#ifndef CONFIG_I2CDEV_TIMEOUT
+#define CONFIG_I2CDEV_TIMEOUT 1000
+#endif
+#ifndef CONFIG_I2CDEV_MAX_BUSES
+#define CONFIG_I2CDEV_MAX_BUSES 4
+#endif
+#ifndef CONFIG_I2CDEV_CMD_LINK_TRANSACTIONS
+#define CONFIG_I2CDEV_CMD_LINK_TRANSACTIONS 4
+#endif
+#if CONFIG_I2CDEV_ASYNC
+#ifndef CONFIG_I2CDEV_ASYNC_QUEUE_LEN
+#define CONFIG_I2CDEV_ASYNC_QUEUE_LEN 8
+#endif
+#ifndef CONFIG_I2CDEV_ASYNC_TASK_PRIORITY
+#define CONFIG_I2CDEV_ASYNC_TASK_PRIORITY 10
+#endif
+#ifndef CONFIG_I2CDEV_ASYNC_TASK_STACK
+#define CONFIG_I2CDEV_ASYNC_TASK_STACK 4096
+#endif
+#endif
+#if CONFIG_I2CDEV_TRACE
+#ifndef CONFIG_I2CDEV_TRACE_PAYLOAD
+#define CONFIG_I2CDEV_TRACE_PAYLOAD 8
+#endif
+#endif
+#ifndef CONFIG_I2CDEV_POLL_TASK_PRIORITY
+#define CONFIG_I2CDEV_POLL_TASK_PRIORITY 12
+#endif
+#ifndef CONFIG_I2CDEV_POLL_TASK_STACK
+#define CONFIG_I2CDEV_POLL_TASK_STACK 4096
+#endif
+#if CONFIG_I2CDEV_BREAKER
+#ifndef CONFIG_I2CDEV_BREAKER_THRESHOLD
+#define CONFIG_I2CDEV_BREAKER_THRESHOLD 3
+#endif
+#ifndef CONFIG_I2CDEV_BREAKER_BACKOFF_MS
+#define CONFIG_I2CDEV_BREAKER_BACKOFF_MS 500
+#endif
+#ifndef CONFIG_I2CDEV_BREAKER_BACKOFF_MAX_MS
+#define CONFIG_I2CDEV_BREAKER_BACKOFF_MAX_MS 10000
+#endif
+#endif
+
+#ifndef CONFIG_MCP4728_VDD
+#define CONFIG_MCP4728_VDD 3300
+#endif
+#ifndef CONFIG_MCP4728_OUTMAX
+#define CONFIG_MCP4728_OUTMAX 3000
+#endif
+#ifndef CONFIG_MCP4728_STREAM_TASK_PRIORITY
+#define CONFIG_MCP4728_STREAM_TASK_PRIORITY 20
+#endif
+#ifndef CONFIG_MCP4728_STREAM_TASK_STACK
+#define CONFIG_MCP4728_STREAM_TASK_STACK 4096
+#endif
+#ifndef CONFIG_MCP4728_MAILBOX_PERIOD_MS
+#define CONFIG_MCP4728_MAILBOX_PERIOD_MS 10
+#endif
+#ifndef CONFIG_MCP4728_MAILBOX_TASK_PRIORITY
+#define CONFIG_MCP4728_MAILBOX_TASK_PRIORITY 5
+#endif
+#ifndef CONFIG_MCP4728_MAILBOX_TASK_STACK
+#define CONFIG_MCP4728_MAILBOX_TASK_STACK 4096
+#endif
+#ifndef CONFIG_MCP4728_RAMP_PERIOD_MS
+#define CONFIG_MCP4728_RAMP_PERIOD_MS 10
+#endif
+#ifndef CONFIG_MCP4728_RAMP_TASK_PRIORITY
+#define CONFIG_MCP4728_RAMP_TASK_PRIORITY 5
+#endif
+#ifndef CONFIG_MCP4728_RAMP_TASK_STACK
+#define CONFIG_MCP4728_RAMP_TASK_STACK 4096
+#endif
+#ifndef CONFIG_MCP4728_MAX_DEVICES
+#define CONFIG_MCP4728_MAX_DEVICES 8
+#endif
+#ifndef CONFIG_MCP4728_EEPROM_POLL_MS
+#define CONFIG_MCP4728_EEPROM_POLL_MS 5
+#endif
@@ -0,0 +1,6 @@
+/*
+ * Host build: ESP32 I2C register limits
+ */
+#pragma once
+
+#define I2C_TIME_OUT_REG_V 0xFFFFF
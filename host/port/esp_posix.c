@@ -0,0 +1,235 @@
+/**
+ * @file esp_posix.c
+ *
+ * ESP-IDF system API subset for the host build: timers, log and errors
+ */
+#include <esp_err.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+struct host_timer_s
+{
+    esp_timer_create_args_t args;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    struct timespec next;   // Deadline while armed
+    uint64_t period;        // 0 for one-shot
+    bool armed;
+    bool in_callback;
+    bool deleted;
+};
+
+static esp_log_level_t log_level = CONFIG_LOG_DEFAULT_LEVEL;
+
+int64_t esp_timer_get_time(void)
+{
+    static int64_t start;
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    int64_t now = (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+    // Benign race: every thread stores the same first reading or later
+    if (!start)
+        start = now - 1;
+    return now - start;
+}
+
+static void timespec_add_us(struct timespec *ts, uint64_t us)
+{
+    uint64_t ns = ts->tv_nsec + us * 1000;
+    ts->tv_sec += ns / 1000000000;
+    ts->tv_nsec = ns % 1000000000;
+}
+
+static bool timespec_reached(const struct timespec *ts)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec > ts->tv_sec || (now.tv_sec == ts->tv_sec && now.tv_nsec >= ts->tv_nsec);
+}
+
+static void *timer_thread(void *arg)
+{
+    esp_timer_handle_t timer = arg;
+
+    pthread_mutex_lock(&timer->lock);
+    while (!timer->deleted)
+    {
+        if (!timer->armed)
+        {
+            pthread_cond_wait(&timer->cond, &timer->lock);
+            continue;
+        }
+        // Wakes are starts, stops or spurious: check the deadline again
+        pthread_cond_timedwait(&timer->cond, &timer->lock, &timer->next);
+        if (!timer->armed || timer->deleted || !timespec_reached(&timer->next))
+            continue;
+        // Periodic deadlines are absolute, one-shot timers can be started again from the callback
+        if (timer->period)
+            timespec_add_us(&timer->next, timer->period);
+        else
+            timer->armed = false;
+        timer->in_callback = true;
+        pthread_mutex_unlock(&timer->lock);
+        timer->args.callback(timer->args.arg);
+        pthread_mutex_lock(&timer->lock);
+        timer->in_callback = false;
+        pthread_cond_broadcast(&timer->cond);
+    }
+    pthread_mutex_unlock(&timer->lock);
+
+    return NULL;
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *args, esp_timer_handle_t *out_handle)
+{
+    if (!args || !args->callback || !out_handle)
+        return ESP_ERR_INVALID_ARG;
+    esp_timer_handle_t timer = calloc(1, sizeof(struct host_timer_s));
+    if (!timer)
+        return ESP_ERR_NO_MEM;
+
+    timer->args = *args;
+    pthread_mutex_init(&timer->lock, NULL);
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&timer->cond, &attr);
+    pthread_condattr_destroy(&attr);
+    if (pthread_create(&timer->thread, NULL, timer_thread, timer))
+    {
+        pthread_cond_destroy(&timer->cond);
+        pthread_mutex_destroy(&timer->lock);
+        free(timer);
+        return ESP_ERR_NO_MEM;
+    }
+    *out_handle = timer;
+
+    return ESP_OK;
+}
+
+static esp_err_t timer_start(esp_timer_handle_t timer, uint64_t timeout, uint64_t period)
+{
+    if (!timer)
+        return ESP_ERR_INVALID_ARG;
+
+    esp_err_t res = ESP_OK;
+    pthread_mutex_lock(&timer->lock);
+    if (timer->armed)
+        res = ESP_ERR_INVALID_STATE;
+    else
+    {
+        clock_gettime(CLOCK_MONOTONIC, &timer->next);
+        timespec_add_us(&timer->next, timeout);
+        timer->period = period;
+        timer->armed = true;
+        pthread_cond_broadcast(&timer->cond);
+    }
+    pthread_mutex_unlock(&timer->lock);
+
+    return res;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us)
+{
+    return timer_start(timer, timeout_us, 0);
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period)
+{
+    if (!period)
+        return ESP_ERR_INVALID_ARG;
+    return timer_start(timer, period, period);
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer)
+{
+    if (!timer)
+        return ESP_ERR_INVALID_ARG;
+
+    pthread_mutex_lock(&timer->lock);
+    bool armed = timer->armed;
+    timer->armed = false;
+    pthread_cond_broadcast(&timer->cond);
+    // A callback in progress finishes first, unless it is the caller
+    while (timer->in_callback && !pthread_equal(pthread_self(), timer->thread))
+        pthread_cond_wait(&timer->cond, &timer->lock);
+    pthread_mutex_unlock(&timer->lock);
+
+    return armed ? ESP_OK : ESP_ERR_INVALID_STATE;
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t timer)
+{
+    if (!timer)
+        return ESP_ERR_INVALID_ARG;
+
+    pthread_mutex_lock(&timer->lock);
+    bool armed = timer->armed;
+    if (!armed)
+    {
+        timer->deleted = true;
+        pthread_cond_broadcast(&timer->cond);
+    }
+    pthread_mutex_unlock(&timer->lock);
+    if (armed)
+        return ESP_ERR_INVALID_STATE;
+
+    pthread_join(timer->thread, NULL);
+    pthread_cond_destroy(&timer->cond);
+    pthread_mutex_destroy(&timer->lock);
+    free(timer);
+
+    return ESP_OK;
+}
+
+void esp_log_level_set(const char *tag, esp_log_level_t level)
+{
+    (void)tag;
+    log_level = level;
+}
+
+void esp_log_write(esp_log_level_t level, const char *tag, const char *format, ...)
+{
+    static const char letters[] = "NEWIDV";
+    if (level > log_level)
+        return;
+    va_list args;
+    va_start(args, format);
+    fprintf(stderr, "%c (%lld) %s: ", letters[level], (long long)(esp_timer_get_time() / 1000), tag);
+    vfprintf(stderr, format, args);
+    fputc('\n', stderr);
+    va_end(args);
+}
+
+const char *esp_err_to_name(esp_err_t code)
+{
+    switch (code)
+    {
+        case ESP_OK: return "ESP_OK";
+        case ESP_FAIL: return "ESP_FAIL";
+        case ESP_ERR_NO_MEM: return "ESP_ERR_NO_MEM";
+        case ESP_ERR_INVALID_ARG: return "ESP_ERR_INVALID_ARG";
+        case ESP_ERR_INVALID_STATE: return "ESP_ERR_INVALID_STATE";
+        case ESP_ERR_INVALID_SIZE: return "ESP_ERR_INVALID_SIZE";
+        case ESP_ERR_NOT_FOUND: return "ESP_ERR_NOT_FOUND";
+        case ESP_ERR_NOT_SUPPORTED: return "ESP_ERR_NOT_SUPPORTED";
+        case ESP_ERR_TIMEOUT: return "ESP_ERR_TIMEOUT";
+        case ESP_ERR_INVALID_RESPONSE: return "ESP_ERR_INVALID_RESPONSE";
+        case ESP_ERR_INVALID_CRC: return "ESP_ERR_INVALID_CRC";
+        default: return "UNKNOWN ERROR";
+    }
+}
+
+void _esp_error_check_failed(esp_err_t rc, const char *file, int line, const char *function, const char *expression)
+{
+    fprintf(stderr, "ESP_ERROR_CHECK failed: esp_err_t 0x%x (%s) at %s:%d\nfunction: %s\nexpression: %s\n",
+            rc, esp_err_to_name(rc), file, line, function, expression);
+    abort();
+}
@@ -0,0 +1,602 @@
+/**
+ * @file freertos_posix.c
+ *
+ * FreeRTOS API subset on POSIX threads for the host build
+ *
+ * Every task is a detached pthread. Queues and semaphores share one
+ * implementation: a semaphore is a queue with zero sized items. Scheduler
+ * suspension and critical sections take one process wide recursive mutex,
+ * which is enough for the short sections the components guard with them.
+ */
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <esp_timer.h>
+
+struct host_task_s
+{
+    pthread_t thread;
+    TaskFunction_t fn;
+    void *arg;
+    UBaseType_t priority;
+    char name[16];
+    bool allocated;
+
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    uint32_t notify_value;
+    bool notify_pending;
+};
+
+struct host_queue_s
+{
+    pthread_mutex_t lock;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+    uint8_t *storage;
+    size_t item_size;
+    size_t length;
+    size_t head;
+    size_t count;
+    bool allocated;
+    bool storage_allocated;
+};
+
+_Static_assert(sizeof(struct host_queue_s) <= sizeof(StaticQueue_t), "StaticQueue_t too small");
+_Static_assert(sizeof(struct host_task_s) <= sizeof(StaticTask_t), "StaticTask_t too small");
+
+static pthread_mutex_t suspend_lock;
+static pthread_once_t suspend_once = PTHREAD_ONCE_INIT;
+static pthread_key_t task_key;
+static pthread_once_t task_key_once = PTHREAD_ONCE_INIT;
+
+static void suspend_lock_init(void)
+{
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&suspend_lock, &attr);
+    pthread_mutexattr_destroy(&attr);
+}
+
+static void cond_init(pthread_cond_t *cond)
+{
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(cond, &attr);
+    pthread_condattr_destroy(&attr);
+}
+
+static void task_key_free(void *task)
+{
+    struct host_task_s *t = task;
+    if (t && t->allocated && !t->fn)
+        free(t);
+}
+
+static void task_key_init(void)
+{
+    pthread_key_create(&task_key, task_key_free);
+}
+
+static void task_init(struct host_task_s *task, TaskFunction_t fn, const char *name, void *arg, UBaseType_t priority)
+{
+    memset(task, 0, sizeof(*task));
+    task->fn = fn;
+    task->arg = arg;
+    task->priority = priority;
+    strncpy(task->name, name ? name : "", sizeof(task->name) - 1);
+    pthread_mutex_init(&task->lock, NULL);
+    cond_init(&task->cond);
+}
+
+static struct host_task_s *current_task(void)
+{
+    pthread_once(&task_key_once, task_key_init);
+    struct host_task_s *task = pthread_getspecific(task_key);
+    if (task)
+        return task;
+
+    // Thread not created through xTaskCreate(), e.g. main()
+    task = malloc(sizeof(*task));
+    if (!task)
+        abort();
+    task_init(task, NULL, "main", NULL, 1);
+    task->allocated = true;
+    task->thread = pthread_self();
+    pthread_setspecific(task_key, task);
+    return task;
+}
+
+/* Absolute CLOCK_MONOTONIC deadline for a timeout in ticks */
+static struct timespec deadline(TickType_t ticks)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    uint64_t ns = (uint64_t)ticks * (1000000000ULL / configTICK_RATE_HZ);
+    ts.tv_sec += ns / 1000000000ULL;
+    ts.tv_nsec += ns % 1000000000ULL;
+    if (ts.tv_nsec >= 1000000000L)
+    {
+        ts.tv_sec++;
+        ts.tv_nsec -= 1000000000L;
+    }
+    return ts;
+}
+
+/* Wait on cond until pred holds; false on timeout. Lock must be held */
+#define WAIT_UNTIL(pred, cond, lock, ticks) ({ \
+        bool __ok = true; \
+        if (!(pred)) \
+        { \
+            if ((ticks) == 0) \
+                __ok = false; \
+            else if ((ticks) == portMAX_DELAY) \
+                while (!(pred)) pthread_cond_wait(cond, lock); \
+            else \
+            { \
+                struct timespec __ts = deadline(ticks); \
+                while (!(pred)) \
+                    if (pthread_cond_timedwait(cond, lock, &__ts) == ETIMEDOUT) \
+                    { \
+                        __ok = (pred); \
+                        break; \
+                    } \
+            } \
+        } \
+        __ok; \
+    })
+
+///////////////////////////////////////////////////////////////////////////////
+// Critical sections
+
+void vPortEnterCritical(portMUX_TYPE *mux)
+{
+    (void)mux;
+    pthread_once(&suspend_once, suspend_lock_init);
+    pthread_mutex_lock(&suspend_lock);
+}
+
+void vPortExitCritical(portMUX_TYPE *mux)
+{
+    (void)mux;
+    pthread_mutex_unlock(&suspend_lock);
+}
+
+void vTaskSuspendAll(void)
+{
+    vPortEnterCritical(NULL);
+}
+
+BaseType_t xTaskResumeAll(void)
+{
+    vPortExitCritical(NULL);
+    return pdFALSE;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Tasks
+
+static void *task_entry(void *arg)
+{
+    struct host_task_s *task = arg;
+    pthread_once(&task_key_once, task_key_init);
+    pthread_setspecific(task_key, task);
+    task->fn(task->arg);
+    return NULL;
+}
+
+static BaseType_t task_start(struct host_task_s *task)
+{
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    int res = pthread_create(&task->thread, &attr, task_entry, task);
+    pthread_attr_destroy(&attr);
+    return res == 0 ? pdPASS : pdFAIL;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char *name, uint32_t stack, void *arg,
+        UBaseType_t priority, TaskHandle_t *created, BaseType_t core)
+{
+    (void)stack;
+    (void)core;
+    struct host_task_s *task = malloc(sizeof(*task));
+    if (!task)
+        return pdFAIL;
+    task_init(task, fn, name, arg, priority);
+    task->allocated = true;
+    // Publish the handle before the task can run
+    if (created)
+        *created = task;
+    if (task_start(task) != pdPASS)
+    {
+        if (created)
+            *created = NULL;
+        free(task);
+        return pdFAIL;
+    }
+    return pdPASS;
+}
+
+TaskHandle_t xTaskCreateStaticPinnedToCore(TaskFunction_t fn, const char *name, uint32_t stack, void *arg,
+        UBaseType_t priority, StackType_t *stack_buffer, StaticTask_t *task_buffer, BaseType_t core)
+{
+    (void)stack;
+    (void)stack_buffer;
+    (void)core;
+    if (!task_buffer)
+        return NULL;
+    struct host_task_s *task = (struct host_task_s *)task_buffer;
+    task_init(task, fn, name, arg, priority);
+    return task_start(task) == pdPASS ? task : NULL;
+}
+
+void vTaskDelete(TaskHandle_t task)
+{
+    if (!task || task == current_task())
+        pthread_exit(NULL);
+    pthread_cancel(task->thread);
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    if (!ticks)
+    {
+        sched_yield();
+        return;
+    }
+    struct timespec ts = deadline(ticks);
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+        ;
+}
+
+TickType_t xTaskGetTickCount(void)
+{
+    return (TickType_t)(esp_timer_get_time() / (1000000 / configTICK_RATE_HZ));
+}
+
+BaseType_t xTaskDelayUntil(TickType_t *previous, TickType_t period)
+{
+    TickType_t wake = *previous + period;
+    *previous = wake;
+    // Sleep to the tick boundary, not a tick from now
+    int64_t due = (int64_t)wake * (1000000 / configTICK_RATE_HZ) - esp_timer_get_time();
+    if (due <= 0)
+        return pdFALSE;
+    struct timespec ts = { .tv_sec = due / 1000000, .tv_nsec = due % 1000000 * 1000 };
+    while (nanosleep(&ts, &ts) == EINTR)
+        ;
+    return pdTRUE;
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+    return current_task();
+}
+
+UBaseType_t uxTaskPriorityGet(TaskHandle_t task)
+{
+    return (task ? task : current_task())->priority;
+}
+
+void vTaskPrioritySet(TaskHandle_t task, UBaseType_t priority)
+{
+    (task ? task : current_task())->priority = priority;
+}
+
+const char *pcTaskGetName(TaskHandle_t task)
+{
+    return (task ? task : current_task())->name;
+}
+
+void vTaskSetTimeOutState(TimeOut_t *timeout)
+{
+    timeout->xTimeOnEntering = xTaskGetTickCount();
+}
+
+BaseType_t xTaskCheckForTimeOut(TimeOut_t *timeout, TickType_t *remaining)
+{
+    if (*remaining == portMAX_DELAY)
+        return pdFALSE;
+    TickType_t now = xTaskGetTickCount();
+    TickType_t elapsed = now - timeout->xTimeOnEntering;
+    if (elapsed >= *remaining)
+    {
+        *remaining = 0;
+        return pdTRUE;
+    }
+    *remaining -= elapsed;
+    timeout->xTimeOnEntering = now;
+    return pdFALSE;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Task notifications
+
+BaseType_t xTaskNotify(TaskHandle_t task, uint32_t value, eNotifyAction action)
+{
+    BaseType_t res = pdPASS;
+    pthread_mutex_lock(&task->lock);
+    switch (action)
+    {
+        case eSetBits:
+            task->notify_value |= value;
+            break;
+        case eIncrement:
+            task->notify_value++;
+            break;
+        case eSetValueWithOverwrite:
+            task->notify_value = value;
+            break;
+        case eSetValueWithoutOverwrite:
+            if (task->notify_pending)
+                res = pdFAIL;
+            else
+                task->notify_value = value;
+            break;
+        default:
+            break;
+    }
+    task->notify_pending = true;
+    pthread_cond_broadcast(&task->cond);
+    pthread_mutex_unlock(&task->lock);
+    return res;
+}
+
+BaseType_t xTaskNotifyWait(uint32_t clear_on_entry, uint32_t clear_on_exit, uint32_t *value, TickType_t ticks)
+{
+    struct host_task_s *task = current_task();
+    pthread_mutex_lock(&task->lock);
+    if (!task->notify_pending)
+        task->notify_value &= ~clear_on_entry;
+    bool ok = WAIT_UNTIL(task->notify_pending, &task->cond, &task->lock, ticks);
+    if (value)
+        *value = task->notify_value;
+    if (ok)
+    {
+        task->notify_value &= ~clear_on_exit;
+        task->notify_pending = false;
+    }
+    pthread_mutex_unlock(&task->lock);
+    return ok ? pdTRUE : pdFALSE;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t ticks)
+{
+    struct host_task_s *task = current_task();
+    pthread_mutex_lock(&task->lock);
+    WAIT_UNTIL(task->notify_value != 0, &task->cond, &task->lock, ticks);
+    uint32_t value = task->notify_value;
+    if (value)
+        task->notify_value = clear ? 0 : value - 1;
+    task->notify_pending = false;
+    pthread_mutex_unlock(&task->lock);
+    return value;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Queues
+
+static void queue_init(struct host_queue_s *queue, size_t length, size_t item_size, uint8_t *storage)
+{
+    memset(queue, 0, sizeof(*queue));
+    pthread_mutex_init(&queue->lock, NULL);
+    cond_init(&queue->not_empty);
+    cond_init(&queue->not_full);
+    queue->length = length;
+    queue->item_size = item_size;
+    queue->storage = storage;
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size)
+{
+    if (!length)
+        return NULL;
+    struct host_queue_s *queue = malloc(sizeof(*queue));
+    uint8_t *storage = item_size ? malloc((size_t)length * item_size) : NULL;
+    if (!queue || (item_size && !storage))
+    {
+        free(queue);
+        free(storage);
+        return NULL;
+    }
+    queue_init(queue, length, item_size, storage);
+    queue->allocated = true;
+    queue->storage_allocated = storage != NULL;
+    return queue;
+}
+
+QueueHandle_t xQueueCreateStatic(UBaseType_t length, UBaseType_t item_size, uint8_t *storage, StaticQueue_t *buffer)
+{
+    if (!length || !buffer || (item_size && !storage))
+        return NULL;
+    struct host_queue_s *queue = (struct host_queue_s *)buffer;
+    queue_init(queue, length, item_size, storage);
+    return queue;
+}
+
+static BaseType_t queue_send(QueueHandle_t queue, const void *item, TickType_t ticks, bool front, bool overwrite)
+{
+    pthread_mutex_lock(&queue->lock);
+    if (overwrite && queue->count == queue->length)
+    {
+        // Length 1 queues only, like FreeRTOS
+        queue->count = 0;
+    }
+    if (!WAIT_UNTIL(queue->count < queue->length, &queue->not_full, &queue->lock, ticks))
+    {
+        pthread_mutex_unlock(&queue->lock);
+        return pdFAIL;
+    }
+    if (queue->item_size && item)
+    {
+        size_t slot;
+        if (front)
+        {
+            queue->head = (queue->head + queue->length - 1) % queue->length;
+            slot = queue->head;
+        }
+        else
+            slot = (queue->head + queue->count) % queue->length;
+        memcpy(queue->storage + slot * queue->item_size, item, queue->item_size);
+    }
+    queue->count++;
+    pthread_cond_signal(&queue->not_empty);
+    pthread_mutex_unlock(&queue->lock);
+    return pdPASS;
+}
+
+static BaseType_t queue_receive(QueueHandle_t queue, void *item, TickType_t ticks, bool peek)
+{
+    pthread_mutex_lock(&queue->lock);
+    if (!WAIT_UNTIL(queue->count > 0, &queue->not_empty, &queue->lock, ticks))
+    {
+        pthread_mutex_unlock(&queue->lock);
+        return pdFAIL;
+    }
+    if (queue->item_size && item)
+        memcpy(item, queue->storage + queue->head * queue->item_size, queue->item_size);
+    if (!peek)
+    {
+        queue->head = (queue->head + 1) % queue->length;
+        queue->count--;
+        pthread_cond_signal(&queue->not_full);
+    }
+    pthread_mutex_unlock(&queue->lock);
+    return pdPASS;
+}
+
+BaseType_t xQueueSendToBack(QueueHandle_t queue, const void *item, TickType_t ticks)
+{
+    return queue_send(queue, item, ticks, false, false);
+}
+
+BaseType_t xQueueSendToFront(QueueHandle_t queue, const void *item, TickType_t ticks)
+{
+    return queue_send(queue, item, ticks, true, false);
+}
+
+BaseType_t xQueueOverwrite(QueueHandle_t queue, const void *item)
+{
+    return queue_send(queue, item, 0, false, true);
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t ticks)
+{
+    return queue_receive(queue, item, ticks, false);
+}
+
+BaseType_t xQueuePeek(QueueHandle_t queue, void *item, TickType_t ticks)
+{
+    return queue_receive(queue, item, ticks, true);
+}
+
+BaseType_t xQueueReset(QueueHandle_t queue)
+{
+    pthread_mutex_lock(&queue->lock);
+    queue->head = 0;
+    queue->count = 0;
+    pthread_cond_broadcast(&queue->not_full);
+    pthread_mutex_unlock(&queue->lock);
+    return pdPASS;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue)
+{
+    pthread_mutex_lock(&queue->lock);
+    UBaseType_t count = queue->count;
+    pthread_mutex_unlock(&queue->lock);
+    return count;
+}
+
+UBaseType_t uxQueueSpacesAvailable(QueueHandle_t queue)
+{
+    pthread_mutex_lock(&queue->lock);
+    UBaseType_t spaces = queue->length - queue->count;
+    pthread_mutex_unlock(&queue->lock);
+    return spaces;
+}
+
+void vQueueDelete(QueueHandle_t queue)
+{
+    if (!queue)
+        return;
+    pthread_cond_destroy(&queue->not_empty);
+    pthread_cond_destroy(&queue->not_full);
+    pthread_mutex_destroy(&queue->lock);
+    if (queue->storage_allocated)
+        free(queue->storage);
+    if (queue->allocated)
+        free(queue);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Semaphores
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t max, UBaseType_t initial)
+{
+    SemaphoreHandle_t sem = xQueueCreate(max, 0);
+    if (sem)
+        sem->count = initial;
+    return sem;
+}
+
+SemaphoreHandle_t xSemaphoreCreateCountingStatic(UBaseType_t max, UBaseType_t initial, StaticSemaphore_t *buffer)
+{
+    SemaphoreHandle_t sem = xQueueCreateStatic(max, 0, NULL, buffer);
+    if (sem)
+        sem->count = initial;
+    return sem;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void)
+{
+    return xSemaphoreCreateCounting(1, 1);
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutexStatic(StaticSemaphore_t *buffer)
+{
+    return xSemaphoreCreateCountingStatic(1, 1, buffer);
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void)
+{
+    return xSemaphoreCreateCounting(1, 0);
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinaryStatic(StaticSemaphore_t *buffer)
+{
+    return xSemaphoreCreateCountingStatic(1, 0, buffer);
+}
+
+static uint32_t semaphore_ops;
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks)
+{
+    __atomic_fetch_add(&semaphore_ops, 1, __ATOMIC_RELAXED);
+    return queue_receive(sem, NULL, ticks, false);
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem)
+{
+    __atomic_fetch_add(&semaphore_ops, 1, __ATOMIC_RELAXED);
+    return queue_send(sem, NULL, 0, false, false);
+}
+
+uint32_t host_semaphore_ops(void)
+{
+    return __atomic_load_n(&semaphore_ops, __ATOMIC_RELAXED);
+}
+
+UBaseType_t uxSemaphoreGetCount(SemaphoreHandle_t sem)
+{
+    return uxQueueMessagesWaiting(sem);
+}
@@ -0,0 +1,238 @@
+/*
+ * Host build: ESP-IDF non-volatile storage in RAM
+ *
+ * Entries survive descriptors being freed and created again, which is what
+ * the drivers see of a reboot, but not the process.
+ */
+#include <nvs_flash.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_NAMESPACES 16
+#define HANDLE_RW 0x10000
+
+typedef enum
+{
+    TYPE_U32,
+    TYPE_BLOB,
+} entry_type_t;
+
+typedef struct entry_s
+{
+    struct entry_s *next;
+    uint8_t ns;
+    char key[NVS_KEY_NAME_MAX_SIZE];
+    entry_type_t type;
+    size_t size;
+    uint8_t data[];
+} entry_t;
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static char namespaces[MAX_NAMESPACES][NVS_KEY_NAME_MAX_SIZE];
+static entry_t *entries;
+static bool initialized;
+
+static bool valid_name(const char *name)
+{
+    return name && *name && strlen(name) < NVS_KEY_NAME_MAX_SIZE;
+}
+
+static entry_t **find(uint8_t ns, const char *key)
+{
+    entry_t **e = &entries;
+    while (*e && ((*e)->ns != ns || strcmp((*e)->key, key)))
+        e = &(*e)->next;
+    return e;
+}
+
+static esp_err_t get(nvs_handle_t handle, const char *key, entry_type_t type, void *value, size_t *size)
+{
+    uint8_t ns = (handle & 0xffff) - 1;
+    if (ns >= MAX_NAMESPACES)
+        return ESP_ERR_NVS_INVALID_HANDLE;
+    if (!valid_name(key))
+        return ESP_ERR_NVS_INVALID_NAME;
+
+    esp_err_t res = ESP_OK;
+    pthread_mutex_lock(&lock);
+    entry_t *e = *find(ns, key);
+    if (!e)
+        res = ESP_ERR_NVS_NOT_FOUND;
+    else if (e->type != type)
+        res = ESP_ERR_NVS_TYPE_MISMATCH;
+    else if (value && *size < e->size)
+        res = ESP_ERR_NVS_INVALID_LENGTH;
+    else
+    {
+        if (value)
+            memcpy(value, e->data, e->size);
+        *size = e->size;
+    }
+    pthread_mutex_unlock(&lock);
+
+    return res;
+}
+
+static esp_err_t set(nvs_handle_t handle, const char *key, entry_type_t type, const void *value, size_t size)
+{
+    uint8_t ns = (handle & 0xffff) - 1;
+    if (ns >= MAX_NAMESPACES)
+        return ESP_ERR_NVS_INVALID_HANDLE;
+    if (!(handle & HANDLE_RW))
+        return ESP_ERR_NVS_READ_ONLY;
+    if (!valid_name(key))
+        return ESP_ERR_NVS_INVALID_NAME;
+
+    entry_t *n = malloc(sizeof(entry_t) + size);
+    if (!n)
+        return ESP_ERR_NVS_NOT_ENOUGH_SPACE;
+    n->ns = ns;
+    strcpy(n->key, key);
+    n->type = type;
+    n->size = size;
+    memcpy(n->data, value, size);
+
+    pthread_mutex_lock(&lock);
+    entry_t **e = find(ns, key);
+    n->next = *e ? (*e)->next : NULL;
+    free(*e);
+    *e = n;
+    pthread_mutex_unlock(&lock);
+
+    return ESP_OK;
+}
+
+esp_err_t nvs_flash_init(void)
+{
+    initialized = true;
+    return ESP_OK;
+}
+
+esp_err_t nvs_flash_erase(void)
+{
+    pthread_mutex_lock(&lock);
+    while (entries)
+    {
+        entry_t *e = entries;
+        entries = e->next;
+        free(e);
+    }
+    memset(namespaces, 0, sizeof(namespaces));
+    pthread_mutex_unlock(&lock);
+    return ESP_OK;
+}
+
+esp_err_t nvs_open(const char *name, nvs_open_mode_t mode, nvs_handle_t *handle)
+{
+    if (!initialized)
+        return ESP_ERR_NVS_NOT_INITIALIZED;
+    if (!valid_name(name) || !handle)
+        return ESP_ERR_NVS_INVALID_NAME;
+
+    esp_err_t res = ESP_ERR_NVS_NOT_ENOUGH_SPACE;
+    pthread_mutex_lock(&lock);
+    for (int i = 0; i < MAX_NAMESPACES; i++)
+    {
+        if (!namespaces[i][0])
+        {
+            // Read only handles do not create namespaces
+            if (mode == NVS_READONLY)
+            {
+                res = ESP_ERR_NVS_NOT_FOUND;
+                break;
+            }
+            strcpy(namespaces[i], name);
+        }
+        if (!strcmp(namespaces[i], name))
+        {
+            *handle = (i + 1) | (mode == NVS_READWRITE ? HANDLE_RW : 0);
+            res = ESP_OK;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&lock);
+
+    return res;
+}
+
+void nvs_close(nvs_handle_t handle)
+{
+    (void)handle;
+}
+
+esp_err_t nvs_commit(nvs_handle_t handle)
+{
+    return (handle & 0xffff) - 1 < MAX_NAMESPACES ? ESP_OK : ESP_ERR_NVS_INVALID_HANDLE;
+}
+
+esp_err_t nvs_get_u32(nvs_handle_t handle, const char *key, uint32_t *value)
+{
+    size_t size = sizeof(uint32_t);
+    return value ? get(handle, key, TYPE_U32, value, &size) : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t nvs_set_u32(nvs_handle_t handle, const char *key, uint32_t value)
+{
+    return set(handle, key, TYPE_U32, &value, sizeof(value));
+}
+
+esp_err_t nvs_get_blob(nvs_handle_t handle, const char *key, void *value, size_t *length)
+{
+    return length ? get(handle, key, TYPE_BLOB, value, length) : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t nvs_set_blob(nvs_handle_t handle, const char *key, const void *value, size_t length)
+{
+    return value || !length ? set(handle, key, TYPE_BLOB, value, length) : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t nvs_erase_key(nvs_handle_t handle, const char *key)
+{
+    uint8_t ns = (handle & 0xffff) - 1;
+    if (ns >= MAX_NAMESPACES)
+        return ESP_ERR_NVS_INVALID_HANDLE;
+    if (!(handle & HANDLE_RW))
+        return ESP_ERR_NVS_READ_ONLY;
+
+    esp_err_t res = ESP_ERR_NVS_NOT_FOUND;
+    pthread_mutex_lock(&lock);
+    entry_t **e = find(ns, key);
+    if (*e)
+    {
+        entry_t *d = *e;
+        *e = d->next;
+        free(d);
+        res = ESP_OK;
+    }
+    pthread_mutex_unlock(&lock);
+
+    return res;
+}
+
+esp_err_t nvs_erase_all(nvs_handle_t handle)
+{
+    uint8_t ns = (handle & 0xffff) - 1;
+    if (ns >= MAX_NAMESPACES)
+        return ESP_ERR_NVS_INVALID_HANDLE;
+    if (!(handle & HANDLE_RW))
+        return ESP_ERR_NVS_READ_ONLY;
+
+    pthread_mutex_lock(&lock);
+    entry_t **e = &entries;
+    while (*e)
+    {
+        if ((*e)->ns == ns)
+        {
+            entry_t *d = *e;
+            *e = d->next;
+            free(d);
+        }
+        else
+            e = &(*e)->next;
+    }
+    pthread_mutex_unlock(&lock);
+
+    return ESP_OK;
+}
@@ -0,0 +1,280 @@
+/**
+ * @file i2c_replay.c
+ *
+ * Replay a binary i2cdev trace on the simulated bus or a Linux adapter
+ *
+ * Records of one bus transaction are run as one i2c_dev_batch(). Reads use
+ * the recorded size; writes send the captured payload, zero padded when
+ * the record was truncated. On the simulated bus, MCP4728 (0x60..0x67)
+ * and TCA9534 (0x20..0x27, 0x38..0x3f) models are attached for the
+ * addresses in the trace. Reports results that differ from the recorded
+ * ones and replayed against recorded transaction time.
+ *
+ * -t keeps the recorded gaps between transactions (and runs the simulated
+ *    bus in realtime), otherwise transactions run back to back
+ * -n N replays the trace N times
+ * -a N maps the traced port to adapter /dev/i2c-N (Linux backend)
+ *
+ * Usage: i2c_replay [-t] [-n N] [-a N] trace.bin
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <unistd.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <i2cdev.h>
+#if I2C_REPLAY_SIM
+#include <i2c_sim.h>
+#include <sim_mcp4728.h>
+#include <sim_tca9534.h>
+#else
+#include <i2cdev_linux.h>
+#endif
+
+#define MAX_DEVS 16
+#define MAX_SEGS 16
+
+typedef struct
+{
+    uint8_t addr;
+    uint16_t scl_khz;
+    i2c_dev_t dev;
+} replay_dev_t;
+
+static i2cdev_trace_hdr_t hdr;
+static i2cdev_trace_rec_t *recs;
+static replay_dev_t devs[MAX_DEVS];
+static size_t dev_count;
+static uint32_t truncated;
+
+static int load(const char *path)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f)
+    {
+        perror(path);
+        return -1;
+    }
+    const size_t fixed = offsetof(i2cdev_trace_rec_t, data);
+    if (fread(&hdr, sizeof(hdr), 1, f) != 1 || memcmp(hdr.magic, I2CDEV_TRACE_MAGIC, 4)
+            || hdr.version != I2CDEV_TRACE_VERSION || hdr.rec_size < fixed + hdr.payload)
+    {
+        fprintf(stderr, "%s: not an i2cdev trace of version %d\n", path, I2CDEV_TRACE_VERSION);
+        fclose(f);
+        return -1;
+    }
+
+    recs = calloc(hdr.count ? hdr.count : 1, sizeof(i2cdev_trace_rec_t));
+    uint8_t *raw = malloc(hdr.rec_size);
+    size_t payload = hdr.payload < I2CDEV_TRACE_PAYLOAD ? hdr.payload : I2CDEV_TRACE_PAYLOAD;
+    for (uint32_t i = 0; i < hdr.count; i++)
+    {
+        if (fread(raw, hdr.rec_size, 1, f) != 1)
+        {
+            fprintf(stderr, "%s: %u of %u records\n", path, (unsigned)i, (unsigned)hdr.count);
+            hdr.count = i;
+            break;
+        }
+        // Payload size may differ from the one of this build
+        memcpy(&recs[i], raw, fixed);
+        memcpy(recs[i].data, raw + fixed, payload);
+    }
+    free(raw);
+    fclose(f);
+
+    return 0;
+}
+
+static i2c_dev_t *get_dev(const i2cdev_trace_rec_t *rec)
+{
+    for (size_t i = 0; i < dev_count; i++)
+        if (devs[i].addr == rec->addr && devs[i].scl_khz == rec->scl_khz)
+            return &devs[i].dev;
+    if (dev_count == MAX_DEVS)
+        return NULL;
+
+    replay_dev_t *d = &devs[dev_count++];
+    d->addr = rec->addr;
+    d->scl_khz = rec->scl_khz;
+    d->dev.addr = rec->addr;
+    i2c_config_t cfg = { .mode = I2C_MODE_MASTER, .sda_io_num = 21, .scl_io_num = 22 };
+    cfg.master.clk_speed = (rec->scl_khz ? rec->scl_khz : 400) * 1000;
+    ESP_ERROR_CHECK(i2c_dev_attach(&d->dev, 0, &cfg, 0));
+
+#if I2C_REPLAY_SIM
+    bool known = false;
+    for (size_t i = 0; i < dev_count - 1; i++)
+        known |= devs[i].addr == rec->addr;
+    if (!known && (rec->addr & 0xf8) == 0x60)
+    {
+        sim_mcp4728_t *dac = calloc(1, sizeof(sim_mcp4728_t));
+        sim_mcp4728_init(dac, rec->addr);
+        i2c_sim_attach(0, &dac->model);
+    }
+    else if (!known && ((rec->addr & 0xf8) == 0x20 || (rec->addr & 0xf8) == 0x38))
+    {
+        sim_tca9534_t *exp = calloc(1, sizeof(sim_tca9534_t));
+        sim_tca9534_init(exp, rec->addr);
+        i2c_sim_attach(0, &exp->model);
+    }
+#endif
+
+    return &d->dev;
+}
+
+typedef struct
+{
+    uint32_t transactions;
+    uint32_t mismatches;
+    uint64_t replayed_us;
+    uint64_t recorded_us;
+    uint32_t replayed_max_us;
+    uint32_t recorded_max_us;
+    uint32_t late_max_us;
+} replay_stats_t;
+
+static void replay(bool timed, replay_stats_t *st)
+{
+    static uint8_t bufs[MAX_SEGS][UINT16_MAX];
+    i2c_dev_seg_t segs[MAX_SEGS];
+    int64_t start = esp_timer_get_time();
+
+    uint32_t i = 0;
+    while (i < hdr.count)
+    {
+        const i2cdev_trace_rec_t *first = &recs[i];
+        size_t n = 0;
+        for (; i < hdr.count && n < MAX_SEGS && (!n || (recs[i].flags & I2CDEV_TRACE_JOINED)); i++, n++)
+        {
+            const i2cdev_trace_rec_t *rec = &recs[i];
+            i2c_dev_t *dev = get_dev(rec);
+            if (!dev)
+            {
+                fprintf(stderr, "More than %d devices in trace\n", MAX_DEVS);
+                exit(1);
+            }
+            bool read = rec->flags & I2CDEV_TRACE_READ;
+            size_t captured = rec->size < I2CDEV_TRACE_PAYLOAD ? rec->size : I2CDEV_TRACE_PAYLOAD;
+            if (!read)
+            {
+                memcpy(bufs[n], rec->data, captured);
+                memset(bufs[n] + captured, 0, rec->size - captured);
+                if (captured < rec->size)
+                    truncated++;
+            }
+            segs[n] = (i2c_dev_seg_t) {
+                .dev = dev,
+                .read = read,
+                .out = rec->out_size ? rec->out : NULL,
+                .out_size = rec->out_size < I2CDEV_XFER_OUT_MAX ? rec->out_size : I2CDEV_XFER_OUT_MAX,
+                .data = bufs[n],
+                .size = rec->size ? rec->size : 1,
+            };
+        }
+
+        if (timed)
+        {
+            int64_t due = start + (uint32_t)(first->ts_us - recs[0].ts_us);
+            int64_t now = esp_timer_get_time();
+            if (due > now)
+                usleep(due - now);
+            else if (now - due > st->late_max_us)
+                st->late_max_us = now - due;
+        }
+
+        int64_t t = esp_timer_get_time();
+        esp_err_t res = i2c_dev_batch(segs, n);
+        uint32_t us = esp_timer_get_time() - t;
+
+        st->transactions++;
+        if ((res == ESP_OK) != (first->result == ESP_OK))
+            st->mismatches++;
+        st->replayed_us += us;
+        st->recorded_us += first->duration_us;
+        if (us > st->replayed_max_us)
+            st->replayed_max_us = us;
+        if (first->duration_us > st->recorded_max_us)
+            st->recorded_max_us = first->duration_us;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    bool timed = false;
+    unsigned repeat = 1;
+    int adapter = -1;
+    int opt;
+    while ((opt = getopt(argc, argv, "tn:a:")) != -1)
+    {
+        switch (opt)
+        {
+            case 't':
+                timed = true;
+                break;
+            case 'n':
+                repeat = strtoul(optarg, NULL, 0);
+                break;
+            case 'a':
+                adapter = strtol(optarg, NULL, 0);
+                break;
+            default:
+                fprintf(stderr, "Usage: %s [-t] [-n N] [-a N] trace.bin\n", argv[0]);
+                return 1;
+        }
+    }
+    if (optind >= argc || !repeat)
+    {
+        fprintf(stderr, "Usage: %s [-t] [-n N] [-a N] trace.bin\n", argv[0]);
+        return 1;
+    }
+    if (load(argv[optind]))
+        return 1;
+
+    esp_log_level_set("*", ESP_LOG_NONE);
+    ESP_ERROR_CHECK(i2cdev_init());
+#if I2C_REPLAY_SIM
+    if (timed)
+    {
+        i2c_sim_timing_t timing = { .overhead_us = 20, .byte_bits = 9, .cond_bits = 1, .realtime = true };
+        i2c_sim_set_timing(&timing);
+    }
+    (void)adapter;
+#else
+    ESP_ERROR_CHECK(i2cdev_linux_set_adapter(0, adapter >= 0 ? adapter : hdr.port));
+#endif
+
+    printf("%s: port %u, %u records, %u dropped before the dump, %u payload bytes per record\n",
+           argv[optind], hdr.port, (unsigned)hdr.count, (unsigned)hdr.dropped, hdr.payload);
+
+    replay_stats_t st = { 0 };
+    int64_t start = esp_timer_get_time();
+    for (unsigned r = 0; r < repeat; r++)
+        replay(timed, &st);
+    int64_t wall = esp_timer_get_time() - start;
+
+    uint32_t span = hdr.count ? recs[hdr.count - 1].ts_us - recs[0].ts_us : 0;
+    printf("%u transactions in %lld us, %s, recorded span %u us\n", (unsigned)st.transactions,
+           (long long)wall, timed ? "timed" : "back to back", (unsigned)span);
+    if (st.transactions)
+        printf("transaction time, us: replayed mean %.1f max %u, recorded mean %.1f max %u\n",
+               (double)st.replayed_us / st.transactions, (unsigned)st.replayed_max_us,
+               (double)st.recorded_us / st.transactions, (unsigned)st.recorded_max_us);
+    if (timed)
+        printf("latest start: %u us behind the recorded schedule\n", (unsigned)st.late_max_us);
+#if I2C_REPLAY_SIM
+    i2c_sim_stats_t sim;
+    i2c_sim_get_stats(0, &sim, false);
+    printf("simulated bus: %.1f us per transaction, %u NACKs\n",
+           st.transactions ? (double)sim.bus_time_us / st.transactions : 0.0, (unsigned)sim.nacks);
+#endif
+    printf("%u results differ from the trace, %u writes zero padded\n", (unsigned)st.mismatches, (unsigned)truncated);
+
+    for (size_t i = 0; i < dev_count; i++)
+        i2c_dev_detach(&devs[i].dev);
+    i2cdev_done();
+    free(recs);
+
+    return st.mismatches ? 2 : 0;
+}